@@ -0,0 +1,767 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "AudioConvert.h"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define	AUDIO_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define	AUDIO_NEON
+#include <arm_neon.h>
+#endif
+
+// Where NEON has a fused multiply and add, the scale and rounding offset are applied with a single
+// rounding in every kernel. Otherwise a compiler free to fuse only some of them would round the
+// odd sample differently in the vector lanes and in the scalar tail.
+#if defined(AUDIO_NEON) && defined(__ARM_FEATURE_FMA)
+#define	AUDIO_FMA
+#include <cmath>
+#endif
+
+#if defined(AUDIO_X86) && !defined(_MSC_VER)
+#define	TARGET_SSE2	__attribute__((target("sse2")))
+#define	TARGET_AVX2	__attribute__((target("avx2")))
+#else
+#define	TARGET_SSE2
+#define	TARGET_AVX2
+#endif
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define	AUDIO_BIG_ENDIAN
+#endif
+
+const float ENCODE_SCALE = 32767.0F;
+const float DECODE_SCALE = 1.0F / 65536.0F;
+
+// Saturate before the conversion so that out of range audio clips rather than wraps
+const float ENCODE_MAX = 32767.0F;
+const float ENCODE_MIN = -32768.0F;
+
+// A sample this far from zero is taken to have clipped
+const int16_t CLIP_LEVEL = 32767;
+
+typedef void (*ENCODE_FUNC)(const float* in, int16_t* out, unsigned int nSamples);
+typedef void (*DECODE_FUNC)(const int16_t* in, float* out, unsigned int nSamples);
+typedef float (*DOT_FUNC)(const float* a, const float* b, unsigned int n);
+typedef void (*MIX_FUNC)(const int16_t* in, int16_t gain, int32_t* bus, unsigned int nSamples);
+typedef void (*MEASURE_FUNC)(const int16_t* in, unsigned int nSamples, uint64_t& sumSquares, unsigned int& peak, unsigned int& clips);
+
+static inline int16_t encodeSample(float in)
+{
+#if defined(AUDIO_FMA)
+	float val = std::fma(in, ENCODE_SCALE, 0.5F);
+#else
+	float val = in * ENCODE_SCALE + 0.5F;
+#endif
+
+	if (val > ENCODE_MAX)
+		val = ENCODE_MAX;
+	else if (val < ENCODE_MIN)
+		val = ENCODE_MIN;
+
+	return int16_t(val);
+}
+
+static void encodeScalar(const float* in, int16_t* out, unsigned int nSamples)
+{
+	for (unsigned int i = 0U; i < nSamples; i++)
+		out[i] = encodeSample(in[i]);
+}
+
+static void decodeScalar(const int16_t* in, float* out, unsigned int nSamples)
+{
+	for (unsigned int i = 0U; i < nSamples; i++)
+		out[i] = float(in[i]) * DECODE_SCALE;
+}
+
+static float dotScalar(const float* a, const float* b, unsigned int n)
+{
+	float sum = 0.0F;
+	for (unsigned int i = 0U; i < n; i++)
+		sum += a[i] * b[i];
+
+	return sum;
+}
+
+// The products are shifted down before they are added, so every kernel gives the same result
+const int MIX_SHIFT = 12;
+
+static void mixScalar(const int16_t* in, int16_t gain, int32_t* bus, unsigned int nSamples)
+{
+	for (unsigned int i = 0U; i < nSamples; i++)
+		bus[i] += (int32_t(in[i]) * int32_t(gain)) >> MIX_SHIFT;
+}
+
+static void measureScalar(const int16_t* in, unsigned int nSamples, uint64_t& sumSquares, unsigned int& peak, unsigned int& clips)
+{
+	for (unsigned int i = 0U; i < nSamples; i++) {
+		int v = in[i];
+		sumSquares += uint64_t(v * v);
+
+		unsigned int mag = (v < 0) ? unsigned(-v) : unsigned(v);
+		if (mag > peak)
+			peak = mag;
+		if (mag >= unsigned(CLIP_LEVEL))
+			clips++;
+	}
+}
+
+// Folds the per lane results of a vector kernel into the totals
+static void measureFold(const int16_t* max, const int16_t* min, unsigned int nLanes, const uint32_t* counts, unsigned int nCounts, unsigned int& peak, unsigned int& clips)
+{
+	// The lanes start from zero, so the maxima are never negative and the minima never positive
+	for (unsigned int i = 0U; i < nLanes; i++) {
+		if (unsigned(max[i]) > peak)
+			peak = unsigned(max[i]);
+		if (unsigned(-int(min[i])) > peak)
+			peak = unsigned(-int(min[i]));
+	}
+
+	for (unsigned int i = 0U; i < nCounts; i++)
+		clips += counts[i];
+}
+
+#if defined(AUDIO_X86)
+TARGET_SSE2 static void encodeSSE2(const float* in, int16_t* out, unsigned int nSamples)
+{
+	const __m128 scale = _mm_set1_ps(ENCODE_SCALE);
+	const __m128 half  = _mm_set1_ps(0.5F);
+	const __m128 max   = _mm_set1_ps(ENCODE_MAX);
+	const __m128 min   = _mm_set1_ps(ENCODE_MIN);
+
+	unsigned int i = 0U;
+	for (; (i + 8U) <= nSamples; i += 8U) {
+		__m128 a = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 0U), scale), half);
+		__m128 b = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4U), scale), half);
+
+		a = _mm_max_ps(_mm_min_ps(a, max), min);
+		b = _mm_max_ps(_mm_min_ps(b, max), min);
+
+		__m128i s = _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b));
+		_mm_storeu_si128((__m128i*)(out + i), s);
+	}
+
+	encodeScalar(in + i, out + i, nSamples - i);
+}
+
+TARGET_SSE2 static void decodeSSE2(const int16_t* in, float* out, unsigned int nSamples)
+{
+	const __m128 scale = _mm_set1_ps(DECODE_SCALE);
+
+	unsigned int i = 0U;
+	for (; (i + 8U) <= nSamples; i += 8U) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(in + i));
+
+		// Sign extend by placing each sample in the top half and shifting down
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+
+		_mm_storeu_ps(out + i + 0U, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(out + i + 4U, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+
+	decodeScalar(in + i, out + i, nSamples - i);
+}
+
+TARGET_SSE2 static float dotSSE2(const float* a, const float* b, unsigned int n)
+{
+	__m128 sum1 = _mm_setzero_ps();
+	__m128 sum2 = _mm_setzero_ps();
+
+	unsigned int i = 0U;
+	for (; (i + 8U) <= n; i += 8U) {
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 0U), _mm_loadu_ps(b + i + 0U)));
+		sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(a + i + 4U), _mm_loadu_ps(b + i + 4U)));
+	}
+
+	float sums[4U];
+	_mm_storeu_ps(sums, _mm_add_ps(sum1, sum2));
+
+	return sums[0U] + sums[1U] + sums[2U] + sums[3U] + dotScalar(a + i, b + i, n - i);
+}
+
+TARGET_SSE2 static void mixSSE2(const int16_t* in, int16_t gain, int32_t* bus, unsigned int nSamples)
+{
+	const __m128i g = _mm_set1_epi16(gain);
+
+	unsigned int i = 0U;
+	for (; (i + 8U) <= nSamples; i += 8U) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(in + i));
+
+		// The low and high halves of each product are interleaved into 32-bit lanes
+		__m128i lo = _mm_mullo_epi16(s, g);
+		__m128i hi = _mm_mulhi_epi16(s, g);
+
+		__m128i p1 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), MIX_SHIFT);
+		__m128i p2 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), MIX_SHIFT);
+
+		_mm_storeu_si128((__m128i*)(bus + i + 0U), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(bus + i + 0U)), p1));
+		_mm_storeu_si128((__m128i*)(bus + i + 4U), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(bus + i + 4U)), p2));
+	}
+
+	mixScalar(in + i, gain, bus + i, nSamples - i);
+}
+
+TARGET_SSE2 static void measureSSE2(const int16_t* in, unsigned int nSamples, uint64_t& sumSquares, unsigned int& peak, unsigned int& clips)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi16(-1);
+	const __m128i high = _mm_set1_epi16(CLIP_LEVEL - 1);
+	const __m128i low  = _mm_set1_epi16(-(CLIP_LEVEL - 1));
+
+	__m128i sum   = _mm_setzero_si128();
+	__m128i count = _mm_setzero_si128();
+	__m128i max   = _mm_setzero_si128();
+	__m128i min   = _mm_setzero_si128();
+
+	unsigned int i = 0U;
+	for (; (i + 8U) <= nSamples; i += 8U) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(in + i));
+
+		// Each pair of squares fits an unsigned 32-bit lane, which is widened before it is added
+		__m128i sq = _mm_madd_epi16(s, s);
+		sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(sq, zero));
+		sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(sq, zero));
+
+		max = _mm_max_epi16(max, s);
+		min = _mm_min_epi16(min, s);
+
+		// The all ones mask of a clipped sample times minus one counts it
+		__m128i clipped = _mm_or_si128(_mm_cmpgt_epi16(s, high), _mm_cmplt_epi16(s, low));
+		count = _mm_add_epi32(count, _mm_madd_epi16(clipped, ones));
+	}
+
+	uint64_t sums[2U];
+	_mm_storeu_si128((__m128i*)sums, sum);
+	sumSquares += sums[0U] + sums[1U];
+
+	int16_t maxs[8U], mins[8U];
+	uint32_t counts[4U];
+	_mm_storeu_si128((__m128i*)maxs, max);
+	_mm_storeu_si128((__m128i*)mins, min);
+	_mm_storeu_si128((__m128i*)counts, count);
+	measureFold(maxs, mins, 8U, counts, 4U, peak, clips);
+
+	measureScalar(in + i, nSamples - i, sumSquares, peak, clips);
+}
+
+TARGET_AVX2 static void encodeAVX2(const float* in, int16_t* out, unsigned int nSamples)
+{
+	const __m256 scale = _mm256_set1_ps(ENCODE_SCALE);
+	const __m256 half  = _mm256_set1_ps(0.5F);
+	const __m256 max   = _mm256_set1_ps(ENCODE_MAX);
+	const __m256 min   = _mm256_set1_ps(ENCODE_MIN);
+
+	unsigned int i = 0U;
+	for (; (i + 16U) <= nSamples; i += 16U) {
+		__m256 a = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i + 0U), scale), half);
+		__m256 b = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8U), scale), half);
+
+		a = _mm256_max_ps(_mm256_min_ps(a, max), min);
+		b = _mm256_max_ps(_mm256_min_ps(b, max), min);
+
+		// The pack works within each 128-bit lane, so the middle quarters are swapped back
+		__m256i s = _mm256_packs_epi32(_mm256_cvttps_epi32(a), _mm256_cvttps_epi32(b));
+		s = _mm256_permute4x64_epi64(s, 0xD8);
+
+		_mm256_storeu_si256((__m256i*)(out + i), s);
+	}
+
+	encodeScalar(in + i, out + i, nSamples - i);
+}
+
+TARGET_AVX2 static void decodeAVX2(const int16_t* in, float* out, unsigned int nSamples)
+{
+	const __m256 scale = _mm256_set1_ps(DECODE_SCALE);
+
+	unsigned int i = 0U;
+	for (; (i + 16U) <= nSamples; i += 16U) {
+		__m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i + 0U)));
+		__m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i + 8U)));
+
+		_mm256_storeu_ps(out + i + 0U, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+		_mm256_storeu_ps(out + i + 8U, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+	}
+
+	decodeScalar(in + i, out + i, nSamples - i);
+}
+
+TARGET_AVX2 static float dotAVX2(const float* a, const float* b, unsigned int n)
+{
+	__m256 sum1 = _mm256_setzero_ps();
+	__m256 sum2 = _mm256_setzero_ps();
+
+	unsigned int i = 0U;
+	for (; (i + 16U) <= n; i += 16U) {
+		sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 0U), _mm256_loadu_ps(b + i + 0U)));
+		sum2 = _mm256_add_ps(sum2, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8U), _mm256_loadu_ps(b + i + 8U)));
+	}
+
+	__m256 sum = _mm256_add_ps(sum1, sum2);
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+
+	float sums[4U];
+	_mm_storeu_ps(sums, half);
+
+	return sums[0U] + sums[1U] + sums[2U] + sums[3U] + dotScalar(a + i, b + i, n - i);
+}
+
+TARGET_AVX2 static void mixAVX2(const int16_t* in, int16_t gain, int32_t* bus, unsigned int nSamples)
+{
+	const __m256i g = _mm256_set1_epi32(gain);
+
+	unsigned int i = 0U;
+	for (; (i + 8U) <= nSamples; i += 8U) {
+		__m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i)));
+		__m256i p = _mm256_srai_epi32(_mm256_mullo_epi32(s, g), MIX_SHIFT);
+
+		_mm256_storeu_si256((__m256i*)(bus + i), _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(bus + i)), p));
+	}
+
+	mixScalar(in + i, gain, bus + i, nSamples - i);
+}
+
+TARGET_AVX2 static void measureAVX2(const int16_t* in, unsigned int nSamples, uint64_t& sumSquares, unsigned int& peak, unsigned int& clips)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i ones = _mm256_set1_epi16(-1);
+	const __m256i high = _mm256_set1_epi16(CLIP_LEVEL - 1);
+	const __m256i low  = _mm256_set1_epi16(-(CLIP_LEVEL - 1));
+
+	__m256i sum   = _mm256_setzero_si256();
+	__m256i count = _mm256_setzero_si256();
+	__m256i max   = _mm256_setzero_si256();
+	__m256i min   = _mm256_setzero_si256();
+
+	unsigned int i = 0U;
+	for (; (i + 16U) <= nSamples; i += 16U) {
+		__m256i s = _mm256_loadu_si256((const __m256i*)(in + i));
+
+		__m256i sq = _mm256_madd_epi16(s, s);
+		sum = _mm256_add_epi64(sum, _mm256_unpacklo_epi32(sq, zero));
+		sum = _mm256_add_epi64(sum, _mm256_unpackhi_epi32(sq, zero));
+
+		max = _mm256_max_epi16(max, s);
+		min = _mm256_min_epi16(min, s);
+
+		__m256i clipped = _mm256_or_si256(_mm256_cmpgt_epi16(s, high), _mm256_cmpgt_epi16(low, s));
+		count = _mm256_add_epi32(count, _mm256_madd_epi16(clipped, ones));
+	}
+
+	uint64_t sums[4U];
+	_mm256_storeu_si256((__m256i*)sums, sum);
+	sumSquares += sums[0U] + sums[1U] + sums[2U] + sums[3U];
+
+	int16_t maxs[16U], mins[16U];
+	uint32_t counts[8U];
+	_mm256_storeu_si256((__m256i*)maxs, max);
+	_mm256_storeu_si256((__m256i*)mins, min);
+	_mm256_storeu_si256((__m256i*)counts, count);
+	measureFold(maxs, mins, 16U, counts, 8U, peak, clips);
+
+	measureScalar(in + i, nSamples - i, sumSquares, peak, clips);
+}
+
+static bool hasAVX2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	// The OS must also save the AVX registers
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+		return false;
+
+	if ((_xgetbv(0) & 0x06U) != 0x06U)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+#if defined(AUDIO_NEON)
+static void encodeNEON(const float* in, int16_t* out, unsigned int nSamples)
+{
+	const float32x4_t scale = vdupq_n_f32(ENCODE_SCALE);
+	const float32x4_t half  = vdupq_n_f32(0.5F);
+	const float32x4_t max   = vdupq_n_f32(ENCODE_MAX);
+	const float32x4_t min   = vdupq_n_f32(ENCODE_MIN);
+
+	unsigned int i = 0U;
+	for (; (i + 8U) <= nSamples; i += 8U) {
+#if defined(AUDIO_FMA)
+		float32x4_t a = vfmaq_f32(half, vld1q_f32(in + i + 0U), scale);
+		float32x4_t b = vfmaq_f32(half, vld1q_f32(in + i + 4U), scale);
+#else
+		float32x4_t a = vaddq_f32(vmulq_f32(vld1q_f32(in + i + 0U), scale), half);
+		float32x4_t b = vaddq_f32(vmulq_f32(vld1q_f32(in + i + 4U), scale), half);
+#endif
+
+		a = vmaxq_f32(vminq_f32(a, max), min);
+		b = vmaxq_f32(vminq_f32(b, max), min);
+
+		int16x8_t s = vcombine_s16(vqmovn_s32(vcvtq_s32_f32(a)), vqmovn_s32(vcvtq_s32_f32(b)));
+		vst1q_s16(out + i, s);
+	}
+
+	encodeScalar(in + i, out + i, nSamples - i);
+}
+
+static void decodeNEON(const int16_t* in, float* out, unsigned int nSamples)
+{
+	const float32x4_t scale = vdupq_n_f32(DECODE_SCALE);
+
+	unsigned int i = 0U;
+	for (; (i + 8U) <= nSamples; i += 8U) {
+		int16x8_t s = vld1q_s16(in + i);
+
+		vst1q_f32(out + i + 0U, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), scale));
+		vst1q_f32(out + i + 4U, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), scale));
+	}
+
+	decodeScalar(in + i, out + i, nSamples - i);
+}
+
+static float dotNEON(const float* a, const float* b, unsigned int n)
+{
+	float32x4_t sum1 = vdupq_n_f32(0.0F);
+	float32x4_t sum2 = vdupq_n_f32(0.0F);
+
+	unsigned int i = 0U;
+	for (; (i + 8U) <= n; i += 8U) {
+		sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 0U), vld1q_f32(b + i + 0U));
+		sum2 = vmlaq_f32(sum2, vld1q_f32(a + i + 4U), vld1q_f32(b + i + 4U));
+	}
+
+	float32x4_t sum = vaddq_f32(sum1, sum2);
+	float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+
+	return vget_lane_f32(vpadd_f32(half, half), 0) + dotScalar(a + i, b + i, n - i);
+}
+
+static void mixNEON(const int16_t* in, int16_t gain, int32_t* bus, unsigned int nSamples)
+{
+	unsigned int i = 0U;
+	for (; (i + 8U) <= nSamples; i += 8U) {
+		int16x8_t s = vld1q_s16(in + i);
+
+		// Shift right and accumulate in one step
+		int32x4_t b1 = vsraq_n_s32(vld1q_s32(bus + i + 0U), vmull_n_s16(vget_low_s16(s), gain), MIX_SHIFT);
+		int32x4_t b2 = vsraq_n_s32(vld1q_s32(bus + i + 4U), vmull_n_s16(vget_high_s16(s), gain), MIX_SHIFT);
+
+		vst1q_s32(bus + i + 0U, b1);
+		vst1q_s32(bus + i + 4U, b2);
+	}
+
+	mixScalar(in + i, gain, bus + i, nSamples - i);
+}
+
+static void measureNEON(const int16_t* in, unsigned int nSamples, uint64_t& sumSquares, unsigned int& peak, unsigned int& clips)
+{
+	const int16x8_t high = vdupq_n_s16(CLIP_LEVEL - 1);
+	const int16x8_t low  = vdupq_n_s16(-(CLIP_LEVEL - 1));
+
+	uint64x2_t sum   = vdupq_n_u64(0U);
+	uint32x4_t count = vdupq_n_u32(0U);
+	int16x8_t  max   = vdupq_n_s16(0);
+	int16x8_t  min   = vdupq_n_s16(0);
+
+	unsigned int i = 0U;
+	for (; (i + 8U) <= nSamples; i += 8U) {
+		int16x8_t s = vld1q_s16(in + i);
+
+		int16x4_t lo = vget_low_s16(s);
+		int16x4_t hi = vget_high_s16(s);
+		sum = vpadalq_u32(sum, vreinterpretq_u32_s32(vmull_s16(lo, lo)));
+		sum = vpadalq_u32(sum, vreinterpretq_u32_s32(vmull_s16(hi, hi)));
+
+		max = vmaxq_s16(max, s);
+		min = vminq_s16(min, s);
+
+		uint16x8_t clipped = vorrq_u16(vcgtq_s16(s, high), vcltq_s16(s, low));
+		count = vpadalq_u16(count, vshrq_n_u16(clipped, 15));
+	}
+
+	uint64_t sums[2U];
+	vst1q_u64(sums, sum);
+	sumSquares += sums[0U] + sums[1U];
+
+	int16_t maxs[8U], mins[8U];
+	uint32_t counts[4U];
+	vst1q_s16(maxs, max);
+	vst1q_s16(mins, min);
+	vst1q_u32(counts, count);
+	measureFold(maxs, mins, 8U, counts, 4U, peak, clips);
+
+	measureScalar(in + i, nSamples - i, sumSquares, peak, clips);
+}
+#endif
+
+static ENCODE_FUNC  m_encode  = encodeScalar;
+static DECODE_FUNC  m_decode  = decodeScalar;
+static DOT_FUNC     m_dot     = dotScalar;
+static MIX_FUNC     m_mix     = mixScalar;
+static MEASURE_FUNC m_measure = measureScalar;
+static const char*  m_name    = "scalar";
+
+static bool selectKernels()
+{
+#if defined(AUDIO_X86)
+	return CAudioConvert::setKernels(hasAVX2() ? "AVX2" : "SSE2");
+#elif defined(AUDIO_NEON)
+	return CAudioConvert::setKernels("NEON");
+#else
+	return true;
+#endif
+}
+
+static bool m_selected = selectKernels();
+
+void CAudioConvert::floatToS16(const float* in, int16_t* out, unsigned int nSamples)
+{
+	assert(in != nullptr);
+	assert(out != nullptr);
+
+	m_encode(in, out, nSamples);
+}
+
+void CAudioConvert::floatToS16LE(const float* in, uint8_t* out, unsigned int nSamples)
+{
+	assert(in != nullptr);
+	assert(out != nullptr);
+
+#if defined(AUDIO_BIG_ENDIAN)
+	for (unsigned int i = 0U; i < nSamples; i++) {
+		int16_t val = encodeSample(in[i]);
+
+		out[i * 2U + 0U] = (val >> 0) & 0xFFU;
+		out[i * 2U + 1U] = (val >> 8) & 0xFFU;
+	}
+#else
+	// Native order is S16LE here, the kernels store unaligned
+	m_encode(in, (int16_t*)out, nSamples);
+#endif
+}
+
+void CAudioConvert::s16ToFloat(const int16_t* in, float* out, unsigned int nSamples)
+{
+	assert(in != nullptr);
+	assert(out != nullptr);
+
+	m_decode(in, out, nSamples);
+}
+
+void CAudioConvert::s16LEToFloat(const uint8_t* in, float* out, unsigned int nSamples)
+{
+	assert(in != nullptr);
+	assert(out != nullptr);
+
+#if defined(AUDIO_BIG_ENDIAN)
+	for (unsigned int i = 0U; i < nSamples; i++) {
+		short val = ((in[i * 2U + 0U] & 0xFFU) << 0) + ((in[i * 2U + 1U] & 0xFFU) << 8);
+		out[i] = float(val) * DECODE_SCALE;
+	}
+#else
+	m_decode((const int16_t*)in, out, nSamples);
+#endif
+}
+
+unsigned int CAudioConvert::s16LEToFloat(const uint8_t* data1, unsigned int length1, const uint8_t* data2, unsigned int length2, float* out)
+{
+	assert(data1 != nullptr);
+	assert(data2 != nullptr);
+	assert(out != nullptr);
+
+	unsigned int n = length1 / 2U;
+	s16LEToFloat(data1, out, n);
+
+	// A sample may be split across the two parts
+	unsigned int start = 0U;
+	if (((length1 % 2U) == 1U) && (length2 > 0U)) {
+		short val = ((data1[length1 - 1U] & 0xFFU) << 0) + ((data2[0U] & 0xFFU) << 8);
+		out[n++] = float(val) * DECODE_SCALE;
+		start = 1U;
+	}
+
+	unsigned int n2 = (length2 - start) / 2U;
+	s16LEToFloat(data2 + start, out + n, n2);
+
+	return n + n2;
+}
+
+void CAudioConvert::s16ToS16LE(const int16_t* in, uint8_t* out, unsigned int nSamples)
+{
+	assert(in != nullptr);
+	assert(out != nullptr);
+
+#if defined(AUDIO_BIG_ENDIAN)
+	for (unsigned int i = 0U; i < nSamples; i++) {
+		out[i * 2U + 0U] = (in[i] >> 0) & 0xFFU;
+		out[i * 2U + 1U] = (in[i] >> 8) & 0xFFU;
+	}
+#else
+	::memcpy(out, in, nSamples * sizeof(int16_t));
+#endif
+}
+
+void CAudioConvert::s16LEToS16(const uint8_t* in, int16_t* out, unsigned int nSamples)
+{
+	assert(in != nullptr);
+	assert(out != nullptr);
+
+#if defined(AUDIO_BIG_ENDIAN)
+	for (unsigned int i = 0U; i < nSamples; i++)
+		out[i] = ((in[i * 2U + 0U] & 0xFFU) << 0) + ((in[i * 2U + 1U] & 0xFFU) << 8);
+#else
+	::memcpy(out, in, nSamples * sizeof(int16_t));
+#endif
+}
+
+unsigned int CAudioConvert::s16LEToS16(const uint8_t* data1, unsigned int length1, const uint8_t* data2, unsigned int length2, int16_t* out)
+{
+	assert(data1 != nullptr);
+	assert(data2 != nullptr);
+	assert(out != nullptr);
+
+	unsigned int n = length1 / 2U;
+	s16LEToS16(data1, out, n);
+
+	// A sample may be split across the two parts
+	unsigned int start = 0U;
+	if (((length1 % 2U) == 1U) && (length2 > 0U)) {
+		out[n++] = ((data1[length1 - 1U] & 0xFFU) << 0) + ((data2[0U] & 0xFFU) << 8);
+		start = 1U;
+	}
+
+	unsigned int n2 = (length2 - start) / 2U;
+	s16LEToS16(data2 + start, out + n, n2);
+
+	return n + n2;
+}
+
+void CAudioConvert::scaleS16(const int16_t* in, int16_t* out, unsigned int nSamples)
+{
+	assert(in != nullptr);
+	assert(out != nullptr);
+
+	// Divided by 65536 then multiplied by 32767 and rounded, this matches the float kernels
+	// for every input value
+	for (unsigned int i = 0U; i < nSamples; i++)
+		out[i] = int16_t((int(in[i]) * 32767 + 32768) / 65536);
+}
+
+bool CAudioConvert::isNativeS16LE()
+{
+#if defined(AUDIO_BIG_ENDIAN)
+	return false;
+#else
+	return true;
+#endif
+}
+
+float CAudioConvert::dotProduct(const float* a, const float* b, unsigned int n)
+{
+	assert(a != nullptr);
+	assert(b != nullptr);
+
+	return m_dot(a, b, n);
+}
+
+void CAudioConvert::mixS16(const int16_t* in, int16_t gain, int32_t* bus, unsigned int nSamples)
+{
+	assert(in != nullptr);
+	assert(bus != nullptr);
+
+	m_mix(in, gain, bus, nSamples);
+}
+
+void CAudioConvert::measureS16(const int16_t* in, unsigned int nSamples, uint64_t& sumSquares, unsigned int& peak, unsigned int& clips)
+{
+	assert(in != nullptr);
+
+	m_measure(in, nSamples, sumSquares, peak, clips);
+}
+
+bool CAudioConvert::setKernels(const char* name)
+{
+	assert(name != nullptr);
+
+	if (::strcmp(name, "scalar") == 0) {
+		m_encode  = encodeScalar;
+		m_decode  = decodeScalar;
+		m_dot     = dotScalar;
+		m_mix     = mixScalar;
+		m_measure = measureScalar;
+		m_name    = "scalar";
+		return true;
+	}
+
+#if defined(AUDIO_X86)
+	if ((::strcmp(name, "AVX2") == 0) && hasAVX2()) {
+		m_encode  = encodeAVX2;
+		m_decode  = decodeAVX2;
+		m_dot     = dotAVX2;
+		m_mix     = mixAVX2;
+		m_measure = measureAVX2;
+		m_name    = "AVX2";
+		return true;
+	}
+
+	if (::strcmp(name, "SSE2") == 0) {
+		m_encode  = encodeSSE2;
+		m_decode  = decodeSSE2;
+		m_dot     = dotSSE2;
+		m_mix     = mixSSE2;
+		m_measure = measureSSE2;
+		m_name    = "SSE2";
+		return true;
+	}
+#elif defined(AUDIO_NEON)
+	if (::strcmp(name, "NEON") == 0) {
+		m_encode  = encodeNEON;
+		m_decode  = decodeNEON;
+		m_dot     = dotNEON;
+		m_mix     = mixNEON;
+		m_measure = measureNEON;
+		m_name    = "NEON";
+		return true;
+	}
+#endif
+
+	return false;
+}
+
+const char* CAudioConvert::getKernelName()
+{
+	return m_selected ? m_name : "scalar";
+}
@@ -0,0 +1,65 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(AudioConvert_H)
+#define	AudioConvert_H
+
+#include <cstdint>
+
+// Conversions between the float audio used inside the gateway and 16-bit PCM. Float audio is
+// multiplied by 32767 and saturated on the way out, 16-bit audio is divided by 65536 on the way
+// in. The fastest kernels that the CPU supports are chosen at start up.
+class CAudioConvert {
+public:
+	static void floatToS16(const float* in, int16_t* out, unsigned int nSamples);
+	static void floatToS16LE(const float* in, uint8_t* out, unsigned int nSamples);
+
+	static void s16ToFloat(const int16_t* in, float* out, unsigned int nSamples);
+	static void s16LEToFloat(const uint8_t* in, float* out, unsigned int nSamples);
+
+	// For S16LE audio held in two parts, such as a ring buffer span, returns the number of samples
+	static unsigned int s16LEToFloat(const uint8_t* data1, unsigned int length1, const uint8_t* data2, unsigned int length2, float* out);
+
+	// The integer path, these only change the byte order where needed
+	static void s16ToS16LE(const int16_t* in, uint8_t* out, unsigned int nSamples);
+	static void s16LEToS16(const uint8_t* in, int16_t* out, unsigned int nSamples);
+	static unsigned int s16LEToS16(const uint8_t* data1, unsigned int length1, const uint8_t* data2, unsigned int length2, int16_t* out);
+
+	// The same level change as a trip through float and back, in integers. It may work in place.
+	static void scaleS16(const int16_t* in, int16_t* out, unsigned int nSamples);
+
+	// True when int16_t audio in memory is already S16LE
+	static bool isNativeS16LE();
+
+	// The multiply and accumulate at the heart of the resampler filters
+	static float dotProduct(const float* a, const float* b, unsigned int n);
+
+	// Adds the audio, multiplied by a gain in Q12 so that 4096 is unity, to a mixing bus
+	static void mixS16(const int16_t* in, int16_t gain, int32_t* bus, unsigned int nSamples);
+
+	// Adds to the sum of the squares and the count of samples at full scale, and raises the peak
+	static void measureS16(const int16_t* in, unsigned int nSamples, uint64_t& sumSquares, unsigned int& peak, unsigned int& clips);
+
+	// Chooses the kernels by name, scalar or a set that the CPU supports, the checks use this to
+	// compare them. Returns false if the set is not available.
+	static bool setKernels(const char* name);
+
+	static const char* getKernelName();
+};
+
+#endif
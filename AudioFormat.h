@@ -0,0 +1,45 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(AudioFormat_H)
+#define	AudioFormat_H
+
+enum class AUDIO_ENCODING {
+	PCM_S16LE,
+	ULAW,
+	GSM
+};
+
+// How a network carries its audio on the wire, two links with the same format can pass the
+// audio bytes straight through
+struct AUDIO_FORMAT {
+	AUDIO_ENCODING encoding;
+	unsigned int   sampleRate;
+
+	bool operator==(const AUDIO_FORMAT& other) const
+	{
+		return (encoding == other.encoding) && (sampleRate == other.sampleRate);
+	}
+
+	bool operator!=(const AUDIO_FORMAT& other) const
+	{
+		return !(*this == other);
+	}
+};
+
+#endif
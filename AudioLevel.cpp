@@ -0,0 +1,108 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "AudioLevel.h"
+#include "AudioConvert.h"
+#include "Log.h"
+
+#include <cassert>
+#include <cmath>
+
+// The mean square of a full scale sine wave, the 0 dBFS reference for the RMS level
+const double FULL_SCALE_POWER = (32767.0 * 32767.0) / 2.0;
+const double FULL_SCALE_PEAK  = 32767.0;
+
+// Reported for digital silence, which has no level in decibels
+const double MIN_LEVEL = -100.0;
+
+static double toDB(double ratio, double multiplier)
+{
+	if (ratio <= 0.0)
+		return MIN_LEVEL;
+
+	double level = multiplier * std::log10(ratio);
+	if (level < MIN_LEVEL)
+		return MIN_LEVEL;
+
+	// One decimal place is plenty and keeps the JSON short
+	return std::round(level * 10.0) / 10.0;
+}
+
+CAudioLevel::CAudioLevel(unsigned int link, const char* direction, unsigned int sampleRate) :
+m_link(link),
+m_direction(direction),
+m_sampleRate(sampleRate),
+m_sumSquares(0U),
+m_peak(0U),
+m_clips(0U),
+m_samples(0U)
+{
+	assert(direction != nullptr);
+	assert(sampleRate > 0U);
+}
+
+CAudioLevel::~CAudioLevel()
+{
+}
+
+void CAudioLevel::add(const int16_t* data, unsigned int nSamples)
+{
+	assert(data != nullptr);
+
+	CAudioConvert::measureS16(data, nSamples, m_sumSquares, m_peak, m_clips);
+
+	m_samples += nSamples;
+}
+
+bool CAudioLevel::hasData() const
+{
+	return m_samples > 0U;
+}
+
+void CAudioLevel::publish()
+{
+	if (m_samples == 0U)
+		return;
+
+	double rms      = toDB((double(m_sumSquares) / double(m_samples)) / FULL_SCALE_POWER, 10.0);
+	double peak     = toDB(double(m_peak) / FULL_SCALE_PEAK, 20.0);
+	double duration = double(m_samples) / double(m_sampleRate);
+
+	LogDebug("Network %u, %s: %.2fs, RMS %.1f dBFS, peak %.1f dBFS, %u clipped samples", m_link + 1U, m_direction, duration, rms, peak, m_clips);
+
+	nlohmann::json json;
+
+	json["network"]   = m_link + 1U;
+	json["direction"] = m_direction;
+	json["duration"]  = std::round(duration * 100.0) / 100.0;
+	json["rms"]       = rms;
+	json["peak"]      = peak;
+	json["clips"]     = m_clips;
+
+	WriteJSON("audio", json);
+
+	reset();
+}
+
+void CAudioLevel::reset()
+{
+	m_sumSquares = 0U;
+	m_peak       = 0U;
+	m_clips      = 0U;
+	m_samples    = 0U;
+}
@@ -0,0 +1,50 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(AudioLevel_H)
+#define	AudioLevel_H
+
+#include <cstdint>
+
+// Meters the audio of one transmission in one direction, its RMS and peak levels and the number
+// of clipped samples, and publishes them over MQTT when the transmission ends.
+class CAudioLevel {
+public:
+	CAudioLevel(unsigned int link, const char* direction, unsigned int sampleRate);
+	~CAudioLevel();
+
+	void add(const int16_t* data, unsigned int nSamples);
+
+	bool hasData() const;
+
+	// Publishes the levels of the audio since the last call, if there was any, and starts again
+	void publish();
+
+	void reset();
+
+private:
+	unsigned int m_link;
+	const char*  m_direction;
+	unsigned int m_sampleRate;
+	uint64_t     m_sumSquares;
+	unsigned int m_peak;
+	unsigned int m_clips;
+	unsigned int m_samples;
+};
+
+#endif
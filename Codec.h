@@ -0,0 +1,44 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef	Codec_H
+#define	Codec_H
+
+#include <cstdint>
+
+// An audio codec for the IAX network, identified by its Asterisk format bit
+class ICodec {
+public:
+	virtual ~ICodec() = 0;
+
+	virtual uint32_t getFormat() const = 0;
+
+	virtual const char* getName() const = 0;
+
+	// Returns the number of bytes written to the buffer
+	virtual unsigned int encode(const int16_t* audio, unsigned int nSamples, uint8_t* buffer) = 0;
+
+	// Returns the number of samples written, no more than nAudio
+	virtual unsigned int decode(const uint8_t* buffer, unsigned int length, int16_t* audio, unsigned int nAudio) = 0;
+
+	virtual void reset() = 0;
+
+private:
+};
+
+#endif
@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2015,2016,2017,2018,2020,2021,2024,2025 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2015,2016,2017,2018,2020,2021,2024,2025,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -23,9 +23,13 @@
 #include <cstdlib>
 #include <cstring>
 #include <cctype>
+#include <cassert>
 
 const int BUFFER_SIZE = 500;
 
+// The highest link number that may be given in a section name
+const int MAX_LINKS = 64;
+
 enum class SECTION {
 	NONE,
 	GENERAL,
@@ -37,12 +41,48 @@ enum class SECTION {
 	IAX_NETWORK
 };
 
+// Matches "[<name>]" which is the first link, or "[<name> N]" which is link N counting from one
+static bool matchSection(const char* buffer, const char* name, unsigned int& link)
+{
+	size_t len = ::strlen(name);
+	if (::strncmp(buffer + 1U, name, len) != 0)
+		return false;
+
+	const char* p = buffer + 1U + len;
+	if (*p == ']') {
+		link = 0U;
+		return true;
+	}
+
+	if (*p != ' ')
+		return false;
+
+	int n = ::atoi(p + 1U);
+	if (n <= 0)
+		return false;
+
+	if (n > MAX_LINKS) {
+		::fprintf(stderr, "Link %d is above the highest allowed, %d, the section is ignored\n", n, MAX_LINKS);
+		return false;
+	}
+
+	link = (unsigned int)(n - 1);
+	return true;
+}
+
 CConf::CConf(const std::string& file) :
 m_file(file),
 m_callsign(),
-m_protocol("USRP"),
+m_protocols(),
 m_debug(false),
 m_daemon(false),
+m_passThrough(false),
+m_dtx(false),
+m_dtxThreshold(-50),
+m_dtxHangover(300U),
+m_playoutDelay(40U),
+m_threads(0U),
+m_cpus(),
 m_logDisplayLevel(0U),
 m_logMQTTLevel(0U),
 m_mqttAddress("127.0.0.1"),
@@ -52,6 +92,17 @@ m_mqttName("fm-gateway"),
 m_mqttAuthEnabled(false),
 m_mqttUsername(),
 m_mqttPassword(),
+m_links(1U)
+{
+}
+
+CConf::~CConf()
+{
+}
+
+CConf::LINK::LINK() :
+m_networkSection(false),
+m_protocols(),
 m_networkLocalAddress("127.0.0.1"),
 m_networkLocalPort(0U),
 m_networkRptAddress("127.0.0.1"),
@@ -61,6 +112,7 @@ m_usrpLocalAddress("127.0.0.1"),
 m_usrpLocalPort(0U),
 m_usrpRemoteAddress("127.0.0.1"),
 m_usrpRemotePort(0U),
+m_usrpGain(0),
 m_usrpDebug(false),
 m_rawLocalAddress("127.0.0.1"),
 m_rawLocalPort(0U),
@@ -68,6 +120,7 @@ m_rawRemoteAddress("127.0.0.1"),
 m_rawRemotePort(0U),
 m_rawSampleRate(8000U),
 m_rawSquelchFile(),
+m_rawGain(0),
 m_rawDebug(false),
 m_iaxLocalAddress("127.0.0.1"),
 m_iaxLocalPort(0U),
@@ -76,14 +129,16 @@ m_iaxRemotePort(0U),
 m_iaxUsername(),
 m_iaxPassword(),
 m_iaxNode(),
+m_iaxCodec("ULAW"),
+m_iaxGain(0),
+m_iaxInbound(false),
+m_iaxTrunk(false),
+m_iaxShards(1U),
+m_iaxCPUs(),
 m_iaxDebug(false)
 {
 }
 
-CConf::~CConf()
-{
-}
-
 bool CConf::read()
 {
 	FILE* fp = ::fopen(m_file.c_str(), "rt");
@@ -93,6 +148,7 @@ bool CConf::read()
 	}
 
 	SECTION section = SECTION::NONE;
+	unsigned int link = 0U;
 
 	char buffer[BUFFER_SIZE];
 	while (::fgets(buffer, BUFFER_SIZE, fp) != nullptr) {
@@ -106,17 +162,23 @@ bool CConf::read()
 				section = SECTION::LOG;
 			else if (::strncmp(buffer, "[MQTT]", 6U) == 0)
 				section = SECTION::MQTT;
-			else if (::strncmp(buffer, "[Network]", 9U) == 0)
+			else if (matchSection(buffer, "Network", link))
 				section = SECTION::NETWORK;
-			else if (::strncmp(buffer, "[USRP Network]", 14U) == 0)
+			else if (matchSection(buffer, "USRP Network", link))
 				section = SECTION::USRP_NETWORK;
-			else if (::strncmp(buffer, "[RAW Network]", 13U) == 0)
+			else if (matchSection(buffer, "RAW Network", link))
 				section = SECTION::RAW_NETWORK;
-			else if (::strncmp(buffer, "[IAX Network]", 13U) == 0)
+			else if (matchSection(buffer, "IAX Network", link))
 				section = SECTION::IAX_NETWORK;
 			else
 				section = SECTION::NONE;
 
+			if (link >= m_links.size())
+				m_links.resize(link + 1U);
+
+			if (section == SECTION::NETWORK)
+				m_links[link].m_networkSection = true;
+
 			continue;
 		}
 
@@ -148,12 +210,36 @@ bool CConf::read()
 		if (section == SECTION::GENERAL) {
 			if (::strcmp(key, "Callsign") == 0)
 				m_callsign = value;
-			else if (::strcmp(key, "Protocol") == 0)
-				m_protocol = value;
+			else if (::strcmp(key, "Protocol") == 0) {
+				char* p = ::strtok(value, ", ");
+				while (p != nullptr) {
+					m_protocols.push_back(p);
+					p = ::strtok(nullptr, ", ");
+				}
+			}
 			else if (::strcmp(key, "Debug") == 0)
 				m_debug = ::atoi(value) == 1;
 			else if (::strcmp(key, "Daemon") == 0)
 				m_daemon = ::atoi(value) == 1;
+			else if (::strcmp(key, "PassThrough") == 0)
+				m_passThrough = ::atoi(value) == 1;
+			else if (::strcmp(key, "DTX") == 0)
+				m_dtx = ::atoi(value) == 1;
+			else if (::strcmp(key, "DTXThreshold") == 0)
+				m_dtxThreshold = ::atoi(value);
+			else if (::strcmp(key, "DTXHangover") == 0)
+				m_dtxHangover = (unsigned int)::atoi(value);
+			else if (::strcmp(key, "PlayoutDelay") == 0)
+				m_playoutDelay = (unsigned int)::atoi(value);
+			else if (::strcmp(key, "Threads") == 0)
+				m_threads = (unsigned int)::atoi(value);
+			else if (::strcmp(key, "CPUs") == 0) {
+				char* p = ::strtok(value, ", ");
+				while (p != nullptr) {
+					m_cpus.push_back((unsigned int)::atoi(p));
+					p = ::strtok(nullptr, ", ");
+				}
+			}
 		} else if (section == SECTION::LOG) {
 			if (::strcmp(key, "DisplayLevel") == 0)
 				m_logDisplayLevel = (unsigned int)::atoi(value);
@@ -175,59 +261,85 @@ bool CConf::read()
 			else if (::strcmp(key, "Password") == 0)
 				m_mqttPassword = value;
 		} else if (section == SECTION::NETWORK) {
-			if (::strcmp(key, "LocalAddress") == 0)
-				m_networkLocalAddress = value;
+			if (::strcmp(key, "Protocol") == 0) {
+				char* p = ::strtok(value, ", ");
+				while (p != nullptr) {
+					m_links[link].m_protocols.push_back(p);
+					p = ::strtok(nullptr, ", ");
+				}
+			} else if (::strcmp(key, "LocalAddress") == 0)
+				m_links[link].m_networkLocalAddress = value;
 			else if (::strcmp(key, "LocalPort") == 0)
-				m_networkLocalPort = uint16_t(::atoi(value));
+				m_links[link].m_networkLocalPort = uint16_t(::atoi(value));
 			else if (::strcmp(key, "RptAddress") == 0)
-				m_networkRptAddress = value;
+				m_links[link].m_networkRptAddress = value;
 			else if (::strcmp(key, "RptPort") == 0)
-				m_networkRptPort = uint16_t(::atoi(value));
+				m_links[link].m_networkRptPort = uint16_t(::atoi(value));
 			else if (::strcmp(key, "Debug") == 0)
-				m_networkDebug = ::atoi(value) == 1;
+				m_links[link].m_networkDebug = ::atoi(value) == 1;
 		} else if (section == SECTION::USRP_NETWORK) {
 			if (::strcmp(key, "LocalAddress") == 0)
-				m_usrpLocalAddress = value;
+				m_links[link].m_usrpLocalAddress = value;
 			else if (::strcmp(key, "LocalPort") == 0)
-				m_usrpLocalPort = uint16_t(::atoi(value));
+				m_links[link].m_usrpLocalPort = uint16_t(::atoi(value));
 			else if (::strcmp(key, "RemoteAddress") == 0)
-				m_usrpRemoteAddress = value;
+				m_links[link].m_usrpRemoteAddress = value;
 			else if (::strcmp(key, "RemotePort") == 0)
-				m_usrpRemotePort = uint16_t(::atoi(value));
+				m_links[link].m_usrpRemotePort = uint16_t(::atoi(value));
+			else if (::strcmp(key, "Gain") == 0)
+				m_links[link].m_usrpGain = ::atoi(value);
 			else if (::strcmp(key, "Debug") == 0)
-				m_usrpDebug = ::atoi(value) == 1;
+				m_links[link].m_usrpDebug = ::atoi(value) == 1;
 		} else if (section == SECTION::RAW_NETWORK) {
 			if (::strcmp(key, "LocalAddress") == 0)
-				m_rawLocalAddress = value;
+				m_links[link].m_rawLocalAddress = value;
 			else if (::strcmp(key, "LocalPort") == 0)
-				m_rawLocalPort = uint16_t(::atoi(value));
+				m_links[link].m_rawLocalPort = uint16_t(::atoi(value));
 			else if (::strcmp(key, "RemoteAddress") == 0)
-				m_rawRemoteAddress = value;
+				m_links[link].m_rawRemoteAddress = value;
 			else if (::strcmp(key, "RemotePort") == 0)
-				m_rawRemotePort = uint16_t(::atoi(value));
+				m_links[link].m_rawRemotePort = uint16_t(::atoi(value));
 			else if (::strcmp(key, "SampleRate") == 0)
-				m_rawSampleRate = (unsigned int)::atoi(value);
+				m_links[link].m_rawSampleRate = (unsigned int)::atoi(value);
 			else if (::strcmp(key, "SquelchFile") == 0)
-				m_rawSquelchFile = value;
+				m_links[link].m_rawSquelchFile = value;
+			else if (::strcmp(key, "Gain") == 0)
+				m_links[link].m_rawGain = ::atoi(value);
 			else if (::strcmp(key, "Debug") == 0)
-				m_rawDebug = ::atoi(value) == 1;
+				m_links[link].m_rawDebug = ::atoi(value) == 1;
 		} else if (section == SECTION::IAX_NETWORK) {
 			if (::strcmp(key, "LocalAddress") == 0)
-				m_iaxLocalAddress = value;
+				m_links[link].m_iaxLocalAddress = value;
 			else if (::strcmp(key, "LocalPort") == 0)
-				m_iaxLocalPort = uint16_t(::atoi(value));
+				m_links[link].m_iaxLocalPort = uint16_t(::atoi(value));
 			else if (::strcmp(key, "RemoteAddress") == 0)
-				m_iaxRemoteAddress = value;
+				m_links[link].m_iaxRemoteAddress = value;
 			else if (::strcmp(key, "RemotePort") == 0)
-				m_iaxRemotePort = uint16_t(::atoi(value));
+				m_links[link].m_iaxRemotePort = uint16_t(::atoi(value));
 			else if (::strcmp(key, "Username") == 0)
-				m_iaxUsername = value;
+				m_links[link].m_iaxUsername = value;
 			else if (::strcmp(key, "Password") == 0)
-				m_iaxPassword = value;
+				m_links[link].m_iaxPassword = value;
 			else if (::strcmp(key, "Node") == 0)
-				m_iaxNode = value;
-			else if (::strcmp(key, "Debug") == 0)
-				m_iaxDebug = ::atoi(value) == 1;
+				m_links[link].m_iaxNode = value;
+			else if (::strcmp(key, "Codec") == 0)
+				m_links[link].m_iaxCodec = value;
+			else if (::strcmp(key, "Gain") == 0)
+				m_links[link].m_iaxGain = ::atoi(value);
+			else if (::strcmp(key, "Inbound") == 0)
+				m_links[link].m_iaxInbound = ::atoi(value) == 1;
+			else if (::strcmp(key, "Trunk") == 0)
+				m_links[link].m_iaxTrunk = ::atoi(value) == 1;
+			else if (::strcmp(key, "Shards") == 0)
+				m_links[link].m_iaxShards = (unsigned int)::atoi(value);
+			else if (::strcmp(key, "CPUs") == 0) {
+				char* p = ::strtok(value, ", ");
+				while (p != nullptr) {
+					m_links[link].m_iaxCPUs.push_back((unsigned int)::atoi(p));
+					p = ::strtok(nullptr, ", ");
+				}
+			} else if (::strcmp(key, "Debug") == 0)
+				m_links[link].m_iaxDebug = ::atoi(value) == 1;
 		}
 	}
 
@@ -241,11 +353,6 @@ std::string CConf::getCallsign() const
 	return m_callsign;
 }
 
-std::string CConf::getProtocol() const
-{
-	return m_protocol;
-}
-
 bool CConf::getDebug() const
 {
 	return m_debug;
@@ -256,6 +363,41 @@ bool CConf::getDaemon() const
 	return m_daemon;
 }
 
+bool CConf::getPassThrough() const
+{
+	return m_passThrough;
+}
+
+bool CConf::getDTX() const
+{
+	return m_dtx;
+}
+
+int CConf::getDTXThreshold() const
+{
+	return m_dtxThreshold;
+}
+
+unsigned int CConf::getDTXHangover() const
+{
+	return m_dtxHangover;
+}
+
+unsigned int CConf::getPlayoutDelay() const
+{
+	return m_playoutDelay;
+}
+
+unsigned int CConf::getThreads() const
+{
+	return m_threads;
+}
+
+std::vector<unsigned int> CConf::getCPUs() const
+{
+	return m_cpus;
+}
+
 unsigned int CConf::getLogDisplayLevel() const
 {
 	return m_logDisplayLevel;
@@ -301,127 +443,259 @@ std::string CConf::getMQTTPassword() const
 	return m_mqttPassword;
 }
 
-std::string CConf::getNetworkLocalAddress() const
+unsigned int CConf::getLinkCount() const
 {
-	return m_networkLocalAddress;
+	return (unsigned int)m_links.size();
 }
 
-uint16_t CConf::getNetworkLocalPort() const
+bool CConf::hasNetworkSection(unsigned int link) const
 {
-	return m_networkLocalPort;
+	assert(link < m_links.size());
+
+	return m_links[link].m_networkSection;
 }
 
-std::string CConf::getNetworkRptAddress() const
+std::vector<std::string> CConf::getProtocols(unsigned int link) const
 {
-	return m_networkRptAddress;
+	assert(link < m_links.size());
+
+	// A link without its own protocols uses those from the General section, or USRP when none are given
+	if (!m_links[link].m_protocols.empty())
+		return m_links[link].m_protocols;
+
+	if (!m_protocols.empty())
+		return m_protocols;
+
+	return std::vector<std::string>(1U, "USRP");
 }
 
-uint16_t CConf::getNetworkRptPort() const
+std::string CConf::getNetworkLocalAddress(unsigned int link) const
 {
-	return m_networkRptPort;
+	assert(link < m_links.size());
+
+	return m_links[link].m_networkLocalAddress;
 }
 
-bool CConf::getNetworkDebug() const
+uint16_t CConf::getNetworkLocalPort(unsigned int link) const
 {
-	return m_networkDebug;
+	assert(link < m_links.size());
+
+	return m_links[link].m_networkLocalPort;
 }
 
-std::string CConf::getUSRPLocalAddress() const
+std::string CConf::getNetworkRptAddress(unsigned int link) const
 {
-	return m_usrpLocalAddress;
+	assert(link < m_links.size());
+
+	return m_links[link].m_networkRptAddress;
 }
 
-uint16_t CConf::getUSRPLocalPort() const
+uint16_t CConf::getNetworkRptPort(unsigned int link) const
 {
-	return m_usrpLocalPort;
+	assert(link < m_links.size());
+
+	return m_links[link].m_networkRptPort;
 }
 
-std::string CConf::getUSRPRemoteAddress() const
+bool CConf::getNetworkDebug(unsigned int link) const
 {
-	return m_usrpRemoteAddress;
+	assert(link < m_links.size());
+
+	return m_links[link].m_networkDebug;
+}
+
+std::string CConf::getUSRPLocalAddress(unsigned int link) const
+{
+	assert(link < m_links.size());
+
+	return m_links[link].m_usrpLocalAddress;
+}
+
+uint16_t CConf::getUSRPLocalPort(unsigned int link) const
+{
+	assert(link < m_links.size());
+
+	return m_links[link].m_usrpLocalPort;
+}
+
+std::string CConf::getUSRPRemoteAddress(unsigned int link) const
+{
+	assert(link < m_links.size());
+
+	return m_links[link].m_usrpRemoteAddress;
+}
+
+uint16_t CConf::getUSRPRemotePort(unsigned int link) const
+{
+	assert(link < m_links.size());
+
+	return m_links[link].m_usrpRemotePort;
+}
+
+int CConf::getUSRPGain(unsigned int link) const
+{
+	assert(link < m_links.size());
+
+	return m_links[link].m_usrpGain;
+}
+
+bool CConf::getUSRPDebug(unsigned int link) const
+{
+	assert(link < m_links.size());
+
+	return m_links[link].m_usrpDebug;
+}
+
+std::string CConf::getRAWLocalAddress(unsigned int link) const
+{
+	assert(link < m_links.size());
+
+	return m_links[link].m_rawLocalAddress;
+}
+
+uint16_t CConf::getRAWLocalPort(unsigned int link) const
+{
+	assert(link < m_links.size());
+
+	return m_links[link].m_rawLocalPort;
 }
 
-uint16_t CConf::getUSRPRemotePort() const
+std::string CConf::getRAWRemoteAddress(unsigned int link) const
 {
-	return m_usrpRemotePort;
+	assert(link < m_links.size());
+
+	return m_links[link].m_rawRemoteAddress;
 }
 
-bool CConf::getUSRPDebug() const
+uint16_t CConf::getRAWRemotePort(unsigned int link) const
 {
-	return m_usrpDebug;
+	assert(link < m_links.size());
+
+	return m_links[link].m_rawRemotePort;
 }
 
-std::string CConf::getRAWLocalAddress() const
+unsigned int CConf::getRAWSampleRate(unsigned int link) const
 {
-	return m_rawLocalAddress;
+	assert(link < m_links.size());
+
+	return m_links[link].m_rawSampleRate;
 }
 
-uint16_t CConf::getRAWLocalPort() const
+std::string CConf::getRAWSquelchFile(unsigned int link) const
 {
-	return m_rawLocalPort;
+	assert(link < m_links.size());
+
+	return m_links[link].m_rawSquelchFile;
 }
 
-std::string CConf::getRAWRemoteAddress() const
+int CConf::getRAWGain(unsigned int link) const
 {
-	return m_rawRemoteAddress;
+	assert(link < m_links.size());
+
+	return m_links[link].m_rawGain;
 }
 
-uint16_t CConf::getRAWRemotePort() const
+bool CConf::getRAWDebug(unsigned int link) const
 {
-	return m_rawRemotePort;
+	assert(link < m_links.size());
+
+	return m_links[link].m_rawDebug;
 }
 
-unsigned int CConf::getRAWSampleRate() const
+std::string CConf::getIAXLocalAddress(unsigned int link) const
 {
-	return m_rawSampleRate;
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxLocalAddress;
 }
 
-std::string CConf::getRAWSquelchFile() const
+uint16_t CConf::getIAXLocalPort(unsigned int link) const
 {
-	return m_rawSquelchFile;
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxLocalPort;
 }
 
-bool CConf::getRAWDebug() const
+std::string CConf::getIAXRemoteAddress(unsigned int link) const
 {
-	return m_rawDebug;
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxRemoteAddress;
 }
 
-std::string CConf::getIAXLocalAddress() const
+uint16_t CConf::getIAXRemotePort(unsigned int link) const
 {
-	return m_iaxLocalAddress;
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxRemotePort;
 }
 
-uint16_t CConf::getIAXLocalPort() const
+std::string CConf::getIAXUsername(unsigned int link) const
 {
-	return m_iaxLocalPort;
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxUsername;
 }
 
-std::string CConf::getIAXRemoteAddress() const
+std::string CConf::getIAXPassword(unsigned int link) const
 {
-	return m_iaxRemoteAddress;
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxPassword;
 }
 
-uint16_t CConf::getIAXRemotePort() const
+std::string CConf::getIAXNode(unsigned int link) const
 {
-	return m_iaxRemotePort;
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxNode;
 }
 
-std::string CConf::getIAXUsername() const
+std::string CConf::getIAXCodec(unsigned int link) const
 {
-	return m_iaxUsername;
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxCodec;
 }
 
-std::string CConf::getIAXPassword() const
+int CConf::getIAXGain(unsigned int link) const
 {
-	return m_iaxPassword;
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxGain;
+}
+
+bool CConf::getIAXInbound(unsigned int link) const
+{
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxInbound;
 }
 
-std::string CConf::getIAXNode() const
+bool CConf::getIAXTrunk(unsigned int link) const
 {
-	return m_iaxNode;
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxTrunk;
 }
 
-bool CConf::getIAXDebug() const
+unsigned int CConf::getIAXShards(unsigned int link) const
 {
-	return m_iaxDebug;
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxShards;
+}
+
+std::vector<unsigned int> CConf::getIAXCPUs(unsigned int link) const
+{
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxCPUs;
+}
+
+bool CConf::getIAXDebug(unsigned int link) const
+{
+	assert(link < m_links.size());
+
+	return m_links[link].m_iaxDebug;
 }
@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2015,2016,2017,2018,2020,2021,2024,2025 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2015,2016,2017,2018,2020,2021,2024,2025,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -20,6 +20,7 @@
 #define	CONF_H
 
 #include <string>
+#include <vector>
 
 #include <cstdint>
 
@@ -33,9 +34,15 @@ public:
 
 	// The General section
 	std::string  getCallsign() const;
-	std::string  getProtocol() const;
 	bool         getDebug() const;
 	bool         getDaemon() const;
+	bool         getPassThrough() const;
+	bool         getDTX() const;
+	int          getDTXThreshold() const;
+	unsigned int getDTXHangover() const;
+	unsigned int getPlayoutDelay() const;
+	unsigned int getThreads() const;
+	std::vector<unsigned int> getCPUs() const;
 
 	// The Log section
 	unsigned int getLogDisplayLevel() const;
@@ -50,45 +57,65 @@ public:
 	std::string  getMQTTUsername() const;
 	std::string  getMQTTPassword() const;
 
-	// The Network section
-	std::string  getNetworkLocalAddress() const;
-	uint16_t     getNetworkLocalPort() const;
-	std::string  getNetworkRptAddress() const;
-	uint16_t     getNetworkRptPort() const;
-	bool         getNetworkDebug() const;
-
-	// The USRP Network section
-	std::string  getUSRPLocalAddress() const;
-	uint16_t     getUSRPLocalPort() const;
-	std::string  getUSRPRemoteAddress() const;
-	uint16_t     getUSRPRemotePort() const;
-	bool         getUSRPDebug() const;
-
-	// The RAW Network section
-	std::string  getRAWLocalAddress() const;
-	uint16_t     getRAWLocalPort() const;
-	std::string  getRAWRemoteAddress() const;
-	uint16_t     getRAWRemotePort() const;
-	unsigned int getRAWSampleRate() const;
-	std::string  getRAWSquelchFile() const;
-	bool         getRAWDebug() const;
-
-	// The IAX Network section
-	std::string  getIAXLocalAddress() const;
-	uint16_t     getIAXLocalPort() const;
-	std::string  getIAXRemoteAddress() const;
-	uint16_t     getIAXRemotePort() const;
-	std::string  getIAXUsername() const;
-	std::string  getIAXPassword() const;
-	std::string  getIAXNode() const;
-	bool         getIAXDebug() const;
+	// The Network sections, [Network] or [Network 1] is the first link, [Network 2] the second, and so on.
+	// The protocol sections are numbered in the same way.
+	unsigned int getLinkCount() const;
+	// False for a link that is only there because a later one was numbered past it
+	bool         hasNetworkSection(unsigned int link) const;
+	std::vector<std::string> getProtocols(unsigned int link) const;
+	std::string  getNetworkLocalAddress(unsigned int link) const;
+	uint16_t     getNetworkLocalPort(unsigned int link) const;
+	std::string  getNetworkRptAddress(unsigned int link) const;
+	uint16_t     getNetworkRptPort(unsigned int link) const;
+	bool         getNetworkDebug(unsigned int link) const;
+
+	// The USRP Network sections
+	std::string  getUSRPLocalAddress(unsigned int link) const;
+	uint16_t     getUSRPLocalPort(unsigned int link) const;
+	std::string  getUSRPRemoteAddress(unsigned int link) const;
+	uint16_t     getUSRPRemotePort(unsigned int link) const;
+	int          getUSRPGain(unsigned int link) const;
+	bool         getUSRPDebug(unsigned int link) const;
+
+	// The RAW Network sections
+	std::string  getRAWLocalAddress(unsigned int link) const;
+	uint16_t     getRAWLocalPort(unsigned int link) const;
+	std::string  getRAWRemoteAddress(unsigned int link) const;
+	uint16_t     getRAWRemotePort(unsigned int link) const;
+	unsigned int getRAWSampleRate(unsigned int link) const;
+	std::string  getRAWSquelchFile(unsigned int link) const;
+	int          getRAWGain(unsigned int link) const;
+	bool         getRAWDebug(unsigned int link) const;
+
+	// The IAX Network sections
+	std::string  getIAXLocalAddress(unsigned int link) const;
+	uint16_t     getIAXLocalPort(unsigned int link) const;
+	std::string  getIAXRemoteAddress(unsigned int link) const;
+	uint16_t     getIAXRemotePort(unsigned int link) const;
+	std::string  getIAXUsername(unsigned int link) const;
+	std::string  getIAXPassword(unsigned int link) const;
+	std::string  getIAXNode(unsigned int link) const;
+	std::string  getIAXCodec(unsigned int link) const;
+	int          getIAXGain(unsigned int link) const;
+	bool         getIAXInbound(unsigned int link) const;
+	bool         getIAXTrunk(unsigned int link) const;
+	unsigned int getIAXShards(unsigned int link) const;
+	std::vector<unsigned int> getIAXCPUs(unsigned int link) const;
+	bool         getIAXDebug(unsigned int link) const;
 
 private:
 	std::string  m_file;
 	std::string  m_callsign;
-	std::string  m_protocol;
+	std::vector<std::string> m_protocols;
 	bool         m_debug;
 	bool         m_daemon;
+	bool         m_passThrough;
+	bool         m_dtx;
+	int          m_dtxThreshold;
+	unsigned int m_dtxHangover;
+	unsigned int m_playoutDelay;
+	unsigned int m_threads;
+	std::vector<unsigned int> m_cpus;
 
 	unsigned int m_logDisplayLevel;
 	unsigned int m_logMQTTLevel;
@@ -101,34 +128,51 @@ private:
 	std::string  m_mqttUsername;
 	std::string  m_mqttPassword;
 
-	std::string  m_networkLocalAddress;
-	uint16_t     m_networkLocalPort;
-	std::string  m_networkRptAddress;
-	uint16_t     m_networkRptPort;
-	bool         m_networkDebug;
-
-	std::string  m_usrpLocalAddress;
-	uint16_t     m_usrpLocalPort;
-	std::string  m_usrpRemoteAddress;
-	uint16_t     m_usrpRemotePort;
-	bool         m_usrpDebug;
-
-	std::string  m_rawLocalAddress;
-	uint16_t     m_rawLocalPort;
-	std::string  m_rawRemoteAddress;
-	uint16_t     m_rawRemotePort;
-	unsigned int m_rawSampleRate;
-	std::string  m_rawSquelchFile;
-	bool         m_rawDebug;
-
-	std::string  m_iaxLocalAddress;
-	uint16_t     m_iaxLocalPort;
-	std::string  m_iaxRemoteAddress;
-	uint16_t     m_iaxRemotePort;
-	std::string  m_iaxUsername;
-	std::string  m_iaxPassword;
-	std::string  m_iaxNode;
-	bool         m_iaxDebug;
+	struct LINK {
+		LINK();
+
+		bool         m_networkSection;
+		std::vector<std::string> m_protocols;
+
+		std::string  m_networkLocalAddress;
+		uint16_t     m_networkLocalPort;
+		std::string  m_networkRptAddress;
+		uint16_t     m_networkRptPort;
+		bool         m_networkDebug;
+
+		std::string  m_usrpLocalAddress;
+		uint16_t     m_usrpLocalPort;
+		std::string  m_usrpRemoteAddress;
+		uint16_t     m_usrpRemotePort;
+		int          m_usrpGain;
+		bool         m_usrpDebug;
+
+		std::string  m_rawLocalAddress;
+		uint16_t     m_rawLocalPort;
+		std::string  m_rawRemoteAddress;
+		uint16_t     m_rawRemotePort;
+		unsigned int m_rawSampleRate;
+		std::string  m_rawSquelchFile;
+		int          m_rawGain;
+		bool         m_rawDebug;
+
+		std::string  m_iaxLocalAddress;
+		uint16_t     m_iaxLocalPort;
+		std::string  m_iaxRemoteAddress;
+		uint16_t     m_iaxRemotePort;
+		std::string  m_iaxUsername;
+		std::string  m_iaxPassword;
+		std::string  m_iaxNode;
+		std::string  m_iaxCodec;
+		int          m_iaxGain;
+		bool         m_iaxInbound;
+		bool         m_iaxTrunk;
+		unsigned int m_iaxShards;
+		std::vector<unsigned int> m_iaxCPUs;
+		bool         m_iaxDebug;
+	};
+
+	std::vector<LINK> m_links;
 };
 
 #endif
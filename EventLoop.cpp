@@ -0,0 +1,284 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "EventLoop.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <Windows.h>
+#else
+#include <sys/timerfd.h>
+#include <cerrno>
+#include <cstdint>
+#include <poll.h>
+#include <ctime>
+#include <unistd.h>
+#endif
+
+CEventLoop::CEventLoop() :
+m_sockets(),
+m_groups(),
+m_wakeups(),
+m_wakeupGroups(),
+m_pfdGroups(),
+m_ready(),
+m_group(0U),
+m_pfds()
+#if !defined(_WIN32) && !defined(_WIN64)
+,m_timerFd(-1)
+#endif
+{
+}
+
+CEventLoop::~CEventLoop()
+{
+}
+
+bool CEventLoop::open()
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	assert(m_timerFd == -1);
+
+	m_timerFd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (m_timerFd < 0) {
+		LogError("Cannot create the event loop timer, err: %d", errno);
+		return false;
+	}
+#endif
+
+	// The first entry is for the timer
+	m_pfds.resize(m_sockets.size() + m_wakeups.size() + 1U);
+	m_pfdGroups.resize(m_sockets.size() + m_wakeups.size() + 1U);
+
+	return true;
+}
+
+void CEventLoop::setGroup(unsigned int group)
+{
+	m_group = group;
+}
+
+void CEventLoop::addSocket(CUDPSocket& socket)
+{
+	m_sockets.push_back(&socket);
+	m_groups.push_back(m_group);
+
+	// Sized here so that waiting never allocates
+	m_pfds.resize(m_sockets.size() + m_wakeups.size() + 1U);
+	m_pfdGroups.resize(m_sockets.size() + m_wakeups.size() + 1U);
+
+	if (m_group >= m_ready.size())
+		m_ready.resize(m_group + 1U);
+}
+
+void CEventLoop::addWakeup(CWakeup& wakeup)
+{
+	m_wakeups.push_back(&wakeup);
+	m_wakeupGroups.push_back(m_group);
+
+	m_pfds.resize(m_sockets.size() + m_wakeups.size() + 1U);
+	m_pfdGroups.resize(m_sockets.size() + m_wakeups.size() + 1U);
+
+	if (m_group >= m_ready.size())
+		m_ready.resize(m_group + 1U);
+}
+
+bool CEventLoop::isReady(unsigned int group) const
+{
+	return (group < m_ready.size()) && m_ready[group];
+}
+
+bool CEventLoop::wait(unsigned int ms)
+{
+	return waitUntil(now() + ms * 1000000ULL);
+}
+
+bool CEventLoop::waitUntil(unsigned long long deadline)
+{
+	// Anything queued during this pass must go before blocking
+	for (std::vector<CUDPSocket*>::const_iterator it = m_sockets.cbegin(); it != m_sockets.cend(); ++it)
+		(*it)->flush();
+
+#if defined(_WIN32) || defined(_WIN64)
+	std::fill(m_ready.begin(), m_ready.end(), false);
+
+	WSAPOLLFD* pfds = m_pfds.data();
+	ULONG n = 0U;
+
+	// The sockets are looked up on every call as they may have been re-opened. There are no
+	// wake ups, as CWakeup cannot be opened on Windows.
+	for (unsigned int i = 0U; i < m_sockets.size(); i++) {
+		SOCKET fd = m_sockets[i]->getFd();
+		if (fd == INVALID_SOCKET)
+			continue;
+
+		pfds[n].fd      = fd;
+		pfds[n].events  = POLLIN;
+		pfds[n].revents = 0;
+		m_pfdGroups[n]  = m_groups[i];
+		n++;
+	}
+
+	// There is no absolute timer, so round up to whole milliseconds so as not to wake early
+	unsigned long long current = now();
+	int ms = 0;
+	if (deadline > current)
+		ms = int((deadline - current + 999999ULL) / 1000000ULL);
+
+	if (n == 0U) {
+		::Sleep(DWORD(ms));
+		return true;
+	}
+
+	int ret = ::WSAPoll(pfds, n, ms);
+	if (ret < 0) {
+		LogError("Error returned from the event loop poll, err: %lu", ::GetLastError());
+		return false;
+	}
+
+	for (ULONG i = 0U; i < n; i++) {
+		if (pfds[i].revents != 0)
+			m_ready[m_pfdGroups[i]] = true;
+	}
+
+	return true;
+#else
+	assert(m_timerFd >= 0);
+
+	std::fill(m_ready.begin(), m_ready.end(), false);
+
+	struct pollfd* pfds = m_pfds.data();
+	nfds_t n = 0U;
+
+	pfds[n].fd      = m_timerFd;
+	pfds[n].events  = POLLIN;
+	pfds[n].revents = 0;
+	n++;
+
+	// The wake ups follow the timer
+	for (unsigned int i = 0U; i < m_wakeups.size(); i++) {
+		pfds[n].fd      = m_wakeups[i]->getFd();
+		pfds[n].events  = POLLIN;
+		pfds[n].revents = 0;
+		m_pfdGroups[n]  = m_wakeupGroups[i];
+		n++;
+	}
+
+	// The sockets are looked up on every call as they may have been re-opened
+	for (unsigned int i = 0U; i < m_sockets.size(); i++) {
+		int fd = m_sockets[i]->getFd();
+		if (fd < 0)
+			continue;
+
+		pfds[n].fd      = fd;
+		pfds[n].events  = POLLIN;
+		pfds[n].revents = 0;
+		m_pfdGroups[n]  = m_groups[i];
+		n++;
+	}
+
+	// An absolute expiry doesn't drift however long this pass took, one in the past expires at once
+	struct itimerspec its;
+	::memset(&its, 0x00U, sizeof(struct itimerspec));
+	its.it_value.tv_sec  = time_t(deadline / 1000000000ULL);
+	its.it_value.tv_nsec = long(deadline % 1000000000ULL);
+
+	// An all zero value disarms the timer
+	if ((its.it_value.tv_sec == 0) && (its.it_value.tv_nsec == 0))
+		its.it_value.tv_nsec = 1;
+
+	if (::timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &its, nullptr) < 0) {
+		LogError("Cannot set the event loop timer, err: %d", errno);
+		return false;
+	}
+
+	int ret = ::poll(pfds, n, -1);
+	if (ret < 0) {
+		// A signal is not an error, the caller checks its own flags
+		if (errno == EINTR)
+			return true;
+
+		LogError("Error returned from the event loop poll, err: %d", errno);
+		return false;
+	}
+
+	if ((pfds[0U].revents & POLLIN) == POLLIN) {
+		uint64_t expirations;
+		ssize_t len = ::read(m_timerFd, &expirations, sizeof(uint64_t));
+		(void)len;
+	}
+
+	// Cleared before the group runs, so that a signal given while it runs wakes the loop again
+	for (unsigned int i = 0U; i < m_wakeups.size(); i++) {
+		if ((pfds[i + 1U].revents & POLLIN) == POLLIN)
+			m_wakeups[i]->clear();
+	}
+
+	// Errors count as well, so that the socket is read and the error reported
+	for (nfds_t i = 1U; i < n; i++) {
+		if (pfds[i].revents != 0)
+			m_ready[m_pfdGroups[i]] = true;
+	}
+
+	return true;
+#endif
+}
+
+unsigned long long CEventLoop::now()
+{
+#if defined(_WIN32) || defined(_WIN64)
+	LARGE_INTEGER frequency;
+	::QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER count;
+	::QueryPerformanceCounter(&count);
+
+	unsigned long long secs = count.QuadPart / frequency.QuadPart;
+	unsigned long long rem  = count.QuadPart % frequency.QuadPart;
+
+	return secs * 1000000000ULL + (rem * 1000000000ULL) / frequency.QuadPart;
+#else
+	struct timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+void CEventLoop::close()
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (m_timerFd >= 0) {
+		::close(m_timerFd);
+		m_timerFd = -1;
+	}
+#endif
+
+	m_sockets.clear();
+	m_groups.clear();
+	m_wakeups.clear();
+	m_wakeupGroups.clear();
+	m_pfdGroups.clear();
+	m_ready.clear();
+	m_pfds.clear();
+	m_group = 0U;
+}
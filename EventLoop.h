@@ -0,0 +1,75 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(EventLoop_H)
+#define	EventLoop_H
+
+#include "UDPSocket.h"
+#include "Wakeup.h"
+
+#include <vector>
+
+// Returned by the networks when no timer is running
+const unsigned int NO_TIMEOUT = 0xFFFFFFFFU;
+
+class CEventLoop {
+public:
+	CEventLoop();
+	~CEventLoop();
+
+	bool open();
+
+	// The sockets added after this belong to the group, such as a link, until it is changed
+	void setGroup(unsigned int group);
+
+	void addSocket(CUDPSocket& socket);
+
+	// Another thread may wake the loop through this, which counts as the group being readable
+	void addWakeup(CWakeup& wakeup);
+
+	// Whether a socket of the group was readable when the last wait returned
+	bool isReady(unsigned int group) const;
+
+	// Block until one of the sockets is readable or the timeout, in milliseconds, has expired
+	bool wait(unsigned int ms);
+
+	// As above but until an absolute time, in nanoseconds on the monotonic clock
+	bool waitUntil(unsigned long long deadline);
+
+	// The monotonic clock used for the deadlines, in nanoseconds
+	static unsigned long long now();
+
+	void close();
+
+private:
+	std::vector<CUDPSocket*>   m_sockets;
+	std::vector<unsigned int>  m_groups;
+	std::vector<CWakeup*>      m_wakeups;
+	std::vector<unsigned int>  m_wakeupGroups;
+	std::vector<unsigned int>  m_pfdGroups;
+	std::vector<bool>          m_ready;
+	unsigned int               m_group;
+#if defined(_WIN32) || defined(_WIN64)
+	std::vector<WSAPOLLFD>     m_pfds;
+#else
+	std::vector<pollfd>        m_pfds;
+	int                        m_timerFd;
+#endif
+};
+
+#endif
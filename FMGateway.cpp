@@ -1,5 +1,5 @@
 /*
-*   Copyright (C) 2016,2017,2018,2020,2021,2024,2025 by Jonathan Naylor G4KLX
+*   Copyright (C) 2016,2017,2018,2020,2021,2024,2025,2026 by Jonathan Naylor G4KLX
 *
 *   This program is free software; you can redistribute it and/or modify
 *   it under the terms of the GNU General Public License as published by
@@ -17,14 +17,13 @@
 */
 
 #include "MQTTConnection.h"
-#include "USRPNetwork.h"
-#include "RAWNetwork.h"
-#include "IAXNetwork.h"
-#include "FMNetwork.h"
+#include "AudioConvert.h"
+#include "GatewayLink.h"
+#include "WorkerPool.h"
+#include "EventLoop.h"
 #include "UDPSocket.h"
 #include "FMGateway.h"
 #include "StopWatch.h"
-#include "Network.h"
 #include "Version.h"
 #include "Thread.h"
 #include "Timer.h"
@@ -53,7 +52,7 @@ const char* DEFAULT_INI_FILE = "FMGateway.ini";
 const char* DEFAULT_INI_FILE = "/etc/FMGateway.ini";
 #endif
 
-#include <algorithm>
+#include <vector>
 #include <cstdio>
 #include <cstdlib>
 #include <cstdarg>
@@ -63,7 +62,8 @@ const char* DEFAULT_INI_FILE = "/etc/FMGateway.ini";
 // In Log.cpp
 extern CMQTTConnection* m_mqtt;
 
-const unsigned int BUFFER_LENGTH = 500U;
+// The longest time to block for, so that signals are always noticed
+const unsigned int MAX_WAIT = 1000U;
 
 static bool m_killed = false;
 static int  m_signal = 0;
@@ -76,6 +76,16 @@ static void sigHandler(int signum)
 }
 #endif
 
+static void closeLinks(std::vector<CGatewayLink*>& links)
+{
+	for (std::vector<CGatewayLink*>::const_iterator it = links.cbegin(); it != links.cend(); ++it) {
+		(*it)->close();
+		delete *it;
+	}
+
+	links.clear();
+}
+
 int main(int argc, char** argv)
 {
 	const char* iniFile = DEFAULT_INI_FILE;
@@ -226,82 +236,82 @@ int CFMGateway::run()
 	}
 #endif
 
-	CFMNetwork localNetwork(conf.getNetworkLocalAddress(), conf.getNetworkLocalPort(), conf.getNetworkRptAddress(), conf.getNetworkRptPort(), conf.getNetworkDebug());
-	ret = localNetwork.open();
-	if (!ret)
-		return 1;
+	// The FM network of each link is created along with it, so its settings are checked first
+	for (unsigned int i = 0U; i < conf.getLinkCount(); i++) {
+		if (!conf.hasNetworkSection(i)) {
+			LogError("The [Network %u] section is missing, links must be numbered from 1 without gaps", i + 1U);
+			return 1;
+		}
 
-	INetwork* network = nullptr;
-	if (conf.getProtocol() == "USRP") {
-		network = new CUSRPNetwork(conf.getUSRPLocalAddress(), conf.getUSRPLocalPort(), conf.getUSRPRemoteAddress(), conf.getUSRPRemotePort(), conf.getUSRPDebug());
-	} else if (conf.getProtocol() == "RAW") {
-		network = new CRAWNetwork(conf.getRAWLocalAddress(), conf.getRAWLocalPort(), conf.getRAWRemoteAddress(), conf.getRAWRemotePort(), conf.getRAWSampleRate(), conf.getRAWSquelchFile(), conf.getRAWDebug());
-	} else if (conf.getProtocol() == "IAX") {
-		network = new CIAXNetwork(conf.getCallsign(), conf.getIAXUsername(), conf.getIAXPassword(), conf.getIAXNode(), conf.getIAXLocalAddress(), conf.getIAXLocalPort(), conf.getIAXRemoteAddress(), conf.getIAXRemotePort(), conf.getIAXDebug());
-	} else {
-		LogError("Invalid FM network protocol specified - %s", conf.getProtocol().c_str());
+		if ((conf.getNetworkLocalPort(i) == 0U) || (conf.getNetworkRptPort(i) == 0U)) {
+			LogError("Network %u needs both a LocalPort and an RptPort", i + 1U);
+			return 1;
+		}
+	}
+
+	std::vector<CGatewayLink*> links;
+	for (unsigned int i = 0U; i < conf.getLinkCount(); i++) {
+		CGatewayLink* link = new CGatewayLink(conf, i);
+		links.push_back(link);
+
+		ret = link->open();
+		if (!ret) {
+			closeLinks(links);
+			return 1;
+		}
+	}
+
+	CEventLoop eventLoop;
+	ret = eventLoop.open();
+	if (!ret) {
+		closeLinks(links);
 		return 1;
 	}
 
-	ret = network->open();
-	if (!ret)
+	for (std::vector<CGatewayLink*>::const_iterator it = links.cbegin(); it != links.cend(); ++it)
+		(*it)->registerSockets(eventLoop);
+
+	CWorkerPool pool(conf.getThreads(), conf.getCPUs());
+	ret = pool.start();
+	if (!ret) {
+		eventLoop.close();
+		closeLinks(links);
 		return 1;
+	}
 
 	CStopWatch stopWatch;
 	stopWatch.start();
 
+	unsigned long long lastUS = 0ULL;
+
 	LogMessage("FMGateway-%s is starting", VERSION);
 	LogMessage("Built %s %s (GitID #%.7s)", __TIME__, __DATE__, gitversion);
+	LogMessage("Using the %s audio conversion kernels", CAudioConvert::getKernelName());
 
 	while (!m_killed) {
-		float buffer[BUFFER_LENGTH];
-
-		NETWORK_TYPE type = localNetwork.readType();
-
-		switch (type) {
-		case NETWORK_TYPE::START: {
-				std::string callsign = localNetwork.readStart();
-				network->writeStart(callsign);
-			}
-			break;
-
-		case NETWORK_TYPE::DATA: {
-				unsigned int n = localNetwork.readData(buffer, BUFFER_LENGTH);
-				network->writeData(buffer, n);
-			}
-			break;
+		unsigned long long now = CEventLoop::now();
 
-		case NETWORK_TYPE::END: {
-				localNetwork.readEnd();
-				network->writeEnd();
-			}
-			break;
+		unsigned long long deadline = pool.getDeadline(now + MAX_WAIT * 1000000ULL);
 
-		default:
-			break;
-		}
-
-		unsigned int n = network->readData(buffer, BUFFER_LENGTH);
-		if (n > 0U)
-			localNetwork.writeData(buffer, n);
+		ret = eventLoop.waitUntil(deadline);
+		if (!ret)
+			CThread::sleep(10U);
 
-		unsigned int ms = stopWatch.elapsed();
-		stopWatch.start();
+		// Measure from a fixed start so that no time is lost on each pass
+		unsigned long long elapsedUS = stopWatch.elapsedUS();
+		unsigned int us = (unsigned int)(elapsedUS - lastUS);
+		lastUS = elapsedUS;
 
-		localNetwork.clock(ms);
+		pool.clock(links, eventLoop, us);
+	}
 
-		network->clock(ms);
+	pool.stop();
 
-		if (ms < 10U)
-			CThread::sleep(10U);
-	}
+	eventLoop.close();
 
 	LogInfo("FMGateway is stopping");
 
-	localNetwork.close();
-
-	network->close();
-	delete network;
+	closeLinks(links);
 
 	return 0;
 }
@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2020,2021,2023,2024,2025 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2020,2021,2023,2024,2025,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -17,6 +17,7 @@
  */
 
 #include "FMNetwork.h"
+#include "AudioConvert.h"
 #include "Utils.h"
 #include "Log.h"
 
@@ -32,14 +33,19 @@
 #endif
 
 const unsigned int BUFFER_LENGTH = 1500U;
+const unsigned int BATCH_COUNT   = 16U;
+
+// Large enough to hold a whole batch of received frames
+const unsigned int QUEUE_SLOTS = 64U;
 
 CFMNetwork::CFMNetwork(const std::string& localAddress, uint16_t localPort, const std::string& gatewayAddress, uint16_t gatewayPort, bool debug) :
 m_socket(localAddress, localPort),
 m_addr(),
 m_addrLen(0U),
 m_debug(debug),
-m_buffer(2000U, "FM Network"),
-m_timer(1000U, 5U)
+m_queue(QUEUE_SLOTS, BUFFER_LENGTH, "FM Network"),
+m_stopWatch(),
+m_timer(1000000U, 5U)
 {
 	assert(gatewayPort > 0U);
 	assert(!gatewayAddress.empty());
@@ -65,30 +71,46 @@ bool CFMNetwork::open()
 	if (!ret)
 		return false;
 
+	m_stopWatch.start();
+
+	// Writes are sent together when the event loop next waits
+	m_socket.setQueueing(true);
+
 	m_timer.start();
 
 	return true;
 }
 
-bool CFMNetwork::writeData(const float* data, unsigned int nSamples)
+bool CFMNetwork::writeData(const int16_t* data, unsigned int nSamples)
 {
 	assert(data != nullptr);
 	assert(nSamples > 0U);
 
-	uint8_t buffer[BUFFER_LENGTH];
-	::memset(buffer, 0x00U, BUFFER_LENGTH);
+	return writeData(data, nSamples, nullptr, 0U);
+}
 
-	unsigned int length = 0U;
+bool CFMNetwork::writeData(const int16_t* data1, unsigned int length1, const int16_t* data2, unsigned int length2)
+{
+	assert(data1 != nullptr);
+	assert(length1 > 0U);
 
-	buffer[length++] = 'F';
-	buffer[length++] = 'M';
-	buffer[length++] = 'D';
+	const uint8_t HEADER[] = { 'F', 'M', 'D' };
 
-	for (unsigned int i = 0U; i < nSamples; i++) {
-		short val = short(data[i] * 32767.0F + 0.5F);			// Changing audio format from float to S16LE
+	// The audio goes straight from the caller into the datagram
+	if (!m_debug && CAudioConvert::isNativeS16LE())
+		return m_socket.write(HEADER, 3U, (const uint8_t*)data1, length1 * sizeof(int16_t), (const uint8_t*)data2, length2 * sizeof(int16_t), m_addr, m_addrLen);
 
-		buffer[length++] = (val >> 0) & 0xFFU;
-		buffer[length++] = (val >> 8) & 0xFFU;
+	uint8_t buffer[BUFFER_LENGTH];
+
+	::memcpy(buffer, HEADER, 3U);
+	unsigned int length = 3U;
+
+	CAudioConvert::s16ToS16LE(data1, buffer + length, length1);
+	length += length1 * sizeof(int16_t);
+
+	if (length2 > 0U) {
+		CAudioConvert::s16ToS16LE(data2, buffer + length, length2);
+		length += length2 * sizeof(int16_t);
 	}
 
 	if (m_debug)
@@ -97,6 +119,11 @@ bool CFMNetwork::writeData(const float* data, unsigned int nSamples)
 	return m_socket.write(buffer, length, m_addr, m_addrLen);
 }
 
+AUDIO_FORMAT CFMNetwork::getFormat() const
+{
+	return AUDIO_FORMAT { AUDIO_ENCODING::PCM_S16LE, 8000U };
+}
+
 bool CFMNetwork::writePing()
 {
 	uint8_t buffer[5U];
@@ -111,20 +138,38 @@ bool CFMNetwork::writePing()
 	return m_socket.write(buffer, 3U, m_addr, m_addrLen);
 }
 
-void CFMNetwork::clock(unsigned int ms)
+void CFMNetwork::clock(unsigned int us)
 {
-	m_timer.clock(ms);
+	m_timer.clock(us);
 	if (m_timer.isRunning() && m_timer.hasExpired()) {
 		writePing();
 		m_timer.start();
 	}
 
-	uint8_t buffer[BUFFER_LENGTH];
+	uint8_t buffers[BATCH_COUNT * BUFFER_LENGTH];
+	unsigned int lengths[BATCH_COUNT];
+	sockaddr_storage addrs[BATCH_COUNT];
+	unsigned int addrLens[BATCH_COUNT];
+
+	// Drain everything that is waiting on the socket
+	for (;;) {
+		int n = m_socket.readBatch(buffers, BUFFER_LENGTH, BATCH_COUNT, lengths, addrs, addrLens);
+		if (n <= 0)
+			return;
+
+		for (int i = 0; i < n; i++)
+			processPacket(buffers + i * BUFFER_LENGTH, lengths[i], addrs[i]);
+
+		if (n < int(BATCH_COUNT))
+			return;
+	}
+}
+
+void CFMNetwork::processPacket(const uint8_t* buffer, unsigned int length, const sockaddr_storage& addr)
+{
+	assert(buffer != nullptr);
 
-	sockaddr_storage addr;
-	unsigned int addrlen;
-	int length = m_socket.read(buffer, BUFFER_LENGTH, addr, addrlen);
-	if (length <= 0)
+	if (length < 3U)
 		return;
 
 	// Check if the data is for us
@@ -143,114 +188,90 @@ void CFMNetwork::clock(unsigned int ms)
 	if (m_debug)
 		CUtils::dump(1U, "FM Network Data Received", buffer, length);
 
-	if (::memcmp(buffer, "FMD", 3U) == 0) {
-		uint16_t len = length;
-		m_buffer.addData((uint8_t*)&len, sizeof(uint16_t));
-		m_buffer.addData(buffer, length);
-	} else if (::memcmp(buffer, "FMS", 3U) == 0) {
-		uint16_t len = length;
-		m_buffer.addData((uint8_t*)&len, sizeof(uint16_t));
-		m_buffer.addData(buffer, length);
-	} else if (::memcmp(buffer, "FME", 3U) == 0) {
-		uint16_t len = 3U;
-		m_buffer.addData((uint8_t*)&len, sizeof(uint16_t));
-		m_buffer.addData(buffer, 3U);
-	}
+	// The type is held in the slot, so only the payload is stored
+	unsigned long long timestamp = m_stopWatch.elapsedUS();
+
+	if (::memcmp(buffer, "FMD", 3U) == 0)
+		m_queue.addFrame(NETWORK_TYPE::DATA, buffer + 3U, length - 3U, timestamp);
+	else if (::memcmp(buffer, "FMS", 3U) == 0)
+		m_queue.addFrame(NETWORK_TYPE::START, buffer + 3U, length - 3U, timestamp);
+	else if (::memcmp(buffer, "FME", 3U) == 0)
+		m_queue.addFrame(NETWORK_TYPE::END, nullptr, 0U, timestamp);
 }
 
-NETWORK_TYPE CFMNetwork::readType() const
+void CFMNetwork::registerSockets(CEventLoop& loop)
 {
-	unsigned int length = m_buffer.dataSize();
-	if (length == 0U)
-		return NETWORK_TYPE::NONE;
-
-	uint16_t len = 0U;
-	m_buffer.peek((uint8_t*)&len, sizeof(uint16_t));
+	loop.addSocket(m_socket);
+}
 
-	uint8_t buffer[5U];
-	m_buffer.peek(buffer, 3U);
+unsigned int CFMNetwork::getNextTimeout() const
+{
+	if (!m_timer.isRunning())
+		return NO_TIMEOUT;
 
-	if (::memcmp(buffer, "FMD", 3U) == 0)
-		return NETWORK_TYPE::DATA;
-	else if (::memcmp(buffer, "FMS", 3U) == 0)
-		return NETWORK_TYPE::START;
-	else if (::memcmp(buffer, "FME", 3U) == 0)
-		return NETWORK_TYPE::END;
+	return m_timer.getRemainingMS();
+}
 
-	return NETWORK_TYPE::DATA;		// ???
+NETWORK_TYPE CFMNetwork::readType() const
+{
+	return m_queue.peekType();
 }
 
 std::string CFMNetwork::readStart()
 {
-	unsigned int length = m_buffer.dataSize();
-	if (length == 0U)
+	if (m_queue.peekType() != NETWORK_TYPE::START)
 		return "";
 
-	uint16_t len = 0U;
-	m_buffer.getData((uint8_t*)&len, sizeof(uint16_t));
+	unsigned int length = 0U;
+	const uint8_t* data = m_queue.peekData(length);
 
-	uint8_t buffer[BUFFER_LENGTH];
-	m_buffer.getData(buffer, len);
+	// The callsign may or may not be null terminated
+	unsigned int len = 0U;
+	while ((len < length) && (data[len] != 0x00U))
+		len++;
 
-	if (::memcmp(buffer, "FMS", 3U) != 0)
-		assert(false);
+	std::string callsign((const char*)data, len);
 
-	char* callsign = (char*)(buffer + 3U);
+	m_queue.removeFrame();
 
-	return std::string(callsign, ::strlen(callsign));
+	return callsign;
 }
 
-unsigned int CFMNetwork::readData(float* out, unsigned int nOut)
+unsigned int CFMNetwork::readData(int16_t* out, unsigned int nOut)
 {
 	assert(out != nullptr);
 	assert(nOut > 0U);
 
-	unsigned int length = m_buffer.dataSize();
-	if (length == 0U)
+	if (m_queue.peekType() != NETWORK_TYPE::DATA)
 		return 0U;
 
-	uint16_t len = 0U;
-	m_buffer.getData((uint8_t*)&len, sizeof(uint16_t));
-
-	uint8_t buffer[BUFFER_LENGTH];
-	m_buffer.getData(buffer, len);
-
-	if (::memcmp(buffer, "FMD", 3U) != 0)
-		assert(false);
+	unsigned int length = 0U;
+	const uint8_t* data = m_queue.peekData(length);
 
-	unsigned int nSamples = (len - 3U) / sizeof(uint16_t);
+	unsigned int nSamples = length / sizeof(uint16_t);
 
 	if (nOut < nSamples)
 		nSamples = nOut;
 
-	const uint8_t* data = buffer + 3U;
-	for (unsigned int i = 0U; i < nSamples; i++) {
-		short val = ((data[i * 2U + 0U] & 0xFFU) << 0) + ((data[i * 2U + 1U] & 0xFFU) << 8);
-		out[i] = float(val) / 65536.0F;
-	}
+	// Decode straight from the queue slot, the whole frame is consumed
+	CAudioConvert::s16LEToS16(data, out, nSamples);
+
+	m_queue.removeFrame();
 
 	return nSamples;
 }
 
 void CFMNetwork::readEnd()
 {
-	unsigned int length = m_buffer.dataSize();
-	if (length == 0U)
-		return ;
-
-	uint16_t len = 0U;
-	m_buffer.getData((uint8_t*)&len, sizeof(uint16_t));
-
-	uint8_t buffer[BUFFER_LENGTH];
-	m_buffer.getData(buffer, len);
+	if (m_queue.peekType() != NETWORK_TYPE::END)
+		return;
 
-	if (::memcmp(buffer, "FME", 3U) != 0)
-		assert(false);
+	m_queue.removeFrame();
 }
 
 void CFMNetwork::reset()
 {
-	m_buffer.clear();
+	m_queue.clear();
 }
 
 void CFMNetwork::close()
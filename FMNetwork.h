@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2020,2021,2023,2024,2025 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2020,2021,2023,2024,2025,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -19,20 +19,16 @@
 #ifndef	FMNetwork_H
 #define	FMNetwork_H
 
-#include "RingBuffer.h"
+#include "AudioFormat.h"
+#include "FrameQueue.h"
+#include "EventLoop.h"
 #include "UDPSocket.h"
+#include "StopWatch.h"
 #include "Timer.h"
 
 #include <cstdint>
 #include <string>
 
-enum class NETWORK_TYPE {
-	NONE,
-	START,
-	DATA,
-	END
-};
-
 class CFMNetwork {
 public:
 	CFMNetwork(const std::string& localAddress, uint16_t localPort, const std::string& rptAddress, uint16_t rptPort, bool debug);
@@ -40,13 +36,18 @@ public:
 
 	bool open();
 
-	bool writeData(const float* data, unsigned int nSamples);
+	bool writeData(const int16_t* data, unsigned int nSamples);
+
+	// Audio held in two parts, such as a ring buffer span
+	bool writeData(const int16_t* data1, unsigned int length1, const int16_t* data2, unsigned int length2);
+
+	AUDIO_FORMAT getFormat() const;
 
 	NETWORK_TYPE readType() const;
 
 	std::string readStart();
 
-	unsigned int readData(float* out, unsigned int nOut);
+	unsigned int readData(int16_t* out, unsigned int nOut);
 
 	void readEnd();
 
@@ -54,17 +55,24 @@ public:
 
 	void close();
 
-	void clock(unsigned int ms);
+	void clock(unsigned int us);
+
+	void registerSockets(CEventLoop& loop);
+
+	unsigned int getNextTimeout() const;
 
 private:
 	CUDPSocket          m_socket;
 	sockaddr_storage    m_addr;
 	unsigned int        m_addrLen;
 	bool                m_debug;
-	CRingBuffer<uint8_t> m_buffer;
+	CFrameQueue         m_queue;
+	CStopWatch          m_stopWatch;
 	CTimer              m_timer;
 
 	bool writePing();
+
+	void processPacket(const uint8_t* buffer, unsigned int length, const sockaddr_storage& addr);
 };
 
 #endif
@@ -0,0 +1,139 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "FrameQueue.h"
+#include "Log.h"
+
+#include <cassert>
+#include <cstring>
+
+CFrameQueue::CFrameQueue(unsigned int slots, unsigned int length, const char* name) :
+m_slots(slots),
+m_length(length),
+m_name(name),
+m_data(nullptr),
+m_frames(nullptr),
+m_iPtr(0U),
+m_oPtr(0U),
+m_count(0U)
+{
+	assert(slots > 0U);
+	assert(length > 0U);
+	assert(name != nullptr);
+
+	m_data   = new uint8_t[m_slots * m_length];
+	m_frames = new FRAME_SLOT[m_slots];
+
+	for (unsigned int i = 0U; i < m_slots; i++) {
+		m_frames[i].m_type      = NETWORK_TYPE::NONE;
+		m_frames[i].m_length    = 0U;
+		m_frames[i].m_timestamp = 0ULL;
+		m_frames[i].m_data      = m_data + i * m_length;
+	}
+}
+
+CFrameQueue::~CFrameQueue()
+{
+	delete[] m_frames;
+	delete[] m_data;
+}
+
+bool CFrameQueue::addFrame(NETWORK_TYPE type, const uint8_t* data, unsigned int length, unsigned long long timestamp)
+{
+	assert(type != NETWORK_TYPE::NONE);
+	assert((data != nullptr) || (length == 0U));
+
+	if (length > m_length) {
+		LogError("%s frame is too long, dropping the frame. (%u > %u)", m_name, length, m_length);
+		return false;
+	}
+
+	if (m_count == m_slots) {
+		LogError("%s queue overflow, dropping the frame", m_name);
+		return false;
+	}
+
+	FRAME_SLOT& frame = m_frames[m_iPtr];
+	frame.m_type      = type;
+	frame.m_length    = length;
+	frame.m_timestamp = timestamp;
+
+	if (length > 0U)
+		::memcpy(frame.m_data, data, length);
+
+	m_iPtr++;
+	if (m_iPtr == m_slots)
+		m_iPtr = 0U;
+
+	m_count++;
+
+	return true;
+}
+
+NETWORK_TYPE CFrameQueue::peekType() const
+{
+	if (m_count == 0U)
+		return NETWORK_TYPE::NONE;
+
+	return m_frames[m_oPtr].m_type;
+}
+
+const uint8_t* CFrameQueue::peekData(unsigned int& length) const
+{
+	assert(m_count > 0U);
+
+	length = m_frames[m_oPtr].m_length;
+
+	return m_frames[m_oPtr].m_data;
+}
+
+unsigned long long CFrameQueue::peekTimestamp() const
+{
+	assert(m_count > 0U);
+
+	return m_frames[m_oPtr].m_timestamp;
+}
+
+void CFrameQueue::removeFrame()
+{
+	if (m_count == 0U)
+		return;
+
+	m_oPtr++;
+	if (m_oPtr == m_slots)
+		m_oPtr = 0U;
+
+	m_count--;
+}
+
+void CFrameQueue::clear()
+{
+	m_iPtr  = 0U;
+	m_oPtr  = 0U;
+	m_count = 0U;
+}
+
+unsigned int CFrameQueue::frameCount() const
+{
+	return m_count;
+}
+
+bool CFrameQueue::isEmpty() const
+{
+	return m_count == 0U;
+}
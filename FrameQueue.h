@@ -0,0 +1,74 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(FrameQueue_H)
+#define	FrameQueue_H
+
+#include <cstdint>
+
+enum class NETWORK_TYPE {
+	NONE,
+	START,
+	DATA,
+	END
+};
+
+// A fixed pool of frame slots, allocated once, that are read in place
+class CFrameQueue {
+public:
+	CFrameQueue(unsigned int slots, unsigned int length, const char* name);
+	~CFrameQueue();
+
+	// The new frame is dropped if the queue is full
+	// The timestamp is the receive time in microseconds
+	bool addFrame(NETWORK_TYPE type, const uint8_t* data, unsigned int length, unsigned long long timestamp);
+
+	// Returns NONE when the queue is empty
+	NETWORK_TYPE peekType() const;
+
+	const uint8_t* peekData(unsigned int& length) const;
+
+	unsigned long long peekTimestamp() const;
+
+	void removeFrame();
+
+	void clear();
+
+	unsigned int frameCount() const;
+
+	bool isEmpty() const;
+
+private:
+	struct FRAME_SLOT {
+		NETWORK_TYPE       m_type;
+		unsigned int       m_length;
+		unsigned long long m_timestamp;
+		uint8_t*           m_data;
+	};
+
+	unsigned int m_slots;
+	unsigned int m_length;
+	const char*  m_name;
+	uint8_t*     m_data;
+	FRAME_SLOT*  m_frames;
+	unsigned int m_iPtr;
+	unsigned int m_oPtr;
+	unsigned int m_count;
+};
+
+#endif
@@ -0,0 +1,126 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if defined(HAS_GSM)
+
+#include "GSMCodec.h"
+#include "Log.h"
+
+#include <cassert>
+#include <cstring>
+
+const uint32_t AST_FORMAT_GSM = 0x00000002U;
+
+const unsigned int GSM_FRAME_SAMPLES = 160U;
+const unsigned int GSM_FRAME_BYTES   = 33U;
+
+CGSMCodec::CGSMCodec() :
+m_encoder(nullptr),
+m_decoder(nullptr)
+{
+	reset();
+}
+
+CGSMCodec::~CGSMCodec()
+{
+	if (m_encoder != nullptr)
+		::gsm_destroy(m_encoder);
+	if (m_decoder != nullptr)
+		::gsm_destroy(m_decoder);
+}
+
+uint32_t CGSMCodec::getFormat() const
+{
+	return AST_FORMAT_GSM;
+}
+
+const char* CGSMCodec::getName() const
+{
+	return "GSM";
+}
+
+unsigned int CGSMCodec::encode(const int16_t* audio, unsigned int nSamples, uint8_t* buffer)
+{
+	assert(audio != nullptr);
+	assert(buffer != nullptr);
+
+	if (m_encoder == nullptr)
+		return 0U;
+
+	unsigned int length = 0U;
+
+	for (unsigned int n = 0U; n < nSamples; n += GSM_FRAME_SAMPLES) {
+		gsm_signal frame[GSM_FRAME_SAMPLES];
+
+		// A short final frame is padded with silence
+		unsigned int count = nSamples - n;
+		if (count > GSM_FRAME_SAMPLES)
+			count = GSM_FRAME_SAMPLES;
+
+		::memcpy(frame, audio + n, count * sizeof(gsm_signal));
+		if (count < GSM_FRAME_SAMPLES)
+			::memset(frame + count, 0x00U, (GSM_FRAME_SAMPLES - count) * sizeof(gsm_signal));
+
+		::gsm_encode(m_encoder, frame, buffer + length);
+		length += GSM_FRAME_BYTES;
+	}
+
+	return length;
+}
+
+unsigned int CGSMCodec::decode(const uint8_t* buffer, unsigned int length, int16_t* audio, unsigned int nAudio)
+{
+	assert(buffer != nullptr);
+	assert(audio != nullptr);
+
+	if (m_decoder == nullptr)
+		return 0U;
+
+	unsigned int nSamples = 0U;
+
+	for (unsigned int n = 0U; (n + GSM_FRAME_BYTES) <= length; n += GSM_FRAME_BYTES) {
+		if ((nSamples + GSM_FRAME_SAMPLES) > nAudio)
+			break;
+
+		if (::gsm_decode(m_decoder, (gsm_byte*)(buffer + n), audio + nSamples) != 0) {
+			LogWarning("Invalid GSM frame received");
+			break;
+		}
+
+		nSamples += GSM_FRAME_SAMPLES;
+	}
+
+	return nSamples;
+}
+
+void CGSMCodec::reset()
+{
+	// The codec state carries between frames, so each call starts afresh
+	if (m_encoder != nullptr)
+		::gsm_destroy(m_encoder);
+	if (m_decoder != nullptr)
+		::gsm_destroy(m_decoder);
+
+	m_encoder = ::gsm_create();
+	m_decoder = ::gsm_create();
+
+	if ((m_encoder == nullptr) || (m_decoder == nullptr))
+		LogError("Unable to create the GSM codec");
+}
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef	GSMCodec_H
+#define	GSMCodec_H
+
+#if defined(HAS_GSM)
+
+#include "Codec.h"
+
+#include <gsm.h>
+
+#include <cstdint>
+
+// GSM 06.10 full rate, 160 samples in 33 bytes, about 13 kbit/s
+class CGSMCodec : public ICodec {
+public:
+	CGSMCodec();
+	virtual ~CGSMCodec();
+
+	virtual uint32_t getFormat() const;
+
+	virtual const char* getName() const;
+
+	virtual unsigned int encode(const int16_t* audio, unsigned int nSamples, uint8_t* buffer);
+
+	virtual unsigned int decode(const uint8_t* buffer, unsigned int length, int16_t* audio, unsigned int nAudio);
+
+	virtual void reset();
+
+private:
+	gsm m_encoder;
+	gsm m_decoder;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,362 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "GatewayLink.h"
+#include "AudioConvert.h"
+#include "USRPNetwork.h"
+#include "RAWNetwork.h"
+#include "IAXNetwork.h"
+#include "NetworkShards.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+const unsigned int BUFFER_LENGTH = 500U;
+
+// Audio is sent in both directions as 20 ms frames at 8 kHz
+const unsigned int FRAME_MS      = 20U;
+const unsigned int FRAME_SAMPLES = 160U;
+const unsigned int SAMPLE_RATE   = 8000U;
+
+// Mixed audio is kept no more than two frames ahead of the FM side
+const unsigned int MIX_AHEAD = 2U * FRAME_SAMPLES;
+
+// The network audio has no end marker, so its transmission ends after this long without any
+const unsigned long long NETWORK_HANGOVER = 1000000000ULL;
+
+// The level step halves the audio, and comfort noise levels are in -dBov up to 127
+const unsigned int LEVEL_STEP_DB   = 6U;
+const unsigned int MAX_NOISE_LEVEL = 127U;
+
+CGatewayLink::CGatewayLink(const CConf& conf, unsigned int link) :
+m_conf(conf),
+m_link(link),
+m_localName("Network " + std::to_string(link + 1U) + " FM TX"),
+m_networkName("Network " + std::to_string(link + 1U) + " TX"),
+m_localNetwork(conf.getNetworkLocalAddress(link), conf.getNetworkLocalPort(link), conf.getNetworkRptAddress(link), conf.getNetworkRptPort(link), conf.getNetworkDebug(link)),
+m_protocols(conf.getProtocols(link)),
+m_networks(),
+m_passThrough(),
+m_scaled(false),
+m_localScheduler(FRAME_SAMPLES, FRAME_MS, conf.getPlayoutDelay(), m_localName.c_str()),
+m_networkScheduler(FRAME_SAMPLES, FRAME_MS, conf.getPlayoutDelay(), m_networkName.c_str()),
+m_dtx(conf.getDTX()),
+m_vad(conf.getDTXThreshold(), conf.getDTXHangover(), FRAME_MS),
+m_silent(false),
+m_fmLevel(link, "FM to Network", SAMPLE_RATE),
+m_networkLevel(link, "Network to FM", SAMPLE_RATE),
+m_networkAudio(0ULL),
+m_receiving(false),
+m_mixer(nullptr)
+{
+}
+
+CGatewayLink::~CGatewayLink()
+{
+	for (std::vector<INetwork*>::const_iterator it = m_networks.cbegin(); it != m_networks.cend(); ++it)
+		delete *it;
+
+	delete m_mixer;
+}
+
+bool CGatewayLink::open()
+{
+	bool ret = m_localNetwork.open();
+	if (!ret)
+		return false;
+
+	std::vector<int> gains;
+
+	for (std::vector<std::string>::const_iterator it = m_protocols.cbegin(); it != m_protocols.cend(); ++it) {
+		// Each protocol has a single section of settings, so it can only be used once
+		if (std::find(m_protocols.cbegin(), it, *it) != it) {
+			LogError("The FM network protocol %s is specified more than once", it->c_str());
+			return false;
+		}
+
+		INetwork* network = nullptr;
+		if (*it == "USRP") {
+			network = new CUSRPNetwork(m_conf.getUSRPLocalAddress(m_link), m_conf.getUSRPLocalPort(m_link), m_conf.getUSRPRemoteAddress(m_link), m_conf.getUSRPRemotePort(m_link), m_conf.getUSRPDebug(m_link));
+			gains.push_back(m_conf.getUSRPGain(m_link));
+		} else if (*it == "RAW") {
+			network = new CRAWNetwork(m_conf.getRAWLocalAddress(m_link), m_conf.getRAWLocalPort(m_link), m_conf.getRAWRemoteAddress(m_link), m_conf.getRAWRemotePort(m_link), m_conf.getRAWSampleRate(m_link), m_conf.getRAWSquelchFile(m_link), m_conf.getRAWDebug(m_link));
+			gains.push_back(m_conf.getRAWGain(m_link));
+		} else if (*it == "IAX") {
+			// The replies to a call that the gateway makes could arrive on any of the shared sockets
+			unsigned int shards = m_conf.getIAXShards(m_link);
+			if ((shards > 1U) && (!m_conf.getIAXInbound(m_link) || (m_conf.getIAXRemotePort(m_link) != 0U))) {
+				LogError("Network %u: the IAX network can only be shared between threads when it only accepts calls", m_link + 1U);
+				return false;
+			}
+
+			std::vector<INetwork*> iax;
+			for (unsigned int i = 0U; (i < shards) || iax.empty(); i++) {
+				CIAXNetwork* shard = new CIAXNetwork(m_conf.getCallsign(), m_conf.getIAXUsername(m_link), m_conf.getIAXPassword(m_link), m_conf.getIAXNode(m_link), m_conf.getIAXCodec(m_link), m_conf.getIAXLocalAddress(m_link), m_conf.getIAXLocalPort(m_link), m_conf.getIAXRemoteAddress(m_link), m_conf.getIAXRemotePort(m_link), m_conf.getIAXInbound(m_link), m_conf.getIAXTrunk(m_link), m_conf.getIAXDebug(m_link));
+				shard->setReusePort(shards > 1U);
+				iax.push_back(shard);
+			}
+
+			if (iax.size() > 1U)
+				network = new CNetworkShards("IAX", m_link, iax, m_conf.getIAXCPUs(m_link));
+			else
+				network = iax.front();
+
+			gains.push_back(m_conf.getIAXGain(m_link));
+		} else {
+			LogError("Invalid FM network protocol specified - %s", it->c_str());
+			return false;
+		}
+
+		m_networks.push_back(network);
+
+		ret = network->open();
+		if (!ret)
+			return false;
+	}
+
+	// Matching formats can be forwarded untouched, at the cost of the level change. The level
+	// change is made once for all of the networks that need it.
+	bool passThrough = m_conf.getPassThrough();
+	for (unsigned int i = 0U; i < m_networks.size(); i++) {
+		bool same = m_networks[i]->getFormat() == m_localNetwork.getFormat();
+		m_passThrough.push_back(passThrough && same);
+
+		if (m_passThrough[i]) {
+			LogMessage("Network %u: passing the %s audio through unchanged", m_link + 1U, m_protocols[i].c_str());
+		} else {
+			if (passThrough)
+				LogWarning("Network %u: the %s audio format differs from the FM one, so it cannot be passed through", m_link + 1U, m_protocols[i].c_str());
+			m_scaled = true;
+		}
+	}
+
+	// The audio from several networks, or from one whose level is changed, goes through the
+	// mixer. The level change for the formats that aren't passed through is part of its gain.
+	bool mix = m_networks.size() > 1U;
+	for (std::vector<int>::const_iterator it = gains.cbegin(); it != gains.cend(); ++it) {
+		if (*it != 0)
+			mix = true;
+	}
+
+	if (mix) {
+		m_mixer = new CMixer((unsigned int)m_networks.size(), FRAME_SAMPLES);
+
+		for (unsigned int i = 0U; i < m_networks.size(); i++) {
+			float gain = m_passThrough[i] ? 1.0F : (32767.0F / 65536.0F);
+			m_mixer->setGain(i, gain * ::powf(10.0F, float(gains[i]) / 20.0F));
+
+			if (gains[i] != 0)
+				LogMessage("Network %u: the %s audio has a gain of %d dB", m_link + 1U, m_protocols[i].c_str(), gains[i]);
+		}
+
+		if (m_networks.size() > 1U)
+			LogMessage("Network %u: mixing the audio from %u networks", m_link + 1U, (unsigned int)m_networks.size());
+	}
+
+	return true;
+}
+
+void CGatewayLink::registerSockets(CEventLoop& loop)
+{
+	// So that the worker pool can tell which links have something to read
+	loop.setGroup(m_link);
+
+	m_localNetwork.registerSockets(loop);
+
+	for (std::vector<INetwork*>::const_iterator it = m_networks.cbegin(); it != m_networks.cend(); ++it)
+		(*it)->registerSockets(loop);
+}
+
+unsigned long long CGatewayLink::getDeadline(unsigned long long now, unsigned long long deadline) const
+{
+	unsigned int timeout = m_localNetwork.getNextTimeout();
+
+	for (std::vector<INetwork*>::const_iterator it = m_networks.cbegin(); it != m_networks.cend(); ++it) {
+		unsigned int remaining = (*it)->getNextTimeout();
+		if (remaining < timeout)
+			timeout = remaining;
+	}
+
+	if ((timeout != NO_TIMEOUT) && ((now + timeout * 1000000ULL) < deadline))
+		deadline = now + timeout * 1000000ULL;
+
+	// Wake in time for the next paced frame in either direction
+	unsigned long long frameDeadline = m_localScheduler.getDeadline();
+	if ((frameDeadline > 0ULL) && (frameDeadline < deadline))
+		deadline = frameDeadline;
+
+	frameDeadline = m_networkScheduler.getDeadline();
+	if ((frameDeadline > 0ULL) && (frameDeadline < deadline))
+		deadline = frameDeadline;
+
+	if (m_receiving && ((m_networkAudio + NETWORK_HANGOVER) < deadline))
+		deadline = m_networkAudio + NETWORK_HANGOVER;
+
+	return deadline;
+}
+
+void CGatewayLink::clock(unsigned int us)
+{
+	m_localNetwork.clock(us);
+
+	for (std::vector<INetwork*>::const_iterator it = m_networks.cbegin(); it != m_networks.cend(); ++it)
+		(*it)->clock(us);
+
+	int16_t buffer[BUFFER_LENGTH];
+
+	NETWORK_TYPE type;
+	while ((type = m_localNetwork.readType()) != NETWORK_TYPE::NONE) {
+		// A start or end waits until the audio before it has been sent
+		if ((type != NETWORK_TYPE::DATA) && !m_networkScheduler.isEmpty())
+			break;
+		if ((type == NETWORK_TYPE::DATA) && !m_networkScheduler.hasSpace(BUFFER_LENGTH))
+			break;
+
+		switch (type) {
+		case NETWORK_TYPE::START: {
+				std::string callsign = m_localNetwork.readStart();
+				for (std::vector<INetwork*>::const_iterator it = m_networks.cbegin(); it != m_networks.cend(); ++it)
+					(*it)->writeStart(callsign);
+
+				m_fmLevel.reset();
+				m_vad.reset();
+				m_silent = false;
+			}
+			break;
+
+		case NETWORK_TYPE::DATA: {
+				unsigned int n = m_localNetwork.readData(buffer, BUFFER_LENGTH);
+				m_fmLevel.add(buffer, n);
+
+				m_networkScheduler.addData(buffer, n);
+			}
+			break;
+
+		case NETWORK_TYPE::END: {
+				m_localNetwork.readEnd();
+				for (std::vector<INetwork*>::const_iterator it = m_networks.cbegin(); it != m_networks.cend(); ++it)
+					(*it)->writeEnd();
+
+				m_fmLevel.publish();
+				m_vad.reset();
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	unsigned long long now = CEventLoop::now();
+
+	unsigned int n;
+	if (m_mixer != nullptr) {
+		// Every network is heard at once
+		for (unsigned int i = 0U; i < m_networks.size(); i++) {
+			while (m_mixer->hasSpace(i, BUFFER_LENGTH) && ((n = m_networks[i]->readData(buffer, BUFFER_LENGTH)) > 0U)) {
+				m_networkLevel.add(buffer, n);
+				m_networkAudio = now;
+				m_receiving    = true;
+
+				m_mixer->addData(i, buffer, n);
+			}
+		}
+
+		// Mixing only just ahead of the FM side lets audio that arrives late still join in. A
+		// partial frame is only mixed once there is nothing else left to send.
+		while ((m_localScheduler.dataSize() < MIX_AHEAD) && ((n = m_mixer->mix(buffer, m_localScheduler.isEmpty())) > 0U))
+			m_localScheduler.addData(buffer, n);
+	} else {
+		while (m_localScheduler.hasSpace(BUFFER_LENGTH) && ((n = m_networks[0U]->readData(buffer, BUFFER_LENGTH)) > 0U)) {
+			m_networkLevel.add(buffer, n);
+			m_networkAudio = now;
+			m_receiving    = true;
+
+			// Keep the level that the float path always had
+			if (!m_passThrough[0U])
+				CAudioConvert::scaleS16(buffer, buffer, n);
+			m_localScheduler.addData(buffer, n);
+		}
+	}
+
+	// Each frame is written from where it sits in the scheduler
+	const int16_t* data1 = nullptr;
+	const int16_t* data2 = nullptr;
+	unsigned int length1 = 0U, length2 = 0U;
+
+	while ((n = m_networkScheduler.acquireFrame(now, data1, length1, data2, length2)) > 0U) {
+		int16_t frame[FRAME_SAMPLES];
+		if (m_scaled) {
+			CAudioConvert::scaleS16(data1, frame, length1);
+			if (length2 > 0U)
+				CAudioConvert::scaleS16(data2, frame + length1, length2);
+		}
+
+		// Silent frames keep their place on the grid but are not sent. The VAD always measures
+		// the audio as it came from the radio, so its thresholds do not depend on the level step.
+		bool voice = true;
+		if (m_dtx)
+			voice = m_vad.process(data1, length1, data2, length2);
+
+		for (unsigned int i = 0U; i < m_networks.size(); i++) {
+			if (!voice) {
+				if (!m_silent) {
+					unsigned int level = m_vad.getNoiseLevel();
+					if (!m_passThrough[i])
+						level = std::min(level + LEVEL_STEP_DB, MAX_NOISE_LEVEL);
+					m_networks[i]->writeSilence(level);
+				}
+			} else if (m_passThrough[i]) {
+				m_networks[i]->writeData(data1, length1, data2, length2);
+			} else {
+				m_networks[i]->writeData(frame, n);
+			}
+		}
+
+		m_silent = !voice;
+
+		m_networkScheduler.releaseFrame(n);
+	}
+
+	for (std::vector<INetwork*>::const_iterator it = m_networks.cbegin(); it != m_networks.cend(); ++it)
+		(*it)->flush();
+
+	while ((n = m_localScheduler.acquireFrame(now, data1, length1, data2, length2)) > 0U) {
+		m_localNetwork.writeData(data1, length1, data2, length2);
+		m_localScheduler.releaseFrame(n);
+	}
+
+	// The transmission from the networks has ended
+	if (m_receiving && m_localScheduler.isEmpty() && (now >= (m_networkAudio + NETWORK_HANGOVER))) {
+		m_networkLevel.publish();
+		m_receiving = false;
+
+		if (m_mixer != nullptr)
+			m_mixer->reset();
+	}
+}
+
+void CGatewayLink::close()
+{
+	m_localNetwork.close();
+
+	for (std::vector<INetwork*>::const_iterator it = m_networks.cbegin(); it != m_networks.cend(); ++it)
+		(*it)->close();
+}
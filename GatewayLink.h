@@ -0,0 +1,75 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(GatewayLink_H)
+#define	GatewayLink_H
+
+#include "VoiceActivity.h"
+#include "TxScheduler.h"
+#include "AudioLevel.h"
+#include "FMNetwork.h"
+#include "EventLoop.h"
+#include "Network.h"
+#include "Mixer.h"
+#include "Conf.h"
+
+#include <string>
+#include <vector>
+
+// One FM link, the connection to an MMDVMHost and the networks that its audio is routed to.
+// Links share nothing, so their clock() may be called from different threads at the same time.
+class CGatewayLink {
+public:
+	CGatewayLink(const CConf& conf, unsigned int link);
+	~CGatewayLink();
+
+	bool open();
+
+	void registerSockets(CEventLoop& loop);
+
+	// Brings the deadline, in nanoseconds, forward to when this link next needs to be clocked
+	unsigned long long getDeadline(unsigned long long now, unsigned long long deadline) const;
+
+	// Moves the audio that is due between the FM side and the networks
+	void clock(unsigned int us);
+
+	void close();
+
+private:
+	const CConf&             m_conf;
+	unsigned int             m_link;
+	std::string              m_localName;
+	std::string              m_networkName;
+	CFMNetwork               m_localNetwork;
+	std::vector<std::string> m_protocols;
+	std::vector<INetwork*>   m_networks;
+	std::vector<bool>        m_passThrough;
+	bool                     m_scaled;
+	CTxScheduler             m_localScheduler;
+	CTxScheduler             m_networkScheduler;
+	bool                     m_dtx;
+	CVoiceActivity           m_vad;
+	bool                     m_silent;
+	CAudioLevel              m_fmLevel;
+	CAudioLevel              m_networkLevel;
+	unsigned long long       m_networkAudio;
+	bool                     m_receiving;
+	CMixer*                  m_mixer;
+};
+
+#endif
@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2020,2021,2023,2024,2025 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2020,2021,2023,2024,2025,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -40,6 +40,7 @@ const uint8_t AST_FRAME_VOICE     = 2U;
 const uint8_t AST_FRAME_CONTROL   = 4U;
 const uint8_t AST_FRAME_IAX       = 6U;
 const uint8_t AST_FRAME_TEXT      = 7U;
+const uint8_t AST_FRAME_CNG       = 10U;
 
 const uint8_t AST_CONTROL_HANGUP  = 1U;
 const uint8_t AST_CONTROL_RING    = 2U;
@@ -50,8 +51,6 @@ const uint8_t AST_CONTROL_KEY     = 12U;
 const uint8_t AST_CONTROL_UNKEY   = 13U;
 const uint8_t AST_CONTROL_STOP_SOUNDS = 255U;
 
-const uint8_t AST_FORMAT_ULAW     = 4U;
-
 const uint8_t IAX_AUTH_MD5        = 2U;
 
 const uint8_t IAX_COMMAND_NEW     = 1U;
@@ -90,6 +89,11 @@ const uint8_t IAX_IE_REFRESH        = 19U;
 const uint8_t IAX_IE_CAUSE          = 22U;
 const uint8_t IAX_IE_DATETIME       = 31U;
 
+// A meta frame starts with a zero call number, a trunk frame holds the voice of several calls
+const uint8_t IAX_META_TRUNK           = 1U;
+const uint8_t IAX_META_TRUNK_SUPERMINI = 0U;
+const uint8_t IAX_META_TRUNK_MINI      = 1U;
+
 const uint8_t IAX_IE_RR_JITTER    = 46U;
 const uint8_t IAX_IE_RR_LOSS      = 47U;
 const uint8_t IAX_IE_RR_PKTS      = 48U;
@@ -98,24 +102,47 @@ const uint8_t IAX_IE_RR_DROPPED   = 50U;
 const uint8_t IAX_IE_RR_OOO       = 51U;
 
 const unsigned int BUFFER_LENGTH = 1500U;
+const unsigned int BATCH_COUNT   = 16U;
+
+// The audio is sent and expected in 20 ms frames
+const uint32_t FRAME_MS = 20U;
+
+// The header of a trunk frame, and of each call's entry in it when they carry timestamps
+const unsigned int TRUNK_HEADER_LENGTH = 8U;
+const unsigned int TRUNK_ENTRY_LENGTH  = 6U;
+const unsigned int TRUNK_LENGTH        = 1400U;
 
 #if !defined(MD5_DIGEST_STRING_LENGTH)
 #define	MD5_DIGEST_STRING_LENGTH	16
 #endif
 
-CIAXNetwork::CIAXNetwork(const std::string& callsign, const std::string& username, const std::string& password, const std::string& node, const std::string& localAddress, uint16_t localPort, const std::string& gatewayAddress, uint16_t gatewayPort, bool debug) :
-m_callsign(callsign),
-m_username(username),
-m_password(password),
-m_node(node),
-m_socket(localAddress, localPort),
+// The length of an MD5 result, the raw digest on Windows and the hex digest without its NUL elsewhere
+#if defined(_WIN32) || defined(_WIN64)
+const unsigned int MD5_RESULT_LENGTH = MD5_DIGEST_STRING_LENGTH;
+#else
+const unsigned int MD5_RESULT_LENGTH = MD5_DIGEST_STRING_LENGTH - 1U;
+#endif
+
+// Our call numbers index the call table, zero marks a meta frame and the call to the gateway is always the first
+const uint16_t MAX_CALLS     = 64U;
+const uint16_t OUTBOUND_CALL = 1U;
+
+const unsigned int FRAME_SAMPLES = 160U;
+const unsigned long long FRAME_NS = FRAME_MS * 1000000ULL;
+
+// How long, in seconds, an inbound call may be silent, and how long a caller has to answer our challenge
+const unsigned int IDLE_TIMEOUT = 60U;
+const unsigned int AUTH_TIMEOUT = 5U;
+
+CIAXNetwork::CALL::CALL(const std::string& name, const std::string& codec) :
+m_name(name),
+m_inbound(false),
+m_status(IAX_STATUS::DISCONNECTED),
 m_addr(),
 m_addrLen(0U),
-m_debug(debug),
-m_buffer(2000U, "FM Network"),
-m_status(IAX_STATUS::DISCONNECTED),
-m_retryTimer(1000U, 0U, 500U),
-m_pingTimer(1000U, 20U),
+m_retryTimer(1000000U, 0U, 500U),
+m_pingTimer(1000000U, 20U),
+m_idleTimer(1000000U, IDLE_TIMEOUT),
 m_seed(),
 m_timestamp(),
 m_sCallNo(0U),
@@ -128,7 +155,57 @@ m_rxFrames(0U),
 m_rxDelay(0U),
 m_rxDropped(0U),
 m_rxOOO(0U),
-m_keyed(false)
+m_rxTimestamp(0U),
+m_trunkOffset(0U),
+m_trunkSynced(false),
+m_keyed(false),
+m_silence(false),
+m_jitterBuffer(m_name.c_str()),
+m_uLaw(),
+#if defined(HAS_GSM)
+m_gsm(),
+#endif
+m_codecs(),
+m_txCodec(nullptr),
+m_rxCodec(nullptr)
+{
+	// The preferred codec goes first, u-law is always available as a fallback
+#if defined(HAS_GSM)
+	if (codec == "GSM")
+		m_codecs.push_back(&m_gsm);
+#endif
+	m_codecs.push_back(&m_uLaw);
+#if defined(HAS_GSM)
+	if (codec != "GSM")
+		m_codecs.push_back(&m_gsm);
+#endif
+
+	m_txCodec = m_rxCodec = m_codecs.front();
+}
+
+CIAXNetwork::CIAXNetwork(const std::string& callsign, const std::string& username, const std::string& password, const std::string& node, const std::string& codec, const std::string& localAddress, uint16_t localPort, const std::string& gatewayAddress, uint16_t gatewayPort, bool inbound, bool trunk, bool debug) :
+m_callsign(callsign),
+m_username(username),
+m_password(password),
+m_node(node),
+m_codec(codec),
+m_socket(localAddress, localPort),
+m_addr(),
+m_addrLen(0U),
+m_outbound(gatewayPort > 0U),
+m_inbound(inbound),
+m_debug(debug),
+m_trunk(trunk),
+m_trunkBuffer(nullptr),
+m_trunkLength(0U),
+m_trunkTimestamp(),
+m_trunkAddr(),
+m_trunkAddrLen(0U),
+m_calls(MAX_CALLS + 1U, nullptr),
+m_peers(MAX_CALLS + 1U, "IAX"),
+m_mixer(nullptr),
+m_mixTime(0ULL),
+m_random(std::random_device()())
 #if defined(_WIN32) || defined(_WIN64)
 ,m_provider(0UL)
 #endif
@@ -136,30 +213,59 @@ m_keyed(false)
 	assert(!callsign.empty());
 	assert(!username.empty());
 	assert(!password.empty());
-	assert(!node.empty());
-	assert(gatewayPort > 0U);
-	assert(!gatewayAddress.empty());
 
-	if (CUDPSocket::lookup(gatewayAddress, gatewayPort, m_addr, m_addrLen) != 0)
-		m_addrLen = 0U;
+	if (m_outbound) {
+		assert(!node.empty());
+		assert(!gatewayAddress.empty());
+
+		if (CUDPSocket::lookup(gatewayAddress, gatewayPort, m_addr, m_addrLen) != 0)
+			m_addrLen = 0U;
+	}
 
 	// Remove any trailing letters in the callsign
 	size_t pos = callsign.find_first_of(' ');
 	if (pos != std::string::npos)
 		m_callsign = callsign.substr(0U, pos);
+
+#if !defined(HAS_GSM)
+	if (codec == "GSM")
+		LogWarning("GSM support is not compiled in, using u-law for IAX");
+#endif
+
+	if (m_trunk)
+		m_trunkBuffer = new uint8_t[TRUNK_LENGTH];
+
+	// Audio from several calls is mixed, one source per call number
+	if (m_inbound)
+		m_mixer = new CMixer(MAX_CALLS + 1U, FRAME_SAMPLES);
 }
 
 CIAXNetwork::~CIAXNetwork()
 {
+	for (std::vector<CALL*>::const_iterator it = m_calls.cbegin(); it != m_calls.cend(); ++it)
+		delete *it;
+
+	delete[] m_trunkBuffer;
+	delete m_mixer;
+}
+
+void CIAXNetwork::setReusePort(bool enabled)
+{
+	m_socket.setReusePort(enabled);
 }
 
 bool CIAXNetwork::open()
 {
-	if (m_addrLen == 0U) {
+	if (m_outbound && (m_addrLen == 0U)) {
 		LogError("Unable to resolve the address of the FM Gateway");
 		return false;
 	}
 
+	if (!m_outbound && !m_inbound) {
+		LogError("The IAX network has no gateway to call and does not accept calls");
+		return false;
+	}
+
 	LogMessage("Opening FM IAX network connection");
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -169,165 +275,512 @@ bool CIAXNetwork::open()
 	}
 #endif
 
-	bool ret = m_socket.open(m_addr);
+	bool ret = m_outbound ? m_socket.open(m_addr) : m_socket.open();
 	if (!ret)
 		return false;
 
-	m_dCallNo  = 0U;
-	m_rxFrames = 0U;
-	m_keyed    = false;
+	// Writes are sent together when the event loop next waits
+	m_socket.setQueueing(true);
+
+	m_trunkLength = 0U;
+	m_trunkTimestamp.start();
+
+	if (m_trunk)
+		LogMessage("Sending the IAX audio in trunk frames");
+
+	if (m_inbound)
+		LogMessage("Accepting up to %u IAX calls", MAX_CALLS - 1U);
+
+	if (!m_outbound)
+		return true;
+
+	CALL* call = m_calls[OUTBOUND_CALL];
+	if (call == nullptr)
+		call = m_calls[OUTBOUND_CALL] = new CALL("FM IAX Network", m_codec);
+
+	call->m_addr    = m_addr;
+	call->m_addrLen = m_addrLen;
+	call->m_sCallNo = OUTBOUND_CALL;
+
+	if (call->m_dCallNo != 0U)
+		m_peers.erase(call->m_addr, call->m_dCallNo);
 
-	ret = writeNew(false);
+	call->m_dCallNo     = 0U;
+	call->m_rxFrames    = 0U;
+	call->m_rxTimestamp = 0U;
+	call->m_keyed       = false;
+	call->m_trunkSynced = false;
+
+	call->m_jitterBuffer.reset();
+
+	for (std::vector<ICodec*>::const_iterator it = call->m_codecs.cbegin(); it != call->m_codecs.cend(); ++it)
+		(*it)->reset();
+
+	// Until the gateway accepts the call with its choice
+	call->m_txCodec = call->m_rxCodec = call->m_codecs.front();
+
+	ret = writeNew(*call, false);
 	if (!ret) {
 		m_socket.close();
 		return false;
 	}
 
-	m_status = IAX_STATUS::CONNECTING;
-	m_retryTimer.start();
+	call->m_status = IAX_STATUS::CONNECTING;
+	call->m_retryTimer.start();
 
 	return true;
 }
 
 bool CIAXNetwork::writeStart(const std::string& callsign)
 {
-	if (m_status != IAX_STATUS::CONNECTED)
-		return false;
+	flush();
 
-	bool ret = writeKey(true);
-	if (!ret)
-		return false;
+	bool sent = false;
+
+	for (std::vector<CALL*>::const_iterator it = m_calls.cbegin(); it != m_calls.cend(); ++it) {
+		CALL* call = *it;
+		if ((call == nullptr) || (call->m_status != IAX_STATUS::CONNECTED))
+			continue;
+
+		bool ret = writeKey(*call, true);
+		if (!ret)
+			continue;
 
-	short audio[160U];
-	::memset(audio, 0x00U, 160U * sizeof(short));
-	return writeAudio(audio, 160U);
+		call->m_silence = false;
+
+		short audio[160U];
+		::memset(audio, 0x00U, 160U * sizeof(short));
+		sent |= writeAudio(*call, audio, 160U);
+	}
+
+	return sent;
 }
 
-bool CIAXNetwork::writeData(const float* data, unsigned int nSamples)
+bool CIAXNetwork::writeData(const int16_t* data, unsigned int nSamples)
 {
 	assert(data != nullptr);
 	assert(nSamples > 0U);
 
-	if (m_status != IAX_STATUS::CONNECTED)
-		return false;
+	// The codecs take up to one byte per sample
+	if (nSamples > 296U)
+		nSamples = 296U;
 
-	int16_t audio[300U];
-	for (unsigned int i = 0U; i < nSamples; i++)
-		audio[i] = short(data[i] * 32767.0F + 0.5F);		// Changing audio format from float to S16LE
+	bool sent = false;
+
+	for (std::vector<CALL*>::const_iterator it = m_calls.cbegin(); it != m_calls.cend(); ++it) {
+		CALL* call = *it;
+		if ((call == nullptr) || (call->m_status != IAX_STATUS::CONNECTED))
+			continue;
+
+		// After comfort noise a full frame resynchronises the far end's timestamps
+		if (call->m_silence) {
+			call->m_silence = false;
+			sent |= writeAudio(*call, data, nSamples);
+			continue;
+		}
 
 #if defined(DEBUG_IAX)
-	LogDebug("IAX audio sent");
+		LogDebug("IAX audio sent");
 #endif
-	uint16_t ts = m_timestamp.elapsed();
+		uint16_t ts = getTimestamp(*call);
 
-	uint8_t buffer[300U];
+		if (m_trunk) {
+			sent |= writeTrunk(*call, ts, data, nSamples);
+			continue;
+		}
 
-	buffer[0U] = (m_sCallNo >> 8) & 0xFFU;
-	buffer[1U] = (m_sCallNo >> 0) & 0xFFU;
+		uint8_t buffer[300U];
 
-	buffer[2U] = (ts >> 8) & 0xFFU;
-	buffer[3U] = (ts >> 0) & 0xFFU;
+		buffer[0U] = (call->m_sCallNo >> 8) & 0xFFU;
+		buffer[1U] = (call->m_sCallNo >> 0) & 0xFFU;
 
-	uLawEncode(audio, buffer + 4U, nSamples);
+		buffer[2U] = (ts >> 8) & 0xFFU;
+		buffer[3U] = (ts >> 0) & 0xFFU;
 
-	if (m_debug)
-		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 4U + nSamples);
+		unsigned int length = call->m_txCodec->encode(data, nSamples, buffer + 4U);
+
+		if (m_debug)
+			CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 4U + length);
+
+		sent |= m_socket.write(buffer, 4U + length, call->m_addr, call->m_addrLen);
+	}
 
-	return m_socket.write(buffer, 4U + nSamples, m_addr, m_addrLen);
+	return sent;
 }
 
 bool CIAXNetwork::writeEnd()
 {
-	if (m_status != IAX_STATUS::CONNECTED)
-		return false;
+	// The audio goes before the unkey
+	flush();
+
+	bool sent = false;
+
+	for (std::vector<CALL*>::const_iterator it = m_calls.cbegin(); it != m_calls.cend(); ++it) {
+		CALL* call = *it;
+		if ((call != nullptr) && (call->m_status == IAX_STATUS::CONNECTED))
+			sent |= writeKey(*call, false);
+	}
+
+	return sent;
+}
+
+bool CIAXNetwork::writeSilence(unsigned int level)
+{
+	flush();
+
+	bool sent = false;
+
+	for (std::vector<CALL*>::const_iterator it = m_calls.cbegin(); it != m_calls.cend(); ++it) {
+		CALL* call = *it;
+		if ((call == nullptr) || (call->m_status != IAX_STATUS::CONNECTED))
+			continue;
+
+		call->m_silence = true;
+
+		sent |= writeCNG(*call, uint8_t(level));
+	}
 
-	return writeKey(false);
+	return sent;
 }
 
-void CIAXNetwork::clock(unsigned int ms)
+void CIAXNetwork::flush()
 {
-	m_retryTimer.clock(ms);
-	if (m_retryTimer.isRunning() && m_retryTimer.hasExpired()) {
-		switch (m_status) {
-			case IAX_STATUS::CONNECTING:
-				writeNew(true);
-				break;
-			case IAX_STATUS::REGISTERNG:
-				writeRegReq(true);
-				break;
-			default:
-				break;
+	if (m_trunkLength == 0U)
+		return;
+
+	// The trunk timestamp is when the frame is sent
+	uint32_t ts = uint32_t((m_trunkTimestamp.elapsedNS() + 500000ULL) / 1000000ULL);
+
+	m_trunkBuffer[4U] = (ts >> 24) & 0xFFU;
+	m_trunkBuffer[5U] = (ts >> 16) & 0xFFU;
+	m_trunkBuffer[6U] = (ts >> 8)  & 0xFFU;
+	m_trunkBuffer[7U] = (ts >> 0)  & 0xFFU;
+
+	if (m_debug)
+		CUtils::dump(1U, "FM IAX Network Trunk Data Sent", m_trunkBuffer, m_trunkLength);
+
+	m_socket.write(m_trunkBuffer, m_trunkLength, m_trunkAddr, m_trunkAddrLen);
+
+	m_trunkLength = 0U;
+}
+
+void CIAXNetwork::clock(unsigned int us)
+{
+	for (unsigned int i = 0U; i < m_calls.size(); i++) {
+		CALL* call = m_calls[i];
+		if (call == nullptr)
+			continue;
+
+		call->m_retryTimer.clock(us);
+		if (call->m_retryTimer.isRunning() && call->m_retryTimer.hasExpired()) {
+			switch (call->m_status) {
+				case IAX_STATUS::CONNECTING:
+					writeNew(*call, true);
+					break;
+				case IAX_STATUS::REGISTERNG:
+					writeRegReq(*call, true);
+					break;
+				default:
+					break;
+			}
+
+			call->m_retryTimer.start();
+		}
+
+		call->m_pingTimer.clock(us);
+		if (call->m_pingTimer.isRunning() && call->m_pingTimer.hasExpired()) {
+			writePing(*call);
+			call->m_pingTimer.start();
 		}
 
-		m_retryTimer.start();
+		// A node that has gone away without hanging up, or never answered our challenge
+		call->m_idleTimer.clock(us);
+		if (call->m_idleTimer.isRunning() && call->m_idleTimer.hasExpired()) {
+			if (call->m_status == IAX_STATUS::CONNECTED)
+				LogMessage("The IAX call from %s has timed out", call->m_name.c_str());
+			else
+				LogWarning("The IAX call from %s did not authenticate in time", call->m_name.c_str());
+			removeCall(call);
+		}
 	}
 
-	m_pingTimer.clock(ms);
-	if (m_pingTimer.isRunning() && m_pingTimer.hasExpired()) {
-		writePing();
-		m_pingTimer.start();
+	uint8_t buffers[BATCH_COUNT * BUFFER_LENGTH];
+	unsigned int lengths[BATCH_COUNT];
+	sockaddr_storage addrs[BATCH_COUNT];
+	unsigned int addrLens[BATCH_COUNT];
+
+	// Drain everything that is waiting on the socket
+	for (;;) {
+		int n = m_socket.readBatch(buffers, BUFFER_LENGTH, BATCH_COUNT, lengths, addrs, addrLens);
+		if (n <= 0)
+			return;
+
+		for (int i = 0; i < n; i++)
+			processPacket(buffers + i * BUFFER_LENGTH, lengths[i], addrs[i], addrLens[i]);
+
+		if (n < int(BATCH_COUNT))
+			return;
 	}
+}
 
-	uint8_t buffer[BUFFER_LENGTH];
+void CIAXNetwork::processPacket(const uint8_t* buffer, unsigned int length, const sockaddr_storage& addr, unsigned int addrLen)
+{
+	assert(buffer != nullptr);
 
-	sockaddr_storage addr;
-	unsigned int addrlen;
-	int length = m_socket.read(buffer, BUFFER_LENGTH, addr, addrlen);
-	if (length <= 0)
+	// Mini frames have a four byte header, full frames a twelve byte one
+	if (length < 4U)
 		return;
 
-	// Check if the data is for us
-	if (!CUDPSocket::match(addr, m_addr, IPMATCHTYPE::ADDRESS_AND_PORT)) {
-		LogMessage("FM IAX packet received from an invalid source");
+	bool full = (buffer[0U] & 0x80U) == 0x80U;
+	if (full && (length < 12U))
 		return;
-	}
 
 	if (m_debug)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 
+	if ((buffer[0U] == 0x00U) && (buffer[1U] == 0x00U)) {
+		processTrunk(buffer, length, addr);
+		return;
+	}
+
+	uint16_t sCallNo = ((buffer[0U] << 8) | (buffer[1U] << 0)) & 0x7FFFU;
+	uint16_t dCallNo = full ? (((buffer[2U] << 8) | (buffer[3U] << 0)) & 0x7FFFU) : 0U;
+
+	if (full && (dCallNo == 0U) && m_inbound && compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_NEW)) {
+		processNew(buffer, length, addr, addrLen);
+		return;
+	}
+
+	// A call is found from its sender, apart from the gateway's first reply that gives us its call number
+	CALL* call = findCall(addr, sCallNo, length);
+	if ((call != nullptr) && (dCallNo != 0U) && (dCallNo != call->m_sCallNo)) {
+		call = nullptr;
+	} else if ((call == nullptr) && (dCallNo != 0U) && (dCallNo < m_calls.size())) {
+		call = m_calls[dCallNo];
+		if ((call != nullptr) && ((call->m_dCallNo != 0U) || !CUDPSocket::match(addr, call->m_addr, IPMATCHTYPE::ADDRESS_AND_PORT)))
+			call = nullptr;
+	}
+
+	if (call == nullptr) {
+		LogMessage("FM IAX packet received from an invalid source");
+		return;
+	}
+
+	processCall(*call, buffer, length);
+}
+
+void CIAXNetwork::processNew(const uint8_t* buffer, unsigned int length, const sockaddr_storage& addr, unsigned int addrLen)
+{
+	assert(buffer != nullptr);
+
+	uint16_t sCallNo = ((buffer[0U] << 8) | (buffer[1U] << 0)) & 0x7FFFU;
+	uint32_t ts      = (buffer[4U] << 24) | (buffer[5U] << 16) | (buffer[6U] << 8) | (buffer[7U] << 0);
+	uint8_t iSeqNo   = buffer[8U];
+
+#if defined(DEBUG_IAX)
+	CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
+	LogDebug("IAX NEW received");
+#endif
+
+	// A repeated NEW means that our challenge was lost
+	CALL* call = findCall(addr, sCallNo, length);
+	if (call != nullptr) {
+		if (call->m_status == IAX_STATUS::AUTHENTICATING) {
+			// Sent again with the same sequence number
+			call->m_oSeqNo--;
+			writeAuthReq(*call);
+		}
+		return;
+	}
+
+	const uint8_t* data = nullptr;
+	unsigned int len = 0U;
+	if (!findIE(buffer, length, IAX_IE_USERNAME, data, len) || (std::string((const char*)data, len) != m_username)) {
+		LogWarning("IAX call rejected, the username is not known");
+		writeReject(addr, addrLen, 0U, sCallNo, ts, 0U, iSeqNo + 1U, "Unknown username");
+		return;
+	}
+
+	uint16_t callNo = 0U;
+	for (uint16_t i = OUTBOUND_CALL + 1U; i < m_calls.size(); i++) {
+		if (m_calls[i] == nullptr) {
+			callNo = i;
+			break;
+		}
+	}
+
+	if (callNo == 0U) {
+		LogWarning("IAX call rejected, there are already %u calls", MAX_CALLS - 1U);
+		writeReject(addr, addrLen, 0U, sCallNo, ts, 0U, iSeqNo + 1U, "Too many calls");
+		return;
+	}
+
+	std::string name;
+	if (findIE(buffer, length, IAX_IE_CALLING_NUMBER, data, len) && (len > 0U))
+		name = std::string((const char*)data, len);
+	else if (findIE(buffer, length, IAX_IE_CALLING_NAME, data, len) && (len > 0U))
+		name = std::string((const char*)data, len);
+	else
+		name = "call " + std::to_string(callNo);
+
+	call = new CALL(name, m_codec);
+
+	// Our preferred codec that the caller can also use
+	uint32_t capability = 0U;
+	if (findIE(buffer, length, IAX_IE_CAPABILITY, data, len) && (len == sizeof(uint32_t)))
+		capability = (data[0U] << 24) | (data[1U] << 16) | (data[2U] << 8) | (data[3U] << 0);
+
+	ICodec* codec = nullptr;
+	for (std::vector<ICodec*>::const_iterator it = call->m_codecs.cbegin(); it != call->m_codecs.cend(); ++it) {
+		if (((*it)->getFormat() & capability) != 0U) {
+			codec = *it;
+			break;
+		}
+	}
+
+	if (codec == nullptr) {
+		LogWarning("IAX call from %s rejected, it has no codec in common", name.c_str());
+		writeReject(addr, addrLen, 0U, sCallNo, ts, 0U, iSeqNo + 1U, "No codec in common");
+		delete call;
+		return;
+	}
+
+	call->m_inbound = true;
+	call->m_addr    = addr;
+	call->m_addrLen = addrLen;
+	call->m_sCallNo = callNo;
+	call->m_dCallNo = sCallNo;
+	call->m_iSeqNo  = iSeqNo + 1U;
+	call->m_oSeqNo  = 0xFFU;		// The challenge is the first frame that we send
+	call->m_txCodec = call->m_rxCodec = codec;
+	call->m_seed    = std::to_string(100000000U + (m_random() % 900000000U));
+	call->m_status  = IAX_STATUS::AUTHENTICATING;
+
+	call->m_timestamp.start();
+	call->m_idleTimer.start(AUTH_TIMEOUT);
+
+	m_calls[callNo] = call;
+	m_peers.insert(addr, addrLen, sCallNo, callNo);
+
+	LogMessage("IAX call from %s, sending a challenge", name.c_str());
+
+	writeAuthReq(*call);
+}
+
+void CIAXNetwork::processCall(CALL& call, const uint8_t* buffer, unsigned int length)
+{
+	assert(buffer != nullptr);
+
 	uint32_t ts = (buffer[4U] << 24) | (buffer[5U] << 16) | (buffer[6U] << 8) | (buffer[7U] << 0);
 	uint8_t iSeqNo = buffer[8U];
 
+	// Until an inbound caller has proved that it knows the password only the call set up is accepted
+	if (call.m_inbound && (call.m_status != IAX_STATUS::CONNECTED)) {
+		bool setup = ((buffer[0U] & 0x80U) == 0x80U) &&
+			     (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_NEW) ||
+			      compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_AUTHREP) ||
+			      compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_ACK) ||
+			      compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_HANGUP));
+		if (!setup) {
+			LogDebug("IAX frame from %s ignored, the call is not authenticated", call.m_name.c_str());
+			return;
+		}
+	}
+
+	if (call.m_inbound && (call.m_status == IAX_STATUS::CONNECTED))
+		call.m_idleTimer.start();
+
+	// Grab the destination call number if we don't have it already, trunk frames need it
+	if (((buffer[0U] & 0x80U) == 0x80U) && (call.m_dCallNo == 0U)) {
+		call.m_dCallNo = ((buffer[0U] << 8) | (buffer[1U] << 0)) & 0x7FFFU;
+		m_peers.insert(call.m_addr, call.m_addrLen, call.m_dCallNo, call.m_sCallNo);
+	}
+
 	if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_ACK)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX ACK received");
 #endif
-		// Grab the destination call number if we don't have it already
-		if (m_dCallNo == 0U)
-			m_dCallNo = ((buffer[0U] << 8) | (buffer[1U] << 0)) & 0x7FFFU;
+	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_AUTHREP) && (call.m_status == IAX_STATUS::AUTHENTICATING)) {
+#if defined(DEBUG_IAX)
+		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
+		LogDebug("IAX AUTHREP received");
+#endif
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
+
+		char digest[MD5_DIGEST_STRING_LENGTH];
+		hash(call.m_seed + m_password, digest);
+
+		// The whole digest must be sent, a trailing NUL is allowed as some peers include it
+		const uint8_t* data = nullptr;
+		unsigned int len = 0U;
+		bool valid = findIE(buffer, length, IAX_IE_MD5_RESULT, data, len);
+		if (valid && (len == (MD5_RESULT_LENGTH + 1U)) && (data[MD5_RESULT_LENGTH] == 0x00U))
+			len = MD5_RESULT_LENGTH;
+
+		if (!valid || (len != MD5_RESULT_LENGTH) || (::memcmp(data, digest, MD5_RESULT_LENGTH) != 0)) {
+			LogWarning("IAX call from %s rejected, the password is wrong", call.m_name.c_str());
+			writeReject(call.m_addr, call.m_addrLen, call.m_sCallNo, call.m_dCallNo, getTimestamp(call), ++call.m_oSeqNo, call.m_iSeqNo, "Authentication failed");
+			removeCall(&call);
+			return;
+		}
+
+		writeAccept(call);
+		writeControl(call, AST_CONTROL_ANSWER);
+
+		LogMessage("IAX call from %s accepted, using the %s codec", call.m_name.c_str(), call.m_txCodec->getName());
+
+		call.m_status = IAX_STATUS::CONNECTED;
+		call.m_pingTimer.start();
+		call.m_idleTimer.start(IDLE_TIMEOUT);
 	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_PING)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX PING received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
-		writePong(ts);
+		writeAck(call, ts);
+		writePong(call, ts);
 	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_PONG)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX PONG received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_ACCEPT)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX ACCEPT received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
-
-		writeAck(ts);
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
+
+		writeAck(call, ts);
+
+		// The gateway picks one of the formats that we offered
+		const uint8_t* data = nullptr;
+		unsigned int len = 0U;
+		if (findIE(buffer, length, IAX_IE_FORMAT, data, len) && (len == sizeof(uint32_t))) {
+			uint32_t format = (data[0U] << 24) | (data[1U] << 16) | (data[2U] << 8) | (data[3U] << 0);
+
+			ICodec* codec = findCodec(call, format);
+			if (codec != nullptr) {
+				call.m_txCodec = call.m_rxCodec = codec;
+				LogMessage("Using the %s codec for IAX", codec->getName());
+			} else {
+				LogWarning("Unsupported IAX format 0x%08X chosen by the gateway, using %s", format, call.m_txCodec->getName());
+			}
+		}
 
-		m_status = IAX_STATUS::CONNECTED;
-		m_retryTimer.stop();
-		m_pingTimer.start();
+		call.m_status = IAX_STATUS::CONNECTED;
+		call.m_retryTimer.stop();
+		call.m_pingTimer.start();
 	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_REGREJ)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
@@ -335,111 +788,124 @@ void CIAXNetwork::clock(unsigned int ms)
 #endif
 		LogError("Registraton rejected by the IAX gateway");
 
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 
-		m_status = IAX_STATUS::DISCONNECTED;
-		m_keyed  = false;
+		call.m_status = IAX_STATUS::DISCONNECTED;
+		call.m_keyed  = false;
 
-		m_retryTimer.stop();
-		m_pingTimer.stop();
+		call.m_retryTimer.stop();
+		call.m_pingTimer.stop();
 	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_REJECT)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX REJECT received");
 #endif
-		LogError("Command rejected by the IAX gateway");
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		m_iSeqNo = iSeqNo + 1U;
+		writeAck(call, ts);
 
-		writeAck(ts);
+		if (call.m_inbound) {
+			LogMessage("The IAX call from %s has been rejected", call.m_name.c_str());
+			removeCall(&call);
+			return;
+		}
 
-		m_status = IAX_STATUS::DISCONNECTED;
-		m_keyed  = false;
+		LogError("Command rejected by the IAX gateway");
 
-		m_retryTimer.stop();
-		m_pingTimer.stop();
+		call.m_status = IAX_STATUS::DISCONNECTED;
+		call.m_keyed  = false;
+
+		call.m_retryTimer.stop();
+		call.m_pingTimer.stop();
 	} else if (compareFrame(buffer, AST_FRAME_CONTROL, AST_CONTROL_RINGING)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX RINGING received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_REGAUTH)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX REGAUTH received");
 #endif
-		m_rxFrames++;
+		call.m_rxFrames++;
 
 		if ((buffer[12U] == IAX_IE_AUTHMETHODS) &&
 		    (buffer[15U] == IAX_AUTH_MD5) &&
 		    (buffer[16U] == IAX_IE_CHALLENGE)) {
-			m_seed = std::string((char*)(buffer + 18U), buffer[17U]);
+			call.m_seed = std::string((char*)(buffer + 18U), buffer[17U]);
 
-			m_status = IAX_STATUS::REGISTERNG;
-			m_iSeqNo = iSeqNo + 1U;
+			call.m_status = IAX_STATUS::REGISTERNG;
+			call.m_iSeqNo = iSeqNo + 1U;
 
-			m_retryTimer.start();
-			writeRegReq(false);
+			call.m_retryTimer.start();
+			writeRegReq(call, false);
 		}
 	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_AUTHREQ)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX AUTHREQ received");
 #endif
-		m_rxFrames++;
+		call.m_rxFrames++;
 
 		if ((buffer[12U] == IAX_IE_AUTHMETHODS) &&
 		    (buffer[15U] == IAX_AUTH_MD5) &&
 		    (buffer[16U] == IAX_IE_CHALLENGE)) {
-			m_seed = std::string((char*)(buffer + 18U), buffer[17U]);
+			call.m_seed = std::string((char*)(buffer + 18U), buffer[17U]);
 
-			m_iSeqNo = iSeqNo + 1U;
+			call.m_iSeqNo = iSeqNo + 1U;
 
-			writeAuthRep();
+			writeAuthRep(call);
 		}
 	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_REGACK)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX REGACK received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 
-		m_status = IAX_STATUS::CONNECTED;
-		m_retryTimer.stop();
-		m_pingTimer.start();
+		call.m_status = IAX_STATUS::CONNECTED;
+		call.m_retryTimer.stop();
+		call.m_pingTimer.start();
 	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_HANGUP)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX HANGUP received");
 #endif
-		LogError("Hangup from the IAX gateway");
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_iSeqNo = iSeqNo + 1U;
+
+		writeAck(call, ts);
+
+		if (call.m_inbound) {
+			LogMessage("The IAX call from %s has hung up", call.m_name.c_str());
+			removeCall(&call);
+			return;
+		}
 
-		writeAck(ts);
+		LogError("Hangup from the IAX gateway");
 
-		m_status = IAX_STATUS::DISCONNECTED;
-		m_keyed  = false;
+		call.m_status = IAX_STATUS::DISCONNECTED;
+		call.m_keyed  = false;
 
-		m_retryTimer.stop();
-		m_pingTimer.stop();
+		call.m_retryTimer.stop();
+		call.m_pingTimer.stop();
 	} else if (compareFrame(buffer, AST_FRAME_CONTROL, AST_CONTROL_ANSWER)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX ANSWER received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_VNAK)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
@@ -447,149 +913,404 @@ void CIAXNetwork::clock(unsigned int ms)
 #endif
 		LogError("Messages rejected by the IAX gateway");
 
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 	} else if (compareFrame(buffer, AST_FRAME_CONTROL, AST_CONTROL_STOP_SOUNDS)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX STOP SOUNDS received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 	} else if (compareFrame(buffer, AST_FRAME_CONTROL, AST_CONTROL_OPTION)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX OPTION received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 	} else if (compareFrame(buffer, AST_FRAME_TEXT, 0U)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX TEXT received - %s", buffer + 12U);
 #endif
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_LAGRQ)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX LAGRQ received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeLagRq();
-		writeLagRp(ts);
+		writeLagRq(call);
+		writeLagRp(call, ts);
 	} else if (compareFrame(buffer, AST_FRAME_IAX, IAX_COMMAND_LAGRP)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX LAGRP received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 	} else if (compareFrame(buffer, AST_FRAME_CONTROL, AST_CONTROL_KEY)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX KEY received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 
-		m_keyed = true;
+		call.m_keyed = true;
 	} else if (compareFrame(buffer, AST_FRAME_CONTROL, AST_CONTROL_UNKEY)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
 		LogDebug("IAX UNKEY received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 
-		m_keyed = false;
-	} else if (compareFrame(buffer, AST_FRAME_VOICE, AST_FORMAT_ULAW)) {
+		call.m_keyed = false;
+
+		call.m_jitterBuffer.end();
+	} else if (((buffer[0U] & 0x80U) == 0x80U) && (buffer[10U] == AST_FRAME_VOICE)) {
 #if defined(DEBUG_IAX)
 		CUtils::dump(1U, "FM IAX Network Data Received", buffer, length);
-		LogDebug("IAX ULAW received");
+		LogDebug("IAX VOICE received");
 #endif
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
+
+		writeAck(call, ts);
 
-		writeAck(ts);
+		call.m_rxTimestamp = ts;
+		call.m_trunkSynced = false;
 
-		if (!m_keyed)
+		// A full voice frame sets the format of the mini frames that follow it
+		uint32_t format = ((buffer[11U] & 0x80U) == 0x80U) ? (1U << (buffer[11U] & 0x1FU)) : buffer[11U];
+
+		ICodec* codec = findCodec(call, format);
+		if (codec == nullptr) {
+			LogWarning("IAX audio received in an unsupported format 0x%08X", format);
 			return;
+		}
+
+		if (codec != call.m_rxCodec) {
+			codec->reset();
+			call.m_rxCodec = codec;
+		}
 
-		m_buffer.addData(buffer + 12U, length - 12U);
+		if (!call.m_keyed)
+			return;
+
+		addAudio(call, ts, buffer + 12U, length - 12U);
 	} else if ((buffer[0U] & 0x80U) == 0x00U) {
 #if defined(DEBUG_IAX)
 		LogDebug("IAX audio received");
 #endif
+		call.m_rxFrames++;
+
+		uint32_t fullTs = extendTimestamp(call, (buffer[2U] << 8) | (buffer[3U] << 0));
 
-		if (!m_keyed)
+		if (!call.m_keyed)
 			return;
 
-		m_buffer.addData(buffer + 4U, length - 4U);
+		addAudio(call, fullTs, buffer + 4U, length - 4U);
 	} else {
 		CUtils::dump(2U, "Unknown IAX message received", buffer, length);
 
-		m_rxFrames++;
-		m_iSeqNo = iSeqNo + 1U;
+		call.m_rxFrames++;
+		call.m_iSeqNo = iSeqNo + 1U;
 
-		writeAck(ts);
+		writeAck(call, ts);
 	}
 }
 
-unsigned int CIAXNetwork::readData(float* out, unsigned int nOut)
+void CIAXNetwork::processTrunk(const uint8_t* buffer, unsigned int length, const sockaddr_storage& addr)
+{
+	assert(buffer != nullptr);
+
+	if ((length < TRUNK_HEADER_LENGTH) || (buffer[2U] != IAX_META_TRUNK))
+		return;
+
+	bool timestamps = (buffer[3U] & IAX_META_TRUNK_MINI) == IAX_META_TRUNK_MINI;
+	if (!timestamps && (buffer[3U] != IAX_META_TRUNK_SUPERMINI))
+		return;
+
+	uint32_t trunkTs = (buffer[4U] << 24) | (buffer[5U] << 16) | (buffer[6U] << 8) | (buffer[7U] << 0);
+
+	unsigned int offset = TRUNK_HEADER_LENGTH;
+
+	for (;;) {
+		uint16_t callNo, len, ts = 0U;
+
+		if (timestamps) {
+			if ((offset + TRUNK_ENTRY_LENGTH) > length)
+				return;
+
+			len    = (buffer[offset + 0U] << 8) | (buffer[offset + 1U] << 0);
+			callNo = (buffer[offset + 2U] << 8) | (buffer[offset + 3U] << 0);
+			ts     = (buffer[offset + 4U] << 8) | (buffer[offset + 5U] << 0);
+
+			offset += TRUNK_ENTRY_LENGTH;
+		} else {
+			if ((offset + 4U) > length)
+				return;
+
+			callNo = (buffer[offset + 0U] << 8) | (buffer[offset + 1U] << 0);
+			len    = (buffer[offset + 2U] << 8) | (buffer[offset + 3U] << 0);
+
+			offset += 4U;
+		}
+
+		if ((offset + len) > length) {
+			CUtils::dump(2U, "Invalid IAX trunk frame received", buffer, length);
+			return;
+		}
+
+		// Only the voice for our calls is wanted, and only once an inbound caller has authenticated
+		CALL* call = findCall(addr, callNo & 0x7FFFU, len);
+		if ((call != nullptr) && (call->m_status == IAX_STATUS::CONNECTED) && (len > 0U)) {
+#if defined(DEBUG_IAX)
+			LogDebug("IAX trunk audio received");
+#endif
+			call->m_rxFrames++;
+
+			uint32_t fullTs;
+			if (timestamps) {
+				fullTs = extendTimestamp(*call, ts);
+			} else {
+				// Without timestamps the trunk's own is mapped on to the call's, taking this frame to follow the last
+				if (!call->m_trunkSynced) {
+					call->m_trunkOffset = call->m_rxTimestamp + FRAME_MS - trunkTs;
+					call->m_trunkSynced = true;
+				}
+
+				fullTs = call->m_rxTimestamp = trunkTs + call->m_trunkOffset;
+			}
+
+			if (call->m_inbound)
+				call->m_idleTimer.start();
+
+			if (call->m_keyed)
+				addAudio(*call, fullTs, buffer + offset, len);
+		}
+
+		offset += len;
+	}
+}
+
+uint32_t CIAXNetwork::extendTimestamp(CALL& call, uint16_t ts)
+{
+	// Mini frames only carry the bottom 16 bits of the timestamp
+	uint32_t fullTs = (call.m_rxTimestamp & 0xFFFF0000U) | ts;
+	if (int32_t(fullTs - call.m_rxTimestamp) < -32768)
+		fullTs += 0x10000U;
+	else if (int32_t(fullTs - call.m_rxTimestamp) > 32768)
+		fullTs -= 0x10000U;
+
+	call.m_rxTimestamp = fullTs;
+
+	return fullTs;
+}
+
+void CIAXNetwork::addAudio(CALL& call, uint32_t ts, const uint8_t* buffer, unsigned int length)
+{
+	assert(buffer != nullptr);
+
+	int16_t audio[480U];
+	unsigned int nSamples = call.m_rxCodec->decode(buffer, length, audio, 480U);
+	if (nSamples == 0U)
+		return;
+
+	call.m_jitterBuffer.addFrame(ts, audio, nSamples);
+}
+
+CIAXNetwork::CALL* CIAXNetwork::findCall(const sockaddr_storage& addr, uint16_t callNo, unsigned int length)
+{
+	CPeerTable<uint16_t>::PEER* peer = m_peers.find(addr, callNo);
+	if (peer == nullptr)
+		return nullptr;
+
+	peer->m_packets++;
+	peer->m_bytes += length;
+
+	return m_calls[peer->m_data];
+}
+
+void CIAXNetwork::removeCall(CALL* call)
+{
+	assert(call != nullptr);
+
+	if (call->m_dCallNo != 0U) {
+		const CPeerTable<uint16_t>::PEER* peer = m_peers.find(call->m_addr, call->m_dCallNo);
+		if (peer != nullptr)
+			LogDebug("IAX call from %s received %llu packets, %llu bytes", call->m_name.c_str(), peer->m_packets, peer->m_bytes);
+
+		m_peers.erase(call->m_addr, call->m_dCallNo);
+	}
+
+	m_calls[call->m_sCallNo] = nullptr;
+
+	delete call;
+}
+
+void CIAXNetwork::registerSockets(CEventLoop& loop)
+{
+	loop.addSocket(m_socket);
+}
+
+unsigned int CIAXNetwork::getNextTimeout() const
+{
+	unsigned int timeout = NO_TIMEOUT;
+
+	for (std::vector<CALL*>::const_iterator it = m_calls.cbegin(); it != m_calls.cend(); ++it) {
+		const CALL* call = *it;
+		if (call == nullptr)
+			continue;
+
+		if (call->m_retryTimer.isRunning()) {
+			unsigned int remaining = call->m_retryTimer.getRemainingMS();
+			if (remaining < timeout)
+				timeout = remaining;
+		}
+
+		if (call->m_pingTimer.isRunning()) {
+			unsigned int remaining = call->m_pingTimer.getRemainingMS();
+			if (remaining < timeout)
+				timeout = remaining;
+		}
+
+		if (call->m_idleTimer.isRunning()) {
+			unsigned int remaining = call->m_idleTimer.getRemainingMS();
+			if (remaining < timeout)
+				timeout = remaining;
+		}
+
+		// When the next received frame is due to be played, readData() ignores the calls that are not up
+		if (call->m_status == IAX_STATUS::CONNECTED) {
+			unsigned int remaining = call->m_jitterBuffer.getNextTimeout();
+			if (remaining < timeout)
+				timeout = remaining;
+		}
+	}
+
+	// When the next mixed frame is due
+	if ((m_mixer != nullptr) && !m_mixer->isEmpty()) {
+		unsigned long long now = CEventLoop::now();
+		unsigned int remaining = (m_mixTime > now) ? (unsigned int)((m_mixTime - now + 999999ULL) / 1000000ULL) : 0U;
+		if (remaining < timeout)
+			timeout = remaining;
+	}
+
+	return timeout;
+}
+
+unsigned int CIAXNetwork::readData(int16_t* out, unsigned int nOut)
 {
 	assert(out != nullptr);
 	assert(nOut > 0U);
 
-	unsigned int bytes = m_buffer.dataSize() / sizeof(uint8_t);
-	if (bytes == 0U)
+	// Only the audio that is due to be played is returned
+	if (m_mixer == nullptr) {
+		CALL* call = m_calls[OUTBOUND_CALL];
+		if ((call == nullptr) || (call->m_status != IAX_STATUS::CONNECTED))
+			return 0U;
+
+		return call->m_jitterBuffer.read(out, nOut);
+	}
+
+	for (std::vector<CALL*>::const_iterator it = m_calls.cbegin(); it != m_calls.cend(); ++it) {
+		CALL* call = *it;
+		if ((call == nullptr) || (call->m_status != IAX_STATUS::CONNECTED))
+			continue;
+
+		call->m_jitterBuffer.read(*m_mixer, call->m_sCallNo);
+	}
+
+	if (m_mixer->isEmpty() || (nOut < FRAME_SAMPLES))
 		return 0U;
 
-	if (bytes < nOut)
-		nOut = bytes;
+	// The mix is taken on its own 20 ms grid, restarted after a gap
+	unsigned long long now = CEventLoop::now();
+	if (now > (m_mixTime + FRAME_NS))
+		m_mixTime = now;
+
+	if (now < m_mixTime)
+		return 0U;
 
-	uint8_t buffer[1500U];
-	m_buffer.getData(buffer, nOut * sizeof(uint8_t));
+	unsigned int n = m_mixer->mix(out, true);
+	if (n > 0U)
+		m_mixTime += FRAME_NS;
 
-	int16_t audio[1500U];
-	uLawDecode(buffer, audio, nOut);
+	return n;
+}
 
-	for (unsigned int i = 0U; i < nOut; i++)
-		out[i] = float(audio[i]) / 65536.0F;
+AUDIO_FORMAT CIAXNetwork::getFormat() const
+{
+	const CALL* call = m_calls[OUTBOUND_CALL];
+	if (call != nullptr) {
+#if defined(HAS_GSM)
+		if (call->m_txCodec == &call->m_gsm)
+			return AUDIO_FORMAT { AUDIO_ENCODING::GSM, 8000U };
+#endif
+		return AUDIO_FORMAT { AUDIO_ENCODING::ULAW, 8000U };
+	}
 
-	return nOut;
+#if defined(HAS_GSM)
+	if (m_codec == "GSM")
+		return AUDIO_FORMAT { AUDIO_ENCODING::GSM, 8000U };
+#endif
+	return AUDIO_FORMAT { AUDIO_ENCODING::ULAW, 8000U };
 }
 
 void CIAXNetwork::reset()
 {
-	m_buffer.clear();
+	for (std::vector<CALL*>::const_iterator it = m_calls.cbegin(); it != m_calls.cend(); ++it) {
+		if (*it != nullptr)
+			(*it)->m_jitterBuffer.reset();
+	}
+
+	if (m_mixer != nullptr)
+		m_mixer->reset();
 }
 
 void CIAXNetwork::close()
 {
-	writeHangup();
+	for (unsigned int i = 0U; i < m_calls.size(); i++) {
+		CALL* call = m_calls[i];
+		if (call == nullptr)
+			continue;
 
-	m_socket.close();
+		if (call->m_inbound) {
+			if (call->m_status == IAX_STATUS::CONNECTED)
+				writeHangup(*call);
+
+			removeCall(call);
+		} else {
+			writeHangup(*call);
+
+			call->m_status = IAX_STATUS::DISCONNECTED;
 
-	m_status = IAX_STATUS::DISCONNECTED;
+			call->m_retryTimer.stop();
+			call->m_pingTimer.stop();
+		}
+	}
 
-	m_retryTimer.stop();
-	m_pingTimer.stop();
+	m_socket.close();
 
 #if defined(_WIN32) || defined(_WIN64)
 	::CryptReleaseContext(m_provider, 0UL);
@@ -599,20 +1320,21 @@ void CIAXNetwork::close()
 	LogMessage("Closing FM IAX network connection");
 }
 
-bool CIAXNetwork::writeNew(bool retry)
+bool CIAXNetwork::writeNew(CALL& call, bool retry)
 {
 #if defined(DEBUG_IAX)
 	LogDebug("IAX NEW sent");
 #endif
-	if (!retry)
-		m_sCallNo++;
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
 
-	uint16_t sCall = m_sCallNo | 0x8000U;
+	call.m_timestamp.start();
 
-	m_timestamp.start();
+	// The gateway gives the call a new number when it answers
+	if (call.m_dCallNo != 0U)
+		m_peers.erase(call.m_addr, call.m_dCallNo);
 
-	m_oSeqNo  = m_iSeqNo = 0U;
-	m_dCallNo = 0U;
+	call.m_oSeqNo  = call.m_iSeqNo = 0U;
+	call.m_dCallNo = 0U;
 
 	unsigned int length = 0U;
 
@@ -660,74 +1382,65 @@ bool CIAXNetwork::writeNew(bool retry)
 	for (std::string::const_iterator it = m_username.cbegin(); it != m_username.cend(); ++it)
 		buffer[length++] = *it;
 
+	uint32_t capability = 0U;
+	for (std::vector<ICodec*>::const_iterator it = call.m_codecs.cbegin(); it != call.m_codecs.cend(); ++it)
+		capability |= (*it)->getFormat();
+
+	buffer[length++] = IAX_IE_CAPABILITY;
+	buffer[length++] = sizeof(uint32_t);
+	buffer[length++] = (capability >> 24) & 0xFFU;
+	buffer[length++] = (capability >> 16) & 0xFFU;
+	buffer[length++] = (capability >> 8)  & 0xFFU;
+	buffer[length++] = (capability >> 0)  & 0xFFU;
+
+	// The preferred format
+	uint32_t format = call.m_codecs.front()->getFormat();
+
 	buffer[length++] = IAX_IE_FORMAT;
 	buffer[length++] = sizeof(uint32_t);
-	buffer[length++] = 0x00U;
-	buffer[length++] = 0x00U;
-	buffer[length++] = 0x00U;
-	buffer[length++] = AST_FORMAT_ULAW;
+	buffer[length++] = (format >> 24) & 0xFFU;
+	buffer[length++] = (format >> 16) & 0xFFU;
+	buffer[length++] = (format >> 8)  & 0xFFU;
+	buffer[length++] = (format >> 0)  & 0xFFU;
 
 #if !defined(DEBUG_IAX)
 	if (m_debug)
 #endif
 		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, length);
 
-	return m_socket.write(buffer, length, m_addr, m_addrLen);
+	return m_socket.write(buffer, length, call.m_addr, call.m_addrLen);
 }
 
-bool CIAXNetwork::writeAuthRep()
+bool CIAXNetwork::writeAuthRep(CALL& call)
 {
 #if defined(DEBUG_IAX)
 	LogDebug("IAX AUTHREP sent");
 #endif
-	m_oSeqNo++;
-
-	std::string password = m_seed + m_password;
-
-	char hash[MD5_DIGEST_STRING_LENGTH];
-
-#if defined(_WIN32) || defined(_WIN64)
-	HCRYPTHASH hHash = 0; 
-	if (!::CryptCreateHash(m_provider, CALG_MD5, 0, 0, &hHash)) {
-		printf("CryptCreateHash failed: %ld\n", ::GetLastError());
-		return false;
-	}
-
-	if (!::CryptHashData(hHash, (BYTE*)password.c_str(), DWORD(password.size()), 0)) {
-		printf("CryptHashData failed: %ld\n", ::GetLastError());
-		return false;
-	}
+	call.m_oSeqNo++;
 
-	DWORD cbHash = MD5_DIGEST_STRING_LENGTH;
-	if (!::CryptGetHashParam(hHash, HP_HASHVAL, (BYTE*)hash, &cbHash, 0)) {
-		printf("CryptGetHashParam failed: %ld\n", ::GetLastError());
+	char digest[MD5_DIGEST_STRING_LENGTH];
+	if (!hash(call.m_seed + m_password, digest))
 		return false;
-	}
 
-	::CryptDestroyHash(hHash);
-#else
-	::MD5Data((uint8_t*)password.c_str(), password.size(), hash);
-#endif
-
-	uint16_t sCall = m_sCallNo | 0x8000U;
-	uint32_t ts    = m_timestamp.elapsed();
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
+	uint32_t ts    = getTimestamp(call);
 
 	uint8_t buffer[50U];
 
 	buffer[0U] = (sCall >> 8) & 0xFFU;
 	buffer[1U] = (sCall >> 0) & 0xFFU;
 
-	buffer[2U] = (m_dCallNo >> 8) & 0xFFU;
-	buffer[3U] = (m_dCallNo >> 0) & 0xFFU;
+	buffer[2U] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[3U] = (call.m_dCallNo >> 0) & 0xFFU;
 
 	buffer[4U] = (ts >> 24) & 0xFFU;
 	buffer[5U] = (ts >> 16) & 0xFFU;
 	buffer[6U] = (ts >> 8)  & 0xFFU;
 	buffer[7U] = (ts >> 0)  & 0xFFU;
 
-	buffer[8U] = m_oSeqNo;
+	buffer[8U] = call.m_oSeqNo;
 
-	buffer[9U] = m_iSeqNo;
+	buffer[9U] = call.m_iSeqNo;
 
 	buffer[10U] = AST_FRAME_IAX;
 
@@ -735,42 +1448,234 @@ bool CIAXNetwork::writeAuthRep()
 
 	buffer[12U] = IAX_IE_MD5_RESULT;
 	buffer[13U] = MD5_DIGEST_STRING_LENGTH;
-	::memcpy(buffer + 14U, hash, MD5_DIGEST_STRING_LENGTH);
+	::memcpy(buffer + 14U, digest, MD5_DIGEST_STRING_LENGTH);
 
 #if !defined(DEBUG_IAX)
 	if (m_debug)
 #endif
 		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 14U + MD5_DIGEST_STRING_LENGTH);
 
-	return m_socket.write(buffer, 14U + MD5_DIGEST_STRING_LENGTH, m_addr, m_addrLen);
+	return m_socket.write(buffer, 14U + MD5_DIGEST_STRING_LENGTH, call.m_addr, call.m_addrLen);
+}
+
+bool CIAXNetwork::writeAuthReq(CALL& call)
+{
+#if defined(DEBUG_IAX)
+	LogDebug("IAX AUTHREQ sent");
+#endif
+	call.m_oSeqNo++;
+
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
+	uint32_t ts    = getTimestamp(call);
+
+	unsigned int length = 0U;
+
+	uint8_t buffer[100U];
+
+	buffer[length++] = (sCall >> 8) & 0xFFU;
+	buffer[length++] = (sCall >> 0) & 0xFFU;
+
+	buffer[length++] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[length++] = (call.m_dCallNo >> 0) & 0xFFU;
+
+	buffer[length++] = (ts >> 24) & 0xFFU;
+	buffer[length++] = (ts >> 16) & 0xFFU;
+	buffer[length++] = (ts >> 8)  & 0xFFU;
+	buffer[length++] = (ts >> 0)  & 0xFFU;
+
+	buffer[length++] = call.m_oSeqNo;
+
+	buffer[length++] = call.m_iSeqNo;
+
+	buffer[length++] = AST_FRAME_IAX;
+
+	buffer[length++] = IAX_COMMAND_AUTHREQ;
+
+	// Laid out as the gateway sends it, MD5 is the only method offered
+	buffer[length++] = IAX_IE_AUTHMETHODS;
+	buffer[length++] = sizeof(uint16_t);
+	buffer[length++] = 0x00U;
+	buffer[length++] = IAX_AUTH_MD5;
+
+	buffer[length++] = IAX_IE_CHALLENGE;
+	buffer[length++] = uint8_t(call.m_seed.size());
+	for (std::string::const_iterator it = call.m_seed.cbegin(); it != call.m_seed.cend(); ++it)
+		buffer[length++] = *it;
+
+	buffer[length++] = IAX_IE_USERNAME;
+	buffer[length++] = uint8_t(m_username.size());
+	for (std::string::const_iterator it = m_username.cbegin(); it != m_username.cend(); ++it)
+		buffer[length++] = *it;
+
+#if !defined(DEBUG_IAX)
+	if (m_debug)
+#endif
+		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, length);
+
+	return m_socket.write(buffer, length, call.m_addr, call.m_addrLen);
+}
+
+bool CIAXNetwork::writeAccept(CALL& call)
+{
+#if defined(DEBUG_IAX)
+	LogDebug("IAX ACCEPT sent");
+#endif
+	call.m_oSeqNo++;
+
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
+	uint32_t ts    = getTimestamp(call);
+
+	uint8_t buffer[20U];
+
+	buffer[0U] = (sCall >> 8) & 0xFFU;
+	buffer[1U] = (sCall >> 0) & 0xFFU;
+
+	buffer[2U] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[3U] = (call.m_dCallNo >> 0) & 0xFFU;
+
+	buffer[4U] = (ts >> 24) & 0xFFU;
+	buffer[5U] = (ts >> 16) & 0xFFU;
+	buffer[6U] = (ts >> 8)  & 0xFFU;
+	buffer[7U] = (ts >> 0)  & 0xFFU;
+
+	buffer[8U] = call.m_oSeqNo;
+
+	buffer[9U] = call.m_iSeqNo;
+
+	buffer[10U] = AST_FRAME_IAX;
+
+	buffer[11U] = IAX_COMMAND_ACCEPT;
+
+	// The codec chosen from those that the caller offered
+	uint32_t format = call.m_txCodec->getFormat();
+
+	buffer[12U] = IAX_IE_FORMAT;
+	buffer[13U] = sizeof(uint32_t);
+	buffer[14U] = (format >> 24) & 0xFFU;
+	buffer[15U] = (format >> 16) & 0xFFU;
+	buffer[16U] = (format >> 8)  & 0xFFU;
+	buffer[17U] = (format >> 0)  & 0xFFU;
+
+#if !defined(DEBUG_IAX)
+	if (m_debug)
+#endif
+		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 18U);
+
+	return m_socket.write(buffer, 18U, call.m_addr, call.m_addrLen);
+}
+
+bool CIAXNetwork::writeReject(const sockaddr_storage& addr, unsigned int addrLen, uint16_t sCallNo, uint16_t dCallNo, uint32_t ts, uint8_t oSeqNo, uint8_t iSeqNo, const char* reason)
+{
+	assert(reason != nullptr);
+
+#if defined(DEBUG_IAX)
+	LogDebug("IAX REJECT sent");
+#endif
+	uint16_t sCall = sCallNo | 0x8000U;
+
+	unsigned int length = 0U;
+
+	uint8_t buffer[100U];
+
+	buffer[length++] = (sCall >> 8) & 0xFFU;
+	buffer[length++] = (sCall >> 0) & 0xFFU;
+
+	buffer[length++] = (dCallNo >> 8) & 0xFFU;
+	buffer[length++] = (dCallNo >> 0) & 0xFFU;
+
+	buffer[length++] = (ts >> 24) & 0xFFU;
+	buffer[length++] = (ts >> 16) & 0xFFU;
+	buffer[length++] = (ts >> 8)  & 0xFFU;
+	buffer[length++] = (ts >> 0)  & 0xFFU;
+
+	buffer[length++] = oSeqNo;
+
+	buffer[length++] = iSeqNo;
+
+	buffer[length++] = AST_FRAME_IAX;
+
+	buffer[length++] = IAX_COMMAND_REJECT;
+
+	unsigned int size = (unsigned int)::strlen(reason);
+
+	buffer[length++] = IAX_IE_CAUSE;
+	buffer[length++] = uint8_t(size);
+	::memcpy(buffer + length, reason, size);
+	length += size;
+
+#if !defined(DEBUG_IAX)
+	if (m_debug)
+#endif
+		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, length);
+
+	return m_socket.write(buffer, length, addr, addrLen);
+}
+
+bool CIAXNetwork::writeControl(CALL& call, uint8_t type)
+{
+#if defined(DEBUG_IAX)
+	LogDebug("IAX CONTROL sent");
+#endif
+	call.m_oSeqNo++;
+
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
+	uint32_t ts    = getTimestamp(call);
+
+	uint8_t buffer[15U];
+
+	buffer[0U] = (sCall >> 8) & 0xFFU;
+	buffer[1U] = (sCall >> 0) & 0xFFU;
+
+	buffer[2U] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[3U] = (call.m_dCallNo >> 0) & 0xFFU;
+
+	buffer[4U] = (ts >> 24) & 0xFFU;
+	buffer[5U] = (ts >> 16) & 0xFFU;
+	buffer[6U] = (ts >> 8)  & 0xFFU;
+	buffer[7U] = (ts >> 0)  & 0xFFU;
+
+	buffer[8U] = call.m_oSeqNo;
+
+	buffer[9U] = call.m_iSeqNo;
+
+	buffer[10U] = AST_FRAME_CONTROL;
+
+	buffer[11U] = type;
+
+#if !defined(DEBUG_IAX)
+	if (m_debug)
+#endif
+		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 12U);
+
+	return m_socket.write(buffer, 12U, call.m_addr, call.m_addrLen);
 }
 
-bool CIAXNetwork::writeKey(bool key)
+bool CIAXNetwork::writeKey(CALL& call, bool key)
 {
 #if defined(DEBUG_IAX)
 	LogDebug("IAX KEY/UNKEY sent");
 #endif
-	m_oSeqNo++;
+	call.m_oSeqNo++;
 
-	uint16_t sCall = m_sCallNo | 0x8000U;
-	uint32_t ts    = m_timestamp.elapsed();
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
+	uint32_t ts    = getTimestamp(call);
 
 	uint8_t buffer[15U];
 
 	buffer[0U] = (sCall >> 8) & 0xFFU;
 	buffer[1U] = (sCall >> 0) & 0xFFU;
 
-	buffer[2U] = (m_dCallNo >> 8) & 0xFFU;
-	buffer[3U] = (m_dCallNo >> 0) & 0xFFU;
+	buffer[2U] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[3U] = (call.m_dCallNo >> 0) & 0xFFU;
 
 	buffer[4U] = (ts >> 24) & 0xFFU;
 	buffer[5U] = (ts >> 16) & 0xFFU;
 	buffer[6U] = (ts >> 8)  & 0xFFU;
 	buffer[7U] = (ts >> 0)  & 0xFFU;
 
-	buffer[8U] = m_oSeqNo;
+	buffer[8U] = call.m_oSeqNo;
 
-	buffer[9U] = m_iSeqNo;
+	buffer[9U] = call.m_iSeqNo;
 
 	buffer[10U] = AST_FRAME_CONTROL;
 
@@ -781,35 +1686,35 @@ bool CIAXNetwork::writeKey(bool key)
 #endif
 		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 12U);
 
-	return m_socket.write(buffer, 12U, m_addr, m_addrLen);
+	return m_socket.write(buffer, 12U, call.m_addr, call.m_addrLen);
 }
 
-bool CIAXNetwork::writePing()
+bool CIAXNetwork::writePing(CALL& call)
 {
 #if defined(DEBUG_IAX)
 	LogDebug("IAX PING sent");
 #endif
-	m_oSeqNo++;
+	call.m_oSeqNo++;
 
-	uint16_t sCall = m_sCallNo | 0x8000U;
-	uint32_t ts    = m_timestamp.elapsed();
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
+	uint32_t ts    = getTimestamp(call);
 
 	uint8_t buffer[15U];
 
 	buffer[0U] = (sCall >> 8) & 0xFFU;
 	buffer[1U] = (sCall >> 0) & 0xFFU;
 
-	buffer[2U] = (m_dCallNo >> 8) & 0xFFU;
-	buffer[3U] = (m_dCallNo >> 0) & 0xFFU;
+	buffer[2U] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[3U] = (call.m_dCallNo >> 0) & 0xFFU;
 
 	buffer[4U] = (ts >> 24) & 0xFFU;
 	buffer[5U] = (ts >> 16) & 0xFFU;
 	buffer[6U] = (ts >> 8)  & 0xFFU;
 	buffer[7U] = (ts >> 0)  & 0xFFU;
 
-	buffer[8U] = m_oSeqNo;
+	buffer[8U] = call.m_oSeqNo;
 
-	buffer[9U] = m_iSeqNo;
+	buffer[9U] = call.m_iSeqNo;
 
 	buffer[10U] = AST_FRAME_IAX;
 
@@ -820,110 +1725,117 @@ bool CIAXNetwork::writePing()
 #endif
 		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 12U);
 
-	return m_socket.write(buffer, 12U, m_addr, m_addrLen);
+	return m_socket.write(buffer, 12U, call.m_addr, call.m_addrLen);
 }
 
-bool CIAXNetwork::writePong(uint32_t ts)
+bool CIAXNetwork::writePong(CALL& call, uint32_t ts)
 {
 #if defined(DEBUG_IAX)
 	LogDebug("IAX PONG sent");
 #endif
-	m_oSeqNo++;
+	call.m_oSeqNo++;
 
-	uint16_t sCall = m_sCallNo | 0x8000U;
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
 
 	uint8_t buffer[50U];
 
 	buffer[0U] = (sCall >> 8) & 0xFFU;
 	buffer[1U] = (sCall >> 0) & 0xFFU;
 
-	buffer[2U] = (m_dCallNo >> 8) & 0xFFU;
-	buffer[3U] = (m_dCallNo >> 0) & 0xFFU;
+	buffer[2U] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[3U] = (call.m_dCallNo >> 0) & 0xFFU;
 
 	buffer[4U] = (ts >> 24) & 0xFFU;
 	buffer[5U] = (ts >> 16) & 0xFFU;
 	buffer[6U] = (ts >> 8)  & 0xFFU;
 	buffer[7U] = (ts >> 0)  & 0xFFU;
 
-	buffer[8U] = m_oSeqNo;
+	buffer[8U] = call.m_oSeqNo;
 
-	buffer[9U] = m_iSeqNo;
+	buffer[9U] = call.m_iSeqNo;
 
 	buffer[10U] = AST_FRAME_IAX;
 
 	buffer[11U] = IAX_COMMAND_PONG;
 
+	// The receiver report comes from the jitter buffer
+	call.m_rxJitter  = call.m_jitterBuffer.getJitter();
+	call.m_rxLoss    = call.m_jitterBuffer.getLost();
+	call.m_rxDelay   = call.m_jitterBuffer.getDelay();
+	call.m_rxDropped = call.m_jitterBuffer.getDropped();
+	call.m_rxOOO     = call.m_jitterBuffer.getOutOfOrder();
+
 	buffer[12U] = IAX_IE_RR_JITTER;
 	buffer[13U] = sizeof(uint32_t);
-	buffer[14U] = (m_rxJitter >> 24) & 0xFFU;
-	buffer[15U] = (m_rxJitter >> 16) & 0xFFU;
-	buffer[16U] = (m_rxJitter >> 8)  & 0xFFU;
-	buffer[17U] = (m_rxJitter >> 0)  & 0xFFU;
+	buffer[14U] = (call.m_rxJitter >> 24) & 0xFFU;
+	buffer[15U] = (call.m_rxJitter >> 16) & 0xFFU;
+	buffer[16U] = (call.m_rxJitter >> 8)  & 0xFFU;
+	buffer[17U] = (call.m_rxJitter >> 0)  & 0xFFU;
 
 	buffer[18U] = IAX_IE_RR_LOSS;
 	buffer[19U] = sizeof(uint32_t);
-	buffer[20U] = (m_rxLoss * 100U) / m_rxFrames;
-	buffer[21U] = (m_rxLoss >> 16) & 0xFFU;
-	buffer[22U] = (m_rxLoss >> 8)  & 0xFFU;
-	buffer[23U] = (m_rxLoss >> 0)  & 0xFFU;
+	buffer[20U] = (call.m_rxFrames > 0U) ? (call.m_rxLoss * 100U) / (call.m_rxFrames + call.m_rxLoss) : 0U;
+	buffer[21U] = (call.m_rxLoss >> 16) & 0xFFU;
+	buffer[22U] = (call.m_rxLoss >> 8)  & 0xFFU;
+	buffer[23U] = (call.m_rxLoss >> 0)  & 0xFFU;
 
 	buffer[24U] = IAX_IE_RR_PKTS;
 	buffer[25U] = sizeof(uint32_t);
-	buffer[26U] = (m_rxFrames >> 24) & 0xFFU;
-	buffer[27U] = (m_rxFrames >> 16) & 0xFFU;
-	buffer[28U] = (m_rxFrames >> 8)  & 0xFFU;
-	buffer[29U] = (m_rxFrames >> 0)  & 0xFFU;
+	buffer[26U] = (call.m_rxFrames >> 24) & 0xFFU;
+	buffer[27U] = (call.m_rxFrames >> 16) & 0xFFU;
+	buffer[28U] = (call.m_rxFrames >> 8)  & 0xFFU;
+	buffer[29U] = (call.m_rxFrames >> 0)  & 0xFFU;
 
 	buffer[30U] = IAX_IE_RR_DELAY;
 	buffer[31U] = sizeof(uint16_t);
-	buffer[32U] = (m_rxDelay >> 8)  & 0xFFU;
-	buffer[33U] = (m_rxDelay >> 0)  & 0xFFU;
+	buffer[32U] = (call.m_rxDelay >> 8)  & 0xFFU;
+	buffer[33U] = (call.m_rxDelay >> 0)  & 0xFFU;
 
 	buffer[34U] = IAX_IE_RR_DROPPED;
 	buffer[35U] = sizeof(uint32_t);
-	buffer[36U] = (m_rxDropped >> 24) & 0xFFU;
-	buffer[37U] = (m_rxDropped >> 16) & 0xFFU;
-	buffer[38U] = (m_rxDropped >> 8)  & 0xFFU;
-	buffer[39U] = (m_rxDropped >> 0)  & 0xFFU;
+	buffer[36U] = (call.m_rxDropped >> 24) & 0xFFU;
+	buffer[37U] = (call.m_rxDropped >> 16) & 0xFFU;
+	buffer[38U] = (call.m_rxDropped >> 8)  & 0xFFU;
+	buffer[39U] = (call.m_rxDropped >> 0)  & 0xFFU;
 
 	buffer[40U] = IAX_IE_RR_OOO;
 	buffer[41U] = sizeof(uint32_t);
-	buffer[42U] = (m_rxOOO >> 24) & 0xFFU;
-	buffer[43U] = (m_rxOOO >> 16) & 0xFFU;
-	buffer[44U] = (m_rxOOO >> 8)  & 0xFFU;
-	buffer[45U] = (m_rxOOO >> 0)  & 0xFFU;
+	buffer[42U] = (call.m_rxOOO >> 24) & 0xFFU;
+	buffer[43U] = (call.m_rxOOO >> 16) & 0xFFU;
+	buffer[44U] = (call.m_rxOOO >> 8)  & 0xFFU;
+	buffer[45U] = (call.m_rxOOO >> 0)  & 0xFFU;
 
 #if !defined(DEBUG_IAX)
 	if (m_debug)
 #endif
 		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 46U);
 
-	return m_socket.write(buffer, 46U, m_addr, m_addrLen);
+	return m_socket.write(buffer, 46U, call.m_addr, call.m_addrLen);
 }
 
-bool CIAXNetwork::writeAck(uint32_t ts)
+bool CIAXNetwork::writeAck(CALL& call, uint32_t ts)
 {
 #if defined(DEBUG_IAX)
 	LogDebug("IAX ACK sent");
 #endif
-	uint16_t sCall = m_sCallNo | 0x8000U;
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
 
 	uint8_t buffer[15U];
 
 	buffer[0U] = (sCall >> 8) & 0xFFU;
 	buffer[1U] = (sCall >> 0) & 0xFFU;
 
-	buffer[2U] = (m_dCallNo >> 8) & 0xFFU;
-	buffer[3U] = (m_dCallNo >> 0) & 0xFFU;
+	buffer[2U] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[3U] = (call.m_dCallNo >> 0) & 0xFFU;
 
 	buffer[4U] = (ts >> 24) & 0xFFU;
 	buffer[5U] = (ts >> 16) & 0xFFU;
 	buffer[6U] = (ts >> 8)  & 0xFFU;
 	buffer[7U] = (ts >> 0)  & 0xFFU;
 
-	buffer[8U] = m_oSeqNo;
+	buffer[8U] = call.m_oSeqNo;
 
-	buffer[9U] = m_iSeqNo;
+	buffer[9U] = call.m_iSeqNo;
 
 	buffer[10U] = AST_FRAME_IAX;
 
@@ -934,34 +1846,34 @@ bool CIAXNetwork::writeAck(uint32_t ts)
 #endif
 		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 12U);
 
-	return m_socket.write(buffer, 12U, m_addr, m_addrLen);
+	return m_socket.write(buffer, 12U, call.m_addr, call.m_addrLen);
 }
 
-bool CIAXNetwork::writeLagRp(uint32_t ts)
+bool CIAXNetwork::writeLagRp(CALL& call, uint32_t ts)
 {
 #if defined(DEBUG_IAX)
 	LogDebug("IAX LAGRP sent");
 #endif
-	m_oSeqNo++;
+	call.m_oSeqNo++;
 
-	uint16_t sCall = m_sCallNo | 0x8000U;
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
 
 	uint8_t buffer[15U];
 
 	buffer[0U] = (sCall >> 8) & 0xFFU;
 	buffer[1U] = (sCall >> 0) & 0xFFU;
 
-	buffer[2U] = (m_dCallNo >> 8) & 0xFFU;
-	buffer[3U] = (m_dCallNo >> 0) & 0xFFU;
+	buffer[2U] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[3U] = (call.m_dCallNo >> 0) & 0xFFU;
 
 	buffer[4U] = (ts >> 24) & 0xFFU;
 	buffer[5U] = (ts >> 16) & 0xFFU;
 	buffer[6U] = (ts >> 8)  & 0xFFU;
 	buffer[7U] = (ts >> 0)  & 0xFFU;
 
-	buffer[8U] = m_oSeqNo;
+	buffer[8U] = call.m_oSeqNo;
 
-	buffer[9U] = m_iSeqNo;
+	buffer[9U] = call.m_iSeqNo;
 
 	buffer[10U] = AST_FRAME_IAX;
 
@@ -972,35 +1884,35 @@ bool CIAXNetwork::writeLagRp(uint32_t ts)
 #endif
 		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 12U);
 
-	return m_socket.write(buffer, 12U, m_addr, m_addrLen);
+	return m_socket.write(buffer, 12U, call.m_addr, call.m_addrLen);
 }
 
-bool CIAXNetwork::writeLagRq()
+bool CIAXNetwork::writeLagRq(CALL& call)
 {
 #if defined(DEBUG_IAX)
 	LogDebug("IAX LAGRQ sent");
 #endif
-	m_oSeqNo++;
+	call.m_oSeqNo++;
 
-	uint16_t sCall = m_sCallNo | 0x8000U;
-	uint32_t ts    = m_timestamp.elapsed();
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
+	uint32_t ts    = getTimestamp(call);
 
 	uint8_t buffer[15U];
 
 	buffer[0U] = (sCall >> 8) & 0xFFU;
 	buffer[1U] = (sCall >> 0) & 0xFFU;
 
-	buffer[2U] = (m_dCallNo >> 8) & 0xFFU;
-	buffer[3U] = (m_dCallNo >> 0) & 0xFFU;
+	buffer[2U] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[3U] = (call.m_dCallNo >> 0) & 0xFFU;
 
 	buffer[4U] = (ts >> 24) & 0xFFU;
 	buffer[5U] = (ts >> 16) & 0xFFU;
 	buffer[6U] = (ts >> 8)  & 0xFFU;
 	buffer[7U] = (ts >> 0)  & 0xFFU;
 
-	buffer[8U] = m_oSeqNo;
+	buffer[8U] = call.m_oSeqNo;
 
-	buffer[9U] = m_iSeqNo;
+	buffer[9U] = call.m_iSeqNo;
 
 	buffer[10U] = AST_FRAME_IAX;
 
@@ -1011,37 +1923,37 @@ bool CIAXNetwork::writeLagRq()
 #endif
 		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 12U);
 
-	return m_socket.write(buffer, 12U, m_addr, m_addrLen);
+	return m_socket.write(buffer, 12U, call.m_addr, call.m_addrLen);
 }
 
-bool CIAXNetwork::writeHangup()
+bool CIAXNetwork::writeHangup(CALL& call)
 {
 #if defined(DEBUG_IAX)
 	LogDebug("IAX HANGUP sent");
 #endif
 	const char* REASON = "MMDVM Out";
 
-	m_oSeqNo++;
+	call.m_oSeqNo++;
 
-	uint16_t sCall = m_sCallNo | 0x8000U;
-	uint32_t ts    = m_timestamp.elapsed();
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
+	uint32_t ts    = getTimestamp(call);
 
 	uint8_t buffer[50U];
 
 	buffer[0U] = (sCall >> 8) & 0xFFU;
 	buffer[1U] = (sCall >> 0) & 0xFFU;
 
-	buffer[2U] = (m_dCallNo >> 8) & 0xFFU;
-	buffer[3U] = (m_dCallNo >> 0) & 0xFFU;
+	buffer[2U] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[3U] = (call.m_dCallNo >> 0) & 0xFFU;
 
 	buffer[4U] = (ts >> 24) & 0xFFU;
 	buffer[5U] = (ts >> 16) & 0xFFU;
 	buffer[6U] = (ts >> 8)  & 0xFFU;
 	buffer[7U] = (ts >> 0)  & 0xFFU;
 
-	buffer[8U] = m_oSeqNo;
+	buffer[8U] = call.m_oSeqNo;
 
-	buffer[9U] = m_iSeqNo;
+	buffer[9U] = call.m_iSeqNo;
 
 	buffer[10U] = AST_FRAME_IAX;
 
@@ -1056,10 +1968,10 @@ bool CIAXNetwork::writeHangup()
 #endif
 		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 14U + (unsigned int)::strlen(REASON));
 
-	return m_socket.write(buffer, 14U + (unsigned int)::strlen(REASON), m_addr, m_addrLen);
+	return m_socket.write(buffer, 14U + (unsigned int)::strlen(REASON), call.m_addr, call.m_addrLen);
 }
 
-bool CIAXNetwork::writeRegReq(bool retry)
+bool CIAXNetwork::writeRegReq(CALL& call, bool retry)
 {
 	const uint16_t REFRESH_TIME = 60U;
 
@@ -1067,13 +1979,13 @@ bool CIAXNetwork::writeRegReq(bool retry)
 	LogDebug("IAX REGREQ sent");
 #endif
 	if (!retry)
-		m_oSeqNo++;
+		call.m_oSeqNo++;
 
-	uint16_t sCall = m_sCallNo | 0x8000U;
-	uint16_t dCall = m_dCallNo;
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
+	uint16_t dCall = call.m_dCallNo;
 	if (retry)
 		dCall |= 0x8000U;
-	uint32_t ts    = m_timestamp.elapsed();
+	uint32_t ts    = getTimestamp(call);
 
 	uint8_t buffer[70U];
 
@@ -1088,9 +2000,9 @@ bool CIAXNetwork::writeRegReq(bool retry)
 	buffer[6U] = (ts >> 8)  & 0xFFU;
 	buffer[7U] = (ts >> 0)  & 0xFFU;
 
-	buffer[8U] = m_oSeqNo;
+	buffer[8U] = call.m_oSeqNo;
 
-	buffer[9U] = m_iSeqNo;
+	buffer[9U] = call.m_iSeqNo;
 
 	buffer[10U] = AST_FRAME_IAX;
 
@@ -1102,38 +2014,15 @@ bool CIAXNetwork::writeRegReq(bool retry)
 
 	unsigned int offset = 14U + (unsigned int)m_username.size();
 
-	if (m_dCallNo > 0U) {
-		std::string password = m_seed + m_password;
-
-		char hash[MD5_DIGEST_STRING_LENGTH];
-
-#if defined(_WIN32) || defined(_WIN64)
-		HCRYPTHASH hHash = 0;
-		if (!::CryptCreateHash(m_provider, CALG_MD5, 0, 0, &hHash)) {
-			printf("CryptCreateHash failed: %ld\n", ::GetLastError());
-			return false;
-		}
-
-		if (!::CryptHashData(hHash, (BYTE*)password.c_str(), DWORD(password.size()), 0)) {
-			printf("CryptHashData failed: %ld\n", ::GetLastError());
+	if (call.m_dCallNo > 0U) {
+		char digest[MD5_DIGEST_STRING_LENGTH];
+		if (!hash(call.m_seed + m_password, digest))
 			return false;
-		}
-
-		DWORD cbHash = MD5_DIGEST_STRING_LENGTH;
-		if (!::CryptGetHashParam(hHash, HP_HASHVAL, (BYTE*)hash, &cbHash, 0)) {
-			printf("CryptGetHashParam failed: %ld\n", ::GetLastError());
-			return false;
-		}
-
-		::CryptDestroyHash(hHash);
-#else
-		::MD5Data((uint8_t*)password.c_str(), password.size(), hash);
-#endif
 
 		buffer[offset++] = IAX_IE_MD5_RESULT;
 		buffer[offset++] = MD5_DIGEST_STRING_LENGTH;
 
-		::memcpy(buffer + offset, hash, MD5_DIGEST_STRING_LENGTH);
+		::memcpy(buffer + offset, digest, MD5_DIGEST_STRING_LENGTH);
 		offset += MD5_DIGEST_STRING_LENGTH;
 	}
 
@@ -1147,104 +2036,164 @@ bool CIAXNetwork::writeRegReq(bool retry)
 #endif
 		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, offset);
 
-	return m_socket.write(buffer, offset, m_addr, m_addrLen);
+	return m_socket.write(buffer, offset, call.m_addr, call.m_addrLen);
 }
 
-void CIAXNetwork::uLawEncode(const int16_t* audio, uint8_t* buffer, unsigned int length) const
+uint32_t CIAXNetwork::getTimestamp(const CALL& call) const
 {
-	assert(audio != nullptr);
-	assert(buffer != nullptr);
+	// Rounded to the nearest millisecond rather than truncated
+	return uint32_t((call.m_timestamp.elapsedNS() + 500000ULL) / 1000000ULL);
+}
+
+bool CIAXNetwork::writeAudio(CALL& call, const int16_t* audio, unsigned int length)
+{
+#if defined(DEBUG_IAX)
+	LogDebug("IAX VOICE sent");
+#endif
+	call.m_oSeqNo++;
 
-	const uint16_t MULAW_MAX  = 0x1FFFU;
-	const uint16_t MULAW_BIAS = 33U;
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
+	uint32_t ts    = getTimestamp(call);
 
-	for (unsigned int i = 0U; i < length; i++) {
-		uint16_t mask = 0x1000U;
-		uint8_t  sign;
-		uint8_t  position = 12U;
-		uint16_t number;
+	uint8_t buffer[300U];
 
-		if (audio[i] < 0) {
-			number = -audio[i];
-			sign   = 0x80U;
-		} else {
-			number = audio[i];
-			sign   = 0x00U;
-		}
+	buffer[0U] = (sCall >> 8) & 0xFFU;
+	buffer[1U] = (sCall >> 0) & 0xFFU;
+
+	buffer[2U] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[3U] = (call.m_dCallNo >> 0) & 0xFFU;
 
-		number += MULAW_BIAS;
-		if (number > MULAW_MAX)
-			number = MULAW_MAX;
+	buffer[4U] = (ts >> 24) & 0xFFU;
+	buffer[5U] = (ts >> 16) & 0xFFU;
+	buffer[6U] = (ts >> 8)  & 0xFFU;
+	buffer[7U] = (ts >> 0)  & 0xFFU;
 
-		for (; ((number & mask) != mask && position >= 5U); mask >>= 1, position--)
-			;
+	buffer[8U] = call.m_oSeqNo;
 
-		uint8_t lsb = (number >> (position - 4U)) & 0x0FU;
-		buffer[i] = ~(sign | ((position - 5U) << 4) | lsb);
-	}
+	buffer[9U] = call.m_iSeqNo;
+
+	buffer[10U] = AST_FRAME_VOICE;
+
+	// All of the formats that we support fit in the uncompressed subclass
+	buffer[11U] = uint8_t(call.m_txCodec->getFormat());
+
+	unsigned int nBytes = call.m_txCodec->encode(audio, length, buffer + 12U);
+
+	if (m_debug)
+		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 12U + nBytes);
+
+	return m_socket.write(buffer, 12U + nBytes, call.m_addr, call.m_addrLen);
 }
 
-void CIAXNetwork::uLawDecode(const uint8_t* buffer, int16_t* audio, unsigned int length) const
+bool CIAXNetwork::writeTrunk(CALL& call, uint16_t ts, const int16_t* audio, unsigned int length)
 {
-	assert(buffer != nullptr);
 	assert(audio != nullptr);
+	assert(m_trunkBuffer != nullptr);
 
-	const uint16_t MULAW_BIAS = 33U;
-
-	for (unsigned int i = 0U; i < length; i++) {
-		bool sign = true;
+	// The codecs take up to one byte per sample, and a trunk frame only goes to one peer
+	if ((m_trunkLength + TRUNK_ENTRY_LENGTH + length) > TRUNK_LENGTH)
+		flush();
+	else if ((m_trunkLength > 0U) && !CUDPSocket::match(call.m_addr, m_trunkAddr, IPMATCHTYPE::ADDRESS_AND_PORT))
+		flush();
 
-		uint8_t number = ~buffer[i];
-		if (number & 0x80U) {
-			number &= 0x7FU;
-			sign = false;
-		}
+	if (m_trunkLength == 0U) {
+		m_trunkAddr    = call.m_addr;
+		m_trunkAddrLen = call.m_addrLen;
 
-		uint8_t position = ((number & 0xF0U) >> 4) + 5U;
-		int16_t decoded = ((1 << position) | ((number & 0x0FU) << (position - 4U))
-			 | (1 << (position - 5U))) - MULAW_BIAS;
+		m_trunkBuffer[0U] = 0x00U;
+		m_trunkBuffer[1U] = 0x00U;
+		m_trunkBuffer[2U] = IAX_META_TRUNK;
+		m_trunkBuffer[3U] = IAX_META_TRUNK_MINI;
 
-		audio[i] = sign ? decoded : -decoded;
+		m_trunkLength = TRUNK_HEADER_LENGTH;
 	}
+
+	uint8_t* entry = m_trunkBuffer + m_trunkLength;
+
+	unsigned int nBytes = call.m_txCodec->encode(audio, length, entry + TRUNK_ENTRY_LENGTH);
+
+	entry[0U] = (nBytes >> 8) & 0xFFU;
+	entry[1U] = (nBytes >> 0) & 0xFFU;
+
+	entry[2U] = (call.m_sCallNo >> 8) & 0xFFU;
+	entry[3U] = (call.m_sCallNo >> 0) & 0xFFU;
+
+	entry[4U] = (ts >> 8) & 0xFFU;
+	entry[5U] = (ts >> 0) & 0xFFU;
+
+	m_trunkLength += TRUNK_ENTRY_LENGTH + nBytes;
+
+	return true;
 }
 
-bool CIAXNetwork::writeAudio(const int16_t* audio, unsigned int length)
+bool CIAXNetwork::writeCNG(CALL& call, uint8_t level)
 {
 #if defined(DEBUG_IAX)
-	LogDebug("IAX ULAW sent");
+	LogDebug("IAX CNG sent");
 #endif
-	m_oSeqNo++;
+	call.m_oSeqNo++;
 
-	uint16_t sCall = m_sCallNo | 0x8000U;
-	uint32_t ts    = m_timestamp.elapsed();
+	uint16_t sCall = call.m_sCallNo | 0x8000U;
+	uint32_t ts    = getTimestamp(call);
 
-	uint8_t buffer[300U];
+	uint8_t buffer[15U];
 
 	buffer[0U] = (sCall >> 8) & 0xFFU;
 	buffer[1U] = (sCall >> 0) & 0xFFU;
 
-	buffer[2U] = (m_dCallNo >> 8) & 0xFFU;
-	buffer[3U] = (m_dCallNo >> 0) & 0xFFU;
+	buffer[2U] = (call.m_dCallNo >> 8) & 0xFFU;
+	buffer[3U] = (call.m_dCallNo >> 0) & 0xFFU;
 
 	buffer[4U] = (ts >> 24) & 0xFFU;
 	buffer[5U] = (ts >> 16) & 0xFFU;
 	buffer[6U] = (ts >> 8)  & 0xFFU;
 	buffer[7U] = (ts >> 0)  & 0xFFU;
 
-	buffer[8U] = m_oSeqNo;
-
-	buffer[9U] = m_iSeqNo;
+	buffer[8U] = call.m_oSeqNo;
 
-	buffer[10U] = AST_FRAME_VOICE;
+	buffer[9U] = call.m_iSeqNo;
 
-	buffer[11U] = AST_FORMAT_ULAW;
+	buffer[10U] = AST_FRAME_CNG;
 
-	uLawEncode(audio, buffer + 12U, length);
+	// The noise level in -dBov
+	buffer[11U] = level & 0x7FU;
 
+#if !defined(DEBUG_IAX)
 	if (m_debug)
-		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 12U + length);
+#endif
+		CUtils::dump(1U, "FM IAX Network Data Sent", buffer, 12U);
+
+	return m_socket.write(buffer, 12U, call.m_addr, call.m_addrLen);
+}
+
+bool CIAXNetwork::hash(const std::string& text, char* digest)
+{
+	assert(digest != nullptr);
+
+#if defined(_WIN32) || defined(_WIN64)
+	HCRYPTHASH hHash = 0;
+	if (!::CryptCreateHash(m_provider, CALG_MD5, 0, 0, &hHash)) {
+		printf("CryptCreateHash failed: %ld\n", ::GetLastError());
+		return false;
+	}
 
-	return m_socket.write(buffer, 12U + length, m_addr, m_addrLen);
+	if (!::CryptHashData(hHash, (BYTE*)text.c_str(), DWORD(text.size()), 0)) {
+		printf("CryptHashData failed: %ld\n", ::GetLastError());
+		return false;
+	}
+
+	DWORD cbHash = MD5_DIGEST_STRING_LENGTH;
+	if (!::CryptGetHashParam(hHash, HP_HASHVAL, (BYTE*)digest, &cbHash, 0)) {
+		printf("CryptGetHashParam failed: %ld\n", ::GetLastError());
+		return false;
+	}
+
+	::CryptDestroyHash(hHash);
+#else
+	::MD5Data((uint8_t*)text.c_str(), text.size(), digest);
+#endif
+
+	return true;
 }
 
 bool CIAXNetwork::compareFrame(const uint8_t* buffer, uint8_t type1, uint8_t type2) const
@@ -1256,3 +2205,39 @@ bool CIAXNetwork::compareFrame(const uint8_t* buffer, uint8_t type1, uint8_t typ
 
 	return (buffer[10U] == type1) && (buffer[11U] == type2);
 }
+
+ICodec* CIAXNetwork::findCodec(const CALL& call, uint32_t format) const
+{
+	for (std::vector<ICodec*>::const_iterator it = call.m_codecs.cbegin(); it != call.m_codecs.cend(); ++it) {
+		if ((*it)->getFormat() == format)
+			return *it;
+	}
+
+	return nullptr;
+}
+
+bool CIAXNetwork::findIE(const uint8_t* buffer, unsigned int length, uint8_t ie, const uint8_t*& data, unsigned int& len) const
+{
+	assert(buffer != nullptr);
+
+	// The information elements follow the full frame header
+	unsigned int offset = 12U;
+
+	while ((offset + 2U) <= length) {
+		uint8_t type = buffer[offset + 0U];
+		uint8_t size = buffer[offset + 1U];
+
+		if ((offset + 2U + size) > length)
+			return false;
+
+		if (type == ie) {
+			data = buffer + offset + 2U;
+			len  = size;
+			return true;
+		}
+
+		offset += 2U + size;
+	}
+
+	return false;
+}
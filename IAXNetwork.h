@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2020,2021,2023,2024,2025 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2020,2021,2023,2024,2025,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -19,14 +19,20 @@
 #ifndef	IAXNetwork_H
 #define	IAXNetwork_H
 
-#include "RingBuffer.h"
+#include "JitterBuffer.h"
+#include "PeerTable.h"
+#include "Mixer.h"
+#include "ULawCodec.h"
+#include "GSMCodec.h"
 #include "UDPSocket.h"
 #include "StopWatch.h"
 #include "Network.h"
 #include "Timer.h"
 
 #include <cstdint>
+#include <random>
 #include <string>
+#include <vector>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <wincrypt.h>
@@ -38,77 +44,150 @@ enum class IAX_STATUS {
 	DISCONNECTED,
 	CONNECTING,
 	REGISTERNG,
+	AUTHENTICATING,
 	CONNECTED
 };
 
+// The call to the gateway and any calls accepted from other nodes. Audio from the FM side goes
+// to every connected call, and the audio from the calls is mixed on its way back.
 class CIAXNetwork : public INetwork {
 public:
-	CIAXNetwork(const std::string& callsign, const std::string& username, const std::string& password, const std::string& node, const std::string& localAddress, uint16_t localPort, const std::string& gatewayAddress, uint16_t gatewayPort, bool debug);
+	CIAXNetwork(const std::string& callsign, const std::string& username, const std::string& password, const std::string& node, const std::string& codec, const std::string& localAddress, uint16_t localPort, const std::string& gatewayAddress, uint16_t gatewayPort, bool inbound, bool trunk, bool debug);
 	virtual ~CIAXNetwork();
 
+	// Lets other networks accept calls on the same port, each taking the nodes that the kernel
+	// gives its socket by a hash of their addresses. Set before open().
+	void setReusePort(bool enabled);
+
 	virtual bool open();
 
 	virtual bool writeStart(const std::string& callsign);
 
-	virtual bool writeData(const float* data, unsigned int nSamples);
+	virtual bool writeData(const int16_t* data, unsigned int nSamples);
 
 	virtual bool writeEnd();
 
-	virtual unsigned int readData(float* out, unsigned int nOut);
+	virtual bool writeSilence(unsigned int level);
+
+	virtual void flush();
+
+	virtual unsigned int readData(int16_t* out, unsigned int nOut);
 
 	virtual void reset();
 
 	virtual void close();
 
-	virtual void clock(unsigned int ms);
+	virtual void clock(unsigned int us);
+
+	virtual void registerSockets(CEventLoop& loop);
+
+	virtual unsigned int getNextTimeout() const;
+
+	virtual AUDIO_FORMAT getFormat() const;
 
 private:
+	struct CALL {
+		CALL(const std::string& name, const std::string& codec);
+
+		std::string          m_name;
+		bool                 m_inbound;
+		IAX_STATUS           m_status;
+		sockaddr_storage     m_addr;
+		unsigned int         m_addrLen;
+		CTimer               m_retryTimer;
+		CTimer               m_pingTimer;
+		CTimer               m_idleTimer;
+		std::string          m_seed;
+		CStopWatch           m_timestamp;
+		uint16_t             m_sCallNo;
+		uint16_t             m_dCallNo;
+		uint8_t              m_iSeqNo;
+		uint8_t              m_oSeqNo;
+		uint32_t             m_rxJitter;
+		uint32_t             m_rxLoss;
+		uint32_t             m_rxFrames;
+		uint16_t             m_rxDelay;
+		uint32_t             m_rxDropped;
+		uint32_t             m_rxOOO;
+		uint32_t             m_rxTimestamp;
+		uint32_t             m_trunkOffset;
+		bool                 m_trunkSynced;
+		bool                 m_keyed;
+		bool                 m_silence;
+		CJitterBuffer        m_jitterBuffer;
+		CULawCodec           m_uLaw;
+#if defined(HAS_GSM)
+		CGSMCodec            m_gsm;
+#endif
+		std::vector<ICodec*> m_codecs;
+		ICodec*              m_txCodec;
+		ICodec*              m_rxCodec;
+	};
+
 	std::string         m_callsign;
 	std::string         m_username;
 	std::string         m_password;
 	std::string         m_node;
+	std::string         m_codec;
 	CUDPSocket          m_socket;
 	sockaddr_storage    m_addr;
 	unsigned int        m_addrLen;
+	bool                m_outbound;
+	bool                m_inbound;
 	bool                m_debug;
-	CRingBuffer<uint8_t> m_buffer;
-	IAX_STATUS          m_status;
-	CTimer              m_retryTimer;
-	CTimer              m_pingTimer;
-	std::string         m_seed;
-	CStopWatch          m_timestamp;
-	uint16_t            m_sCallNo;
-	uint16_t            m_dCallNo;
-	uint8_t             m_iSeqNo;
-	uint8_t             m_oSeqNo;
-	uint32_t            m_rxJitter;
-	uint32_t            m_rxLoss;
-	uint32_t            m_rxFrames;
-	uint16_t            m_rxDelay;
-	uint32_t            m_rxDropped;
-	uint32_t            m_rxOOO;
-	bool                m_keyed;
+	bool                m_trunk;
+	uint8_t*            m_trunkBuffer;
+	unsigned int        m_trunkLength;
+	CStopWatch          m_trunkTimestamp;
+	sockaddr_storage    m_trunkAddr;
+	unsigned int        m_trunkAddrLen;
+	std::vector<CALL*>  m_calls;
+	CPeerTable<uint16_t> m_peers;
+	CMixer*             m_mixer;
+	unsigned long long  m_mixTime;
+	std::mt19937        m_random;
 #if defined(_WIN32) || defined(_WIN64)
 	HCRYPTPROV          m_provider;
 #endif
 
-	bool writeNew(bool retry);
-	bool writeAuthRep();
-	bool writeKey(bool key);
-	bool writePing();
-	bool writePong(uint32_t ts);
-	bool writeAck(uint32_t ts);
-	bool writeLagRq();
-	bool writeLagRp(uint32_t ts);
-	bool writeHangup();
-	bool writeRegReq(bool retry);
-	bool writeAudio(const int16_t* audio, unsigned int length);
-
-	void uLawEncode(const int16_t* audio, uint8_t* buffer, unsigned int length) const;
-	void uLawDecode(const uint8_t* buffer, int16_t* audio, unsigned int length) const;
+	bool writeNew(CALL& call, bool retry);
+	bool writeAuthReq(CALL& call);
+	bool writeAuthRep(CALL& call);
+	bool writeAccept(CALL& call);
+	bool writeReject(const sockaddr_storage& addr, unsigned int addrLen, uint16_t sCallNo, uint16_t dCallNo, uint32_t ts, uint8_t oSeqNo, uint8_t iSeqNo, const char* reason);
+	bool writeControl(CALL& call, uint8_t type);
+	bool writeKey(CALL& call, bool key);
+	bool writePing(CALL& call);
+	bool writePong(CALL& call, uint32_t ts);
+	bool writeAck(CALL& call, uint32_t ts);
+	bool writeLagRq(CALL& call);
+	bool writeLagRp(CALL& call, uint32_t ts);
+	bool writeHangup(CALL& call);
+	bool writeRegReq(CALL& call, bool retry);
+	bool writeAudio(CALL& call, const int16_t* audio, unsigned int length);
+	bool writeCNG(CALL& call, uint8_t level);
+	bool writeTrunk(CALL& call, uint16_t ts, const int16_t* audio, unsigned int length);
+
+	uint32_t getTimestamp(const CALL& call) const;
+	uint32_t extendTimestamp(CALL& call, uint16_t ts);
+
+	void addAudio(CALL& call, uint32_t ts, const uint8_t* buffer, unsigned int length);
 
 	bool compareFrame(const uint8_t* buffer, uint8_t type1, uint8_t type2) const;
+
+	ICodec* findCodec(const CALL& call, uint32_t format) const;
+
+	bool findIE(const uint8_t* buffer, unsigned int length, uint8_t ie, const uint8_t*& data, unsigned int& len) const;
+
+	bool hash(const std::string& text, char* digest);
+
+	void processPacket(const uint8_t* buffer, unsigned int length, const sockaddr_storage& addr, unsigned int addrLen);
+	void processCall(CALL& call, const uint8_t* buffer, unsigned int length);
+	void processNew(const uint8_t* buffer, unsigned int length, const sockaddr_storage& addr, unsigned int addrLen);
+	void processTrunk(const uint8_t* buffer, unsigned int length, const sockaddr_storage& addr);
+
+	CALL* findCall(const sockaddr_storage& addr, uint16_t callNo, unsigned int length);
+	void  removeCall(CALL* call);
 };
 
 #endif
-
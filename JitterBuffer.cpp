@@ -0,0 +1,383 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "JitterBuffer.h"
+#include "EventLoop.h"
+#include "Mixer.h"
+#include "Log.h"
+
+#include <cassert>
+#include <cstring>
+
+const unsigned int JB_SLOTS          = 50U;
+const unsigned int MAX_FRAME_SAMPLES = 480U;
+const unsigned int SAMPLES_PER_MS    = 8U;
+const unsigned int FRAME_MS          = 20U;
+const unsigned int FRAME_SAMPLES     = FRAME_MS * SAMPLES_PER_MS;
+
+// The playout delay is a frame plus a multiple of the jitter, within these limits
+const float        JITTER_FACTOR = 3.0F;
+const unsigned int MIN_DELAY_MS  = 20U;
+const unsigned int MAX_DELAY_MS  = 200U;
+
+// How many missing frames in a row are covered before giving up
+const unsigned int MAX_CONCEAL = 3U;
+
+CJitterBuffer::CJitterBuffer(const char* name) :
+m_name(name),
+m_stopWatch(),
+m_audio(nullptr),
+m_slots(nullptr),
+m_count(0U),
+m_last(nullptr),
+m_lastLength(0U),
+m_running(false),
+m_started(false),
+m_ending(false),
+m_nextTimestamp(0U),
+m_nextPlayUS(0ULL),
+m_delayMS(MIN_DELAY_MS),
+m_concealed(0U),
+m_haveTransit(false),
+m_lastTransit(0LL),
+m_jitter(0.0F),
+m_highest(0U),
+m_received(0U),
+m_lost(0U),
+m_dropped(0U),
+m_ooo(0U)
+{
+	assert(name != nullptr);
+
+	m_audio = new int16_t[JB_SLOTS * MAX_FRAME_SAMPLES];
+	m_slots = new JB_SLOT[JB_SLOTS];
+	m_last  = new int16_t[MAX_FRAME_SAMPLES];
+
+	for (unsigned int i = 0U; i < JB_SLOTS; i++) {
+		m_slots[i].m_used      = false;
+		m_slots[i].m_timestamp = 0U;
+		m_slots[i].m_length    = 0U;
+		m_slots[i].m_audio     = m_audio + i * MAX_FRAME_SAMPLES;
+	}
+
+	m_stopWatch.start();
+}
+
+CJitterBuffer::~CJitterBuffer()
+{
+	delete[] m_last;
+	delete[] m_slots;
+	delete[] m_audio;
+}
+
+bool CJitterBuffer::addFrame(uint32_t timestamp, const int16_t* audio, unsigned int nSamples)
+{
+	assert(audio != nullptr);
+
+	if ((nSamples == 0U) || (nSamples > MAX_FRAME_SAMPLES)) {
+		LogWarning("%s: invalid frame length of %u samples", m_name, nSamples);
+		return false;
+	}
+
+	unsigned long long nowUS = m_stopWatch.elapsedUS();
+
+	m_received++;
+
+	if (m_haveTransit && (int32_t(timestamp - m_highest) < 0))
+		m_ooo++;
+
+	if (!m_haveTransit || (int32_t(timestamp - m_highest) > 0))
+		m_highest = timestamp;
+
+	// The interarrival jitter from RFC 3550, in milliseconds
+	long long transit = (long long)nowUS - (long long)timestamp * 1000LL;
+	if (m_haveTransit) {
+		long long d = transit - m_lastTransit;
+		if (d < 0LL)
+			d = -d;
+
+		m_jitter += (float(d) / 1000.0F - m_jitter) / 16.0F;
+	}
+
+	m_lastTransit = transit;
+	m_haveTransit = true;
+
+	if (m_running) {
+		int32_t diff = int32_t(timestamp - m_nextTimestamp);
+
+		if (m_started && (diff < -int32_t(FRAME_MS / 2U))) {
+			// Its time has already passed
+			m_dropped++;
+			return false;
+		}
+
+		// A reordered first frame can still be played
+		if (!m_started && (diff < 0))
+			m_nextTimestamp = timestamp;
+	}
+
+	if (findFrame(timestamp) >= 0)
+		return false;
+
+	JB_SLOT* slot = nullptr;
+	for (unsigned int i = 0U; i < JB_SLOTS; i++) {
+		if (!m_slots[i].m_used) {
+			slot = m_slots + i;
+			break;
+		}
+	}
+
+	if (slot == nullptr) {
+		LogWarning("%s: jitter buffer is full, dropping a frame", m_name);
+		m_dropped++;
+		return false;
+	}
+
+	slot->m_used      = true;
+	slot->m_timestamp = timestamp;
+	slot->m_length    = nSamples;
+	::memcpy(slot->m_audio, audio, nSamples * sizeof(int16_t));
+	m_count++;
+
+	if (!m_running) {
+		// The start of a new burst of audio, the delay is sized from the jitter seen so far
+		unsigned int delay = FRAME_MS + (unsigned int)(JITTER_FACTOR * m_jitter + 0.5F);
+		if (delay < MIN_DELAY_MS)
+			delay = MIN_DELAY_MS;
+		if (delay > MAX_DELAY_MS)
+			delay = MAX_DELAY_MS;
+
+		m_delayMS       = delay;
+		m_running       = true;
+		m_started       = false;
+		m_ending        = false;
+		m_concealed     = 0U;
+		m_nextTimestamp = timestamp;
+		m_nextPlayUS    = nowUS + delay * 1000ULL;
+	}
+
+	return true;
+}
+
+unsigned int CJitterBuffer::read(int16_t* audio, unsigned int nSamples)
+{
+	assert(audio != nullptr);
+
+	if (!m_running)
+		return 0U;
+
+	unsigned long long nowUS = m_stopWatch.elapsedUS();
+
+	unsigned int n = 0U;
+
+	while (m_running && (m_nextPlayUS <= nowUS)) {
+		int i = findFrame(m_nextTimestamp);
+		if (i >= 0) {
+			JB_SLOT& slot = m_slots[i];
+			if ((n + slot.m_length) > nSamples)
+				break;
+
+			::memcpy(audio + n, slot.m_audio, slot.m_length * sizeof(int16_t));
+			::memcpy(m_last, slot.m_audio, slot.m_length * sizeof(int16_t));
+			m_lastLength = slot.m_length;
+			n += slot.m_length;
+
+			unsigned int ms = slot.m_length / SAMPLES_PER_MS;
+			m_nextTimestamp = slot.m_timestamp + ms;
+			m_nextPlayUS   += ms * 1000ULL;
+
+			slot.m_used = false;
+			m_count--;
+
+			m_started   = true;
+			m_concealed = 0U;
+
+			discardBefore(m_nextTimestamp);
+			continue;
+		}
+
+		// A frame is missing, if nothing follows it the audio has probably finished
+		bool later = hasLaterFrame();
+		if (!later && (m_ending || (m_concealed >= MAX_CONCEAL))) {
+			stop();
+			break;
+		}
+
+		unsigned int length = (m_lastLength > 0U) ? m_lastLength : FRAME_SAMPLES;
+		if ((n + length) > nSamples)
+			break;
+
+		if ((m_lastLength > 0U) && (m_concealed < MAX_CONCEAL)) {
+			// Repeat the last frame, halving its level each time
+			for (unsigned int j = 0U; j < length; j++)
+				audio[n + j] = int16_t(m_last[j] >> (m_concealed + 1U));
+		} else {
+			::memset(audio + n, 0x00, length * sizeof(int16_t));
+		}
+
+		n += length;
+
+		if (later)
+			m_lost++;
+
+		m_concealed++;
+
+		unsigned int ms = length / SAMPLES_PER_MS;
+		m_nextTimestamp += ms;
+		m_nextPlayUS    += ms * 1000ULL;
+
+		discardBefore(m_nextTimestamp);
+	}
+
+	return n;
+}
+
+unsigned int CJitterBuffer::read(CMixer& mixer, unsigned int source)
+{
+	int16_t audio[MAX_FRAME_SAMPLES];
+
+	// With room for the longest frame the next one always fits, so a due frame is never left behind
+	unsigned int total = 0U;
+	while (mixer.hasSpace(source, MAX_FRAME_SAMPLES)) {
+		unsigned int n = read(audio, MAX_FRAME_SAMPLES);
+		if (n == 0U)
+			break;
+
+		mixer.addData(source, audio, n);
+		total += n;
+	}
+
+	return total;
+}
+
+void CJitterBuffer::end()
+{
+	m_ending = true;
+}
+
+void CJitterBuffer::reset()
+{
+	stop();
+
+	m_haveTransit = false;
+	m_lastTransit = 0LL;
+	m_jitter      = 0.0F;
+	m_highest     = 0U;
+	m_received    = 0U;
+	m_lost        = 0U;
+	m_dropped     = 0U;
+	m_ooo         = 0U;
+	m_delayMS     = MIN_DELAY_MS;
+}
+
+unsigned int CJitterBuffer::getNextTimeout() const
+{
+	if (!m_running)
+		return NO_TIMEOUT;
+
+	unsigned long long nowUS = m_stopWatch.elapsedUS();
+	if (m_nextPlayUS <= nowUS)
+		return 0U;
+
+	return (unsigned int)((m_nextPlayUS - nowUS + 999ULL) / 1000ULL);
+}
+
+uint32_t CJitterBuffer::getJitter() const
+{
+	return uint32_t(m_jitter + 0.5F);
+}
+
+uint32_t CJitterBuffer::getLost() const
+{
+	return m_lost;
+}
+
+uint32_t CJitterBuffer::getReceived() const
+{
+	return m_received;
+}
+
+uint16_t CJitterBuffer::getDelay() const
+{
+	return uint16_t(m_delayMS);
+}
+
+uint32_t CJitterBuffer::getDropped() const
+{
+	return m_dropped;
+}
+
+uint32_t CJitterBuffer::getOutOfOrder() const
+{
+	return m_ooo;
+}
+
+int CJitterBuffer::findFrame(uint32_t timestamp) const
+{
+	if (m_count == 0U)
+		return -1;
+
+	// Timestamps within half a frame are taken to be the same frame
+	for (unsigned int i = 0U; i < JB_SLOTS; i++) {
+		if (!m_slots[i].m_used)
+			continue;
+
+		int32_t diff = int32_t(m_slots[i].m_timestamp - timestamp);
+		if ((diff > -int32_t(FRAME_MS / 2U)) && (diff < int32_t(FRAME_MS / 2U)))
+			return int(i);
+	}
+
+	return -1;
+}
+
+bool CJitterBuffer::hasLaterFrame() const
+{
+	for (unsigned int i = 0U; i < JB_SLOTS; i++) {
+		if (m_slots[i].m_used && (int32_t(m_slots[i].m_timestamp - m_nextTimestamp) >= 0))
+			return true;
+	}
+
+	return false;
+}
+
+void CJitterBuffer::discardBefore(uint32_t timestamp)
+{
+	if (m_count == 0U)
+		return;
+
+	for (unsigned int i = 0U; i < JB_SLOTS; i++) {
+		if (m_slots[i].m_used && (int32_t(m_slots[i].m_timestamp - timestamp) <= -int32_t(FRAME_MS / 2U))) {
+			m_slots[i].m_used = false;
+			m_count--;
+			m_dropped++;
+		}
+	}
+}
+
+void CJitterBuffer::stop()
+{
+	for (unsigned int i = 0U; i < JB_SLOTS; i++)
+		m_slots[i].m_used = false;
+
+	m_count      = 0U;
+	m_lastLength = 0U;
+	m_running    = false;
+	m_started    = false;
+	m_ending     = false;
+	m_concealed  = 0U;
+}
@@ -0,0 +1,96 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(JitterBuffer_H)
+#define	JitterBuffer_H
+
+#include "StopWatch.h"
+
+#include <cstdint>
+
+class CMixer;
+
+// Holds received audio frames by their sender timestamp, in milliseconds, and plays them out
+// after a delay sized from the measured jitter. Frames are reordered, late ones are dropped and
+// missing ones are covered by repeating the last good frame at a reduced level.
+class CJitterBuffer {
+public:
+	CJitterBuffer(const char* name);
+	~CJitterBuffer();
+
+	bool addFrame(uint32_t timestamp, const int16_t* audio, unsigned int nSamples);
+
+	// Returns the audio that is due to be played now, in whole frames
+	unsigned int read(int16_t* audio, unsigned int nSamples);
+
+	// As above but into a source of the mixer, frames of any valid length are moved whole
+	unsigned int read(CMixer& mixer, unsigned int source);
+
+	// No more frames are expected, so play out what is left without concealment
+	void end();
+
+	void reset();
+
+	// The time in milliseconds until the next frame is due
+	unsigned int getNextTimeout() const;
+
+	uint32_t getJitter() const;
+	uint32_t getLost() const;
+	uint32_t getReceived() const;
+	uint16_t getDelay() const;
+	uint32_t getDropped() const;
+	uint32_t getOutOfOrder() const;
+
+private:
+	struct JB_SLOT {
+		bool         m_used;
+		uint32_t     m_timestamp;
+		unsigned int m_length;
+		int16_t*     m_audio;
+	};
+
+	const char*        m_name;
+	CStopWatch         m_stopWatch;
+	int16_t*           m_audio;
+	JB_SLOT*           m_slots;
+	unsigned int       m_count;
+	int16_t*           m_last;
+	unsigned int       m_lastLength;
+	bool               m_running;
+	bool               m_started;
+	bool               m_ending;
+	uint32_t           m_nextTimestamp;
+	unsigned long long m_nextPlayUS;
+	unsigned int       m_delayMS;
+	unsigned int       m_concealed;
+	bool               m_haveTransit;
+	long long          m_lastTransit;
+	float              m_jitter;
+	uint32_t           m_highest;
+	uint32_t           m_received;
+	uint32_t           m_lost;
+	uint32_t           m_dropped;
+	uint32_t           m_ooo;
+
+	int  findFrame(uint32_t timestamp) const;
+	bool hasLaterFrame() const;
+	void discardBefore(uint32_t timestamp);
+	void stop();
+};
+
+#endif
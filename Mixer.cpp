@@ -0,0 +1,176 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Mixer.h"
+#include "AudioConvert.h"
+
+#include <cassert>
+#include <cstring>
+
+// Half a second of audio for each source
+const unsigned int BUFFER_LENGTH = 4000U;
+
+// The gains are in Q12, so this is unity
+const float UNITY_GAIN = 4096.0F;
+const float MAX_GAIN   = 8.0F;
+
+// The limiter keeps the peaks below this, and recovers by about 5 dB a second
+const float LIMIT        = 29491.0F;
+const float RELEASE_STEP = 1.0116F;
+
+CMixer::CMixer(unsigned int sources, unsigned int frameSamples) :
+m_frameSamples(frameSamples),
+m_buffers(),
+m_gains(sources, int16_t(UNITY_GAIN)),
+m_bus(nullptr),
+m_gain(1.0F)
+{
+	assert(sources > 0U);
+	assert(frameSamples > 0U);
+
+	for (unsigned int i = 0U; i < sources; i++)
+		m_buffers.push_back(new CRingBuffer<int16_t>(BUFFER_LENGTH, "Mixer"));
+
+	m_bus = new int32_t[frameSamples];
+}
+
+CMixer::~CMixer()
+{
+	for (std::vector<CRingBuffer<int16_t>*>::const_iterator it = m_buffers.cbegin(); it != m_buffers.cend(); ++it)
+		delete *it;
+
+	delete[] m_bus;
+}
+
+void CMixer::setGain(unsigned int source, float gain)
+{
+	assert(source < m_gains.size());
+
+	if (gain < 0.0F)
+		gain = 0.0F;
+	if (gain > MAX_GAIN)
+		gain = MAX_GAIN;
+
+	float value = gain * UNITY_GAIN + 0.5F;
+	m_gains[source] = (value >= 32767.0F) ? 32767 : int16_t(value);
+}
+
+bool CMixer::addData(unsigned int source, const int16_t* data, unsigned int nSamples)
+{
+	assert(source < m_buffers.size());
+	assert(data != nullptr);
+
+	return m_buffers[source]->addData(data, nSamples);
+}
+
+bool CMixer::hasSpace(unsigned int source, unsigned int nSamples) const
+{
+	assert(source < m_buffers.size());
+
+	return m_buffers[source]->hasSpace(nSamples);
+}
+
+bool CMixer::isEmpty() const
+{
+	for (std::vector<CRingBuffer<int16_t>*>::const_iterator it = m_buffers.cbegin(); it != m_buffers.cend(); ++it) {
+		if (!(*it)->isEmpty())
+			return false;
+	}
+
+	return true;
+}
+
+unsigned int CMixer::mix(int16_t* out, bool partial)
+{
+	assert(out != nullptr);
+
+	unsigned int n = 0U;
+	for (std::vector<CRingBuffer<int16_t>*>::const_iterator it = m_buffers.cbegin(); it != m_buffers.cend(); ++it) {
+		unsigned int size = (*it)->dataSize();
+		if (size > n)
+			n = size;
+	}
+
+	if (n > m_frameSamples)
+		n = m_frameSamples;
+
+	if ((n == 0U) || ((n < m_frameSamples) && !partial))
+		return 0U;
+
+	::memset(m_bus, 0x00, n * sizeof(int32_t));
+
+	// A source that is short of audio only adds what it has
+	for (unsigned int i = 0U; i < m_buffers.size(); i++) {
+		const int16_t* data1 = nullptr;
+		const int16_t* data2 = nullptr;
+		unsigned int length1 = 0U, length2 = 0U;
+
+		unsigned int length = m_buffers[i]->acquireRead(n, data1, length1, data2, length2);
+		if (length == 0U)
+			continue;
+
+		CAudioConvert::mixS16(data1, m_gains[i], m_bus, length1);
+		if (length2 > 0U)
+			CAudioConvert::mixS16(data2, m_gains[i], m_bus + length1, length2);
+
+		m_buffers[i]->commitRead(length);
+	}
+
+	int32_t peak = 0;
+	for (unsigned int i = 0U; i < n; i++) {
+		int32_t mag = (m_bus[i] < 0) ? -m_bus[i] : m_bus[i];
+		if (mag > peak)
+			peak = mag;
+	}
+
+	float wanted = (float(peak) > LIMIT) ? (LIMIT / float(peak)) : 1.0F;
+
+	// Cut straight to a gain that doesn't clip, and ramp back up across the frame
+	float start  = m_gain;
+	float target = start * RELEASE_STEP;
+	if (target > 1.0F)
+		target = 1.0F;
+	if (wanted < target)
+		start = target = wanted;
+
+	m_gain = target;
+
+	if ((start == 1.0F) && (target == 1.0F)) {
+		for (unsigned int i = 0U; i < n; i++)
+			out[i] = (m_bus[i] > 32767) ? 32767 : ((m_bus[i] < -32768) ? -32768 : int16_t(m_bus[i]));
+	} else {
+		float step = (target - start) / float(n);
+
+		for (unsigned int i = 0U; i < n; i++) {
+			float value = float(m_bus[i]) * (start + step * float(i));
+			value += (value >= 0.0F) ? 0.5F : -0.5F;
+
+			out[i] = (value >= 32767.0F) ? 32767 : ((value <= -32768.0F) ? -32768 : int16_t(value));
+		}
+	}
+
+	return n;
+}
+
+void CMixer::reset()
+{
+	for (std::vector<CRingBuffer<int16_t>*>::const_iterator it = m_buffers.cbegin(); it != m_buffers.cend(); ++it)
+		(*it)->clear();
+
+	m_gain = 1.0F;
+}
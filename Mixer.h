@@ -0,0 +1,59 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(Mixer_H)
+#define	Mixer_H
+
+#include "RingBuffer.h"
+
+#include <cstdint>
+#include <vector>
+
+// Combines the audio from several sources into one stream, a frame at a time. Each source has
+// its own gain, and the sum passes through a limiter whose gain falls at once when a frame
+// would clip and recovers slowly afterwards. The cost of a frame depends only on its length
+// and the number of sources.
+class CMixer {
+public:
+	CMixer(unsigned int sources, unsigned int frameSamples);
+	~CMixer();
+
+	// A linear gain, limited to between zero and eight
+	void setGain(unsigned int source, float gain);
+
+	bool addData(unsigned int source, const int16_t* data, unsigned int nSamples);
+
+	bool hasSpace(unsigned int source, unsigned int nSamples) const;
+
+	bool isEmpty() const;
+
+	// Mixes the next frame from every source with audio. Nothing is mixed until a source has a
+	// whole frame, unless partial is set, returns the number of samples.
+	unsigned int mix(int16_t* out, bool partial);
+
+	void reset();
+
+private:
+	unsigned int                       m_frameSamples;
+	std::vector<CRingBuffer<int16_t>*> m_buffers;
+	std::vector<int16_t>               m_gains;
+	int32_t*                           m_bus;
+	float                              m_gain;
+};
+
+#endif
@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2020,2021,2023,2024 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2020,2021,2023,2024,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -17,8 +17,78 @@
  */
 
 #include "Network.h"
+#include "AudioConvert.h"
+
+#include <cassert>
+#include <cstring>
+
+const unsigned int CONVERT_LENGTH = 500U;
 
 INetwork::~INetwork()
 {
 }
 
+bool INetwork::writeSilence(unsigned int level)
+{
+	return true;
+}
+
+void INetwork::flush()
+{
+}
+
+bool INetwork::writeData(const int16_t* data1, unsigned int length1, const int16_t* data2, unsigned int length2)
+{
+	assert(data1 != nullptr || length1 == 0U);
+	assert(data2 != nullptr || length2 == 0U);
+
+	if (length2 == 0U)
+		return writeData(data1, length1);
+
+	int16_t audio[CONVERT_LENGTH];
+
+	assert((length1 + length2) <= CONVERT_LENGTH);
+
+	::memcpy(audio, data1, length1 * sizeof(int16_t));
+	::memcpy(audio + length1, data2, length2 * sizeof(int16_t));
+
+	return writeData(audio, length1 + length2);
+}
+
+bool INetwork::writeData(const float* data, unsigned int nSamples)
+{
+	assert(data != nullptr);
+
+	int16_t audio[CONVERT_LENGTH];
+
+	while (nSamples > 0U) {
+		unsigned int n = (nSamples > CONVERT_LENGTH) ? CONVERT_LENGTH : nSamples;
+
+		CAudioConvert::floatToS16(data, audio, n);
+
+		bool ret = writeData(audio, n);
+		if (!ret)
+			return false;
+
+		data     += n;
+		nSamples -= n;
+	}
+
+	return true;
+}
+
+unsigned int INetwork::readData(float* out, unsigned int nOut)
+{
+	assert(out != nullptr);
+
+	if (nOut > CONVERT_LENGTH)
+		nOut = CONVERT_LENGTH;
+
+	int16_t audio[CONVERT_LENGTH];
+	unsigned int n = readData(audio, nOut);
+
+	CAudioConvert::s16ToFloat(audio, out, n);
+
+	return n;
+}
+
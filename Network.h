@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2020,2021,2023,2024 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2020,2021,2023,2024,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -19,6 +19,9 @@
 #ifndef	Network_H
 #define	Network_H
 
+#include "AudioFormat.h"
+#include "EventLoop.h"
+
 #include <cstdint>
 #include <string>
 
@@ -30,17 +33,42 @@ public:
 
 	virtual bool writeStart(const std::string& callsign) = 0;
 
-	virtual bool writeData(const float* data, unsigned int nSamples) = 0;
+	// Audio is passed as 16-bit samples as they are on the network
+	virtual bool writeData(const int16_t* data, unsigned int nSamples) = 0;
 
 	virtual bool writeEnd() = 0;
 
-	virtual unsigned int readData(float* out, unsigned int nOut) = 0;
+	// Called once when silent audio starts to be suppressed, the level is in -dBov.
+	// By default nothing is sent.
+	virtual bool writeSilence(unsigned int level);
+
+	virtual unsigned int readData(int16_t* out, unsigned int nOut) = 0;
+
+	// Audio held in two parts, such as a ring buffer span. By default the parts are joined.
+	virtual bool writeData(const int16_t* data1, unsigned int length1, const int16_t* data2, unsigned int length2);
+
+	virtual AUDIO_FORMAT getFormat() const = 0;
+
+	// Float audio for processing, converted with CAudioConvert
+	virtual bool writeData(const float* data, unsigned int nSamples);
+
+	virtual unsigned int readData(float* out, unsigned int nOut);
+
+	// Sends any audio that the writes since the last call have been holding back to send
+	// together. Called after each pass of writes, by default nothing is held.
+	virtual void flush();
 
 	virtual void reset() = 0;
 
 	virtual void close() = 0;
 
-	virtual void clock(unsigned int ms) = 0;
+	// The time since the last call, in microseconds
+	virtual void clock(unsigned int us) = 0;
+
+	virtual void registerSockets(CEventLoop& loop) = 0;
+
+	// The time in milliseconds before clock() next has work to do
+	virtual unsigned int getNextTimeout() const = 0;
 
 private:
 };
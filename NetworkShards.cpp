@@ -0,0 +1,490 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "NetworkShards.h"
+#include "StopWatch.h"
+#include "Log.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+// The audio is mixed as 20 ms frames at 8 kHz
+const unsigned int       FRAME_SAMPLES = 160U;
+const unsigned long long FRAME_NS      = 20000000ULL;
+
+// The commands to the shards, as bytes, and the audio from each shard, as samples
+const unsigned int COMMANDS_LENGTH = 32768U;
+const unsigned int AUDIO_LENGTH    = 8000U;
+
+// Each command is its type followed by the length of its data, in bytes, as two bytes
+const unsigned int HEADER_LENGTH     = 3U;
+const unsigned int MAX_COMMAND_DATA  = 960U;
+
+const uint8_t COMMAND_START   = 0x01U;
+const uint8_t COMMAND_DATA    = 0x02U;
+const uint8_t COMMAND_END     = 0x03U;
+const uint8_t COMMAND_SILENCE = 0x04U;
+const uint8_t COMMAND_RESET   = 0x05U;
+
+// A shard still clocks its network at least this often, in milliseconds, even with nothing to do
+const unsigned int MAX_WAIT = 1000U;
+
+// How often, in nanoseconds, the statistics of the shards are published
+const unsigned long long STATS_INTERVAL = 60000000000ULL;
+
+CNetworkShard::CNetworkShard(CNetworkShards& shards, unsigned int shard) :
+CThread(),
+m_shards(shards),
+m_shard(shard)
+{
+}
+
+CNetworkShard::~CNetworkShard()
+{
+}
+
+void CNetworkShard::entry()
+{
+	m_shards.pin(m_shard);
+
+	m_shards.work(m_shard);
+}
+
+CNetworkShards::SHARD::SHARD(INetwork* network, int cpu) :
+m_network(network),
+m_cpu(cpu),
+m_thread(nullptr),
+m_loop(),
+m_wakeup(),
+m_commands(COMMANDS_LENGTH, "Shard Commands"),
+m_audio(AUDIO_LENGTH, "Shard Audio"),
+m_passes(0U),
+m_busy(0ULL),
+m_samples(0U)
+{
+}
+
+CNetworkShards::CNetworkShards(const std::string& name, unsigned int link, const std::vector<INetwork*>& networks, const std::vector<unsigned int>& cpus) :
+m_name(name),
+m_link(link),
+m_shards(),
+m_wakeup(),
+m_mixer((unsigned int)networks.size(), FRAME_SAMPLES),
+m_mixTime(0ULL),
+m_format(),
+m_written(false),
+m_stopped(false),
+m_statsTime(0ULL)
+{
+	assert(!networks.empty());
+
+	for (unsigned int i = 0U; i < networks.size(); i++) {
+		int cpu = (i < cpus.size()) ? int(cpus[i]) : -1;
+
+		SHARD* shard = new SHARD(networks[i], cpu);
+		shard->m_thread = new CNetworkShard(*this, i);
+
+		m_shards.push_back(shard);
+	}
+}
+
+CNetworkShards::~CNetworkShards()
+{
+	for (std::vector<SHARD*>::const_iterator it = m_shards.cbegin(); it != m_shards.cend(); ++it) {
+		delete (*it)->m_thread;
+		delete (*it)->m_network;
+		delete *it;
+	}
+}
+
+bool CNetworkShards::open()
+{
+	for (std::vector<SHARD*>::const_iterator it = m_shards.cbegin(); it != m_shards.cend(); ++it) {
+		bool ret = (*it)->m_network->open();
+		if (!ret)
+			return false;
+	}
+
+	// Read before the threads start, the format of an inbound network doesn't change
+	m_format = m_shards.front()->m_network->getFormat();
+
+	for (std::vector<SHARD*>::const_iterator it = m_shards.cbegin(); it != m_shards.cend(); ++it) {
+		SHARD* shard = *it;
+
+		bool ret = shard->m_wakeup.open();
+		if (!ret)
+			return false;
+
+		shard->m_loop.setGroup(0U);
+		shard->m_network->registerSockets(shard->m_loop);
+		shard->m_loop.addWakeup(shard->m_wakeup);
+
+		ret = shard->m_loop.open();
+		if (!ret)
+			return false;
+	}
+
+	bool ret = m_wakeup.open();
+	if (!ret)
+		return false;
+
+	for (std::vector<SHARD*>::const_iterator it = m_shards.cbegin(); it != m_shards.cend(); ++it) {
+		ret = (*it)->m_thread->run();
+		if (!ret) {
+			LogError("Unable to start a %s network thread", m_name.c_str());
+			return false;
+		}
+	}
+
+	LogMessage("Network %u: the %s network is shared between %u threads", m_link + 1U, m_name.c_str(), (unsigned int)m_shards.size());
+
+	m_statsTime = CEventLoop::now();
+
+	return true;
+}
+
+bool CNetworkShards::writeStart(const std::string& callsign)
+{
+	return writeCommand(COMMAND_START, (const uint8_t*)callsign.c_str(), (unsigned int)callsign.size());
+}
+
+bool CNetworkShards::writeData(const int16_t* data, unsigned int nSamples)
+{
+	assert(data != nullptr);
+
+	const unsigned int maxSamples = MAX_COMMAND_DATA / sizeof(int16_t);
+
+	while (nSamples > 0U) {
+		unsigned int n = (nSamples < maxSamples) ? nSamples : maxSamples;
+
+		bool ret = writeCommand(COMMAND_DATA, (const uint8_t*)data, n * sizeof(int16_t));
+		if (!ret)
+			return false;
+
+		data     += n;
+		nSamples -= n;
+	}
+
+	return true;
+}
+
+bool CNetworkShards::writeEnd()
+{
+	return writeCommand(COMMAND_END, nullptr, 0U);
+}
+
+bool CNetworkShards::writeSilence(unsigned int level)
+{
+	uint8_t data = uint8_t(level);
+
+	return writeCommand(COMMAND_SILENCE, &data, 1U);
+}
+
+void CNetworkShards::flush()
+{
+	if (!m_written)
+		return;
+
+	for (std::vector<SHARD*>::const_iterator it = m_shards.cbegin(); it != m_shards.cend(); ++it)
+		(*it)->m_wakeup.signal();
+
+	m_written = false;
+}
+
+unsigned int CNetworkShards::readData(int16_t* out, unsigned int nOut)
+{
+	assert(out != nullptr);
+	assert(nOut > 0U);
+
+	for (unsigned int i = 0U; i < m_shards.size(); i++) {
+		CSPSCRingBuffer<int16_t>& audio = m_shards[i]->m_audio;
+
+		const int16_t* data1;
+		const int16_t* data2;
+		unsigned int length1, length2;
+		unsigned int n = audio.acquireRead(audio.dataSize(), data1, length1, data2, length2);
+		if ((n == 0U) || !m_mixer.hasSpace(i, n))
+			continue;
+
+		m_mixer.addData(i, data1, length1);
+		if (length2 > 0U)
+			m_mixer.addData(i, data2, length2);
+
+		audio.commitRead(n);
+	}
+
+	if (m_mixer.isEmpty() || (nOut < FRAME_SAMPLES))
+		return 0U;
+
+	// Each shard already paces its own audio, the mix of them is taken on a 20 ms grid as well
+	unsigned long long now = CEventLoop::now();
+	if (now > (m_mixTime + FRAME_NS))
+		m_mixTime = now;
+
+	if (now < m_mixTime)
+		return 0U;
+
+	unsigned int n = m_mixer.mix(out, true);
+	if (n > 0U)
+		m_mixTime += FRAME_NS;
+
+	return n;
+}
+
+AUDIO_FORMAT CNetworkShards::getFormat() const
+{
+	return m_format;
+}
+
+void CNetworkShards::reset()
+{
+	writeCommand(COMMAND_RESET, nullptr, 0U);
+	flush();
+
+	for (std::vector<SHARD*>::const_iterator it = m_shards.cbegin(); it != m_shards.cend(); ++it)
+		(*it)->m_audio.commitRead((*it)->m_audio.dataSize());
+
+	m_mixer.reset();
+}
+
+void CNetworkShards::close()
+{
+	m_stopped = true;
+
+	for (std::vector<SHARD*>::const_iterator it = m_shards.cbegin(); it != m_shards.cend(); ++it)
+		(*it)->m_wakeup.signal();
+
+	for (std::vector<SHARD*>::const_iterator it = m_shards.cbegin(); it != m_shards.cend(); ++it)
+		(*it)->m_thread->wait();
+
+	// The threads have gone, so the networks can be closed from here
+	for (std::vector<SHARD*>::const_iterator it = m_shards.cbegin(); it != m_shards.cend(); ++it) {
+		SHARD* shard = *it;
+
+		shard->m_network->close();
+		shard->m_loop.close();
+		shard->m_wakeup.close();
+	}
+
+	m_wakeup.close();
+}
+
+void CNetworkShards::clock(unsigned int us)
+{
+	unsigned long long now = CEventLoop::now();
+	if (now >= (m_statsTime + STATS_INTERVAL))
+		publish(now);
+}
+
+void CNetworkShards::registerSockets(CEventLoop& loop)
+{
+	// The shards' own sockets are on their own event loops, the link is only woken for their audio
+	loop.addWakeup(m_wakeup);
+}
+
+unsigned int CNetworkShards::getNextTimeout() const
+{
+	if (m_mixer.isEmpty())
+		return NO_TIMEOUT;
+
+	unsigned long long now = CEventLoop::now();
+
+	return (m_mixTime > now) ? (unsigned int)((m_mixTime - now + 999999ULL) / 1000000ULL) : 0U;
+}
+
+bool CNetworkShards::writeCommand(uint8_t type, const uint8_t* data, unsigned int length)
+{
+	assert(length <= MAX_COMMAND_DATA);
+
+	uint8_t buffer[HEADER_LENGTH + MAX_COMMAND_DATA];
+
+	buffer[0U] = type;
+	buffer[1U] = (length >> 8) & 0xFFU;
+	buffer[2U] = (length >> 0) & 0xFFU;
+
+	if (length > 0U)
+		::memcpy(buffer + HEADER_LENGTH, data, length);
+
+	// Each command is added whole, so a shard never sees part of one
+	bool ok = true;
+	for (std::vector<SHARD*>::const_iterator it = m_shards.cbegin(); it != m_shards.cend(); ++it) {
+		bool ret = (*it)->m_commands.addData(buffer, HEADER_LENGTH + length);
+		if (!ret)
+			ok = false;
+	}
+
+	m_written = true;
+
+	return ok;
+}
+
+void CNetworkShards::work(unsigned int shard)
+{
+	assert(shard < m_shards.size());
+
+	SHARD& state = *m_shards[shard];
+
+	int16_t buffer[FRAME_SAMPLES];
+
+	CStopWatch stopWatch;
+	stopWatch.start();
+
+	unsigned long long lastUS = 0ULL;
+
+	while (!m_stopped) {
+		unsigned int ms = state.m_network->getNextTimeout();
+		if (ms > MAX_WAIT)
+			ms = MAX_WAIT;
+
+		bool ret = state.m_loop.waitUntil(CEventLoop::now() + ms * 1000000ULL);
+		if (!ret)
+			CThread::sleep(10U);
+
+		unsigned long long start = CEventLoop::now();
+
+		unsigned long long elapsedUS = stopWatch.elapsedUS();
+		unsigned int us = (unsigned int)(elapsedUS - lastUS);
+		lastUS = elapsedUS;
+
+		state.m_network->clock(us);
+
+		runCommands(state);
+
+		bool added = false;
+		while (state.m_audio.hasSpace(FRAME_SAMPLES)) {
+			unsigned int n = state.m_network->readData(buffer, FRAME_SAMPLES);
+			if (n == 0U)
+				break;
+
+			state.m_audio.addData(buffer, n);
+			state.m_samples += n;
+			added = true;
+		}
+
+		if (added)
+			m_wakeup.signal();
+
+		state.m_passes++;
+		state.m_busy += CEventLoop::now() - start;
+	}
+}
+
+void CNetworkShards::runCommands(SHARD& shard)
+{
+	CSPSCRingBuffer<uint8_t>& commands = shard.m_commands;
+	INetwork* network = shard.m_network;
+
+	bool any = false;
+
+	uint8_t buffer[MAX_COMMAND_DATA];
+	uint8_t header[HEADER_LENGTH];
+	while (commands.dataSize() >= HEADER_LENGTH) {
+		commands.getData(header, HEADER_LENGTH);
+
+		unsigned int length = (header[1U] << 8) | (header[2U] << 0);
+		assert(length <= MAX_COMMAND_DATA);
+
+		if (length > 0U)
+			commands.getData(buffer, length);
+
+		switch (header[0U]) {
+			case COMMAND_START:
+				network->writeStart(std::string((const char*)buffer, length));
+				break;
+			case COMMAND_DATA:
+				network->writeData((const int16_t*)buffer, length / sizeof(int16_t));
+				break;
+			case COMMAND_END:
+				network->writeEnd();
+				break;
+			case COMMAND_SILENCE:
+				network->writeSilence(buffer[0U]);
+				break;
+			case COMMAND_RESET:
+				network->reset();
+				break;
+			default:
+				break;
+		}
+
+		any = true;
+	}
+
+	if (any)
+		network->flush();
+}
+
+bool CNetworkShards::pin(unsigned int shard)
+{
+	assert(shard < m_shards.size());
+
+	int cpu = m_shards[shard]->m_cpu;
+	if (cpu < 0)
+		return true;
+
+	bool ret = CThread::setAffinity((unsigned int)cpu);
+	if (!ret) {
+		LogWarning("Network %u: unable to pin %s shard %u to CPU %d", m_link + 1U, m_name.c_str(), shard, cpu);
+		return false;
+	}
+
+	LogMessage("Network %u: %s shard %u is pinned to CPU %d", m_link + 1U, m_name.c_str(), shard, cpu);
+
+	return true;
+}
+
+void CNetworkShards::publish(unsigned long long now)
+{
+	double interval = double(now - m_statsTime);
+
+	nlohmann::json shards = nlohmann::json::array();
+
+	for (unsigned int i = 0U; i < m_shards.size(); i++) {
+		SHARD& stats = *m_shards[i];
+
+		unsigned int       passes  = stats.m_passes.exchange(0U);
+		unsigned long long busy    = stats.m_busy.exchange(0ULL);
+		unsigned int       samples = stats.m_samples.exchange(0U);
+
+		double load = (interval > 0.0) ? (100.0 * double(busy) / interval) : 0.0;
+
+		LogDebug("Network %u: %s shard %u: %u passes, %.1f%% busy, %u samples received", m_link + 1U, m_name.c_str(), i, passes, load, samples);
+
+		nlohmann::json json;
+
+		json["shard"]   = i;
+		json["cpu"]     = stats.m_cpu;
+		json["passes"]  = passes;
+		json["load"]    = std::round(load * 10.0) / 10.0;
+		json["samples"] = samples;
+
+		shards.push_back(json);
+	}
+
+	nlohmann::json json;
+
+	json["network"]  = m_link + 1U;
+	json["protocol"] = m_name;
+	json["interval"] = std::round(interval / 1000000000.0);
+	json["shards"]   = shards;
+
+	WriteJSON("shards", json);
+
+	m_statsTime = now;
+}
@@ -0,0 +1,121 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(NetworkShards_H)
+#define	NetworkShards_H
+
+#include "SPSCRingBuffer.h"
+#include "EventLoop.h"
+#include "Network.h"
+#include "Wakeup.h"
+#include "Thread.h"
+#include "Mixer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CNetworkShards;
+
+class CNetworkShard : public CThread {
+public:
+	CNetworkShard(CNetworkShards& shards, unsigned int shard);
+	virtual ~CNetworkShard();
+
+	virtual void entry();
+
+private:
+	CNetworkShards& m_shards;
+	unsigned int    m_shard;
+};
+
+// Copies of a network that share the port that they accept calls on, each run by its own thread
+// with its own socket and event loop. The kernel gives each socket its share of the peers by a
+// hash of their addresses, so every peer stays with one shard. The audio from the FM side goes
+// to every shard, and the audio from the shards is mixed on the link's thread. Each direction
+// passes through a lock free ring buffer, and a wake up tells the other side that it has work.
+class CNetworkShards : public INetwork {
+public:
+	CNetworkShards(const std::string& name, unsigned int link, const std::vector<INetwork*>& networks, const std::vector<unsigned int>& cpus);
+	virtual ~CNetworkShards();
+
+	virtual bool open();
+
+	virtual bool writeStart(const std::string& callsign);
+
+	virtual bool writeData(const int16_t* data, unsigned int nSamples);
+
+	virtual bool writeEnd();
+
+	virtual bool writeSilence(unsigned int level);
+
+	virtual void flush();
+
+	virtual unsigned int readData(int16_t* out, unsigned int nOut);
+
+	virtual AUDIO_FORMAT getFormat() const;
+
+	virtual void reset();
+
+	virtual void close();
+
+	virtual void clock(unsigned int us);
+
+	virtual void registerSockets(CEventLoop& loop);
+
+	virtual unsigned int getNextTimeout() const;
+
+private:
+	friend class CNetworkShard;
+
+	struct SHARD {
+		SHARD(INetwork* network, int cpu);
+
+		INetwork*                       m_network;
+		int                             m_cpu;
+		CNetworkShard*                  m_thread;
+		CEventLoop                      m_loop;
+		CWakeup                         m_wakeup;
+		CSPSCRingBuffer<uint8_t>        m_commands;
+		CSPSCRingBuffer<int16_t>        m_audio;
+		std::atomic<unsigned int>       m_passes;
+		std::atomic<unsigned long long> m_busy;
+		std::atomic<unsigned int>       m_samples;
+	};
+
+	std::string         m_name;
+	unsigned int        m_link;
+	std::vector<SHARD*> m_shards;
+	CWakeup             m_wakeup;
+	CMixer              m_mixer;
+	unsigned long long  m_mixTime;
+	AUDIO_FORMAT        m_format;
+	bool                m_written;
+	std::atomic<bool>   m_stopped;
+	unsigned long long  m_statsTime;
+
+	bool writeCommand(uint8_t type, const uint8_t* data, unsigned int length);
+
+	void work(unsigned int shard);
+	void runCommands(SHARD& shard);
+	bool pin(unsigned int shard);
+	void publish(unsigned long long now);
+};
+
+#endif
@@ -0,0 +1,256 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef PeerTable_H
+#define PeerTable_H
+
+#include "UDPSocket.h"
+#include "Log.h"
+
+#include <cstdint>
+#include <cassert>
+#include <cstring>
+
+// Finds the state kept for a peer from the address that a packet came from, plus an id for
+// protocols that carry several calls between the same two ports. Everything is allocated when
+// the table is created, so adding, finding and removing a peer never allocate. The slots are
+// open addressed with linear probing and hold the hash of their peer, so a lookup rarely touches
+// more than one cache line. There are at least twice as many slots as peers, rounded up to a
+// power of two, and removal shifts the following slots back rather than leaving tombstones.
+template<class T> class CPeerTable {
+public:
+	struct PEER {
+		sockaddr_storage   m_addr;
+		unsigned int       m_addrLen;
+		uint32_t           m_id;
+		unsigned long long m_packets;
+		unsigned long long m_bytes;
+		T                  m_data;
+	};
+
+	CPeerTable(unsigned int capacity, const char* name) :
+	m_capacity(capacity),
+	m_name(name),
+	m_mask(0U),
+	m_slots(nullptr),
+	m_peers(nullptr),
+	m_free(nullptr),
+	m_count(0U)
+	{
+		assert(capacity > 0U);
+		assert(name != nullptr);
+
+		unsigned int slots = 1U;
+		while (slots < (capacity * 2U))
+			slots <<= 1;
+
+		m_mask  = slots - 1U;
+		m_slots = new SLOT[slots];
+		m_peers = new PEER[capacity];
+		m_free  = new uint32_t[capacity];
+
+		clear();
+	}
+
+	~CPeerTable()
+	{
+		delete[] m_slots;
+		delete[] m_peers;
+		delete[] m_free;
+	}
+
+	PEER* find(const sockaddr_storage& addr, uint32_t id = 0U) const
+	{
+		uint32_t hash = 0U;
+		if (!getHash(addr, id, hash))
+			return nullptr;
+
+		for (uint32_t i = hash & m_mask; m_slots[i].m_index != EMPTY; i = (i + 1U) & m_mask) {
+			if (m_slots[i].m_hash != hash)
+				continue;
+
+			PEER* peer = m_peers + m_slots[i].m_index;
+			if ((peer->m_id == id) && CUDPSocket::match(addr, peer->m_addr, IPMATCHTYPE::ADDRESS_AND_PORT))
+				return peer;
+		}
+
+		return nullptr;
+	}
+
+	// Adds a peer with zeroed counters, or replaces the state of one that is already there
+	PEER* insert(const sockaddr_storage& addr, unsigned int addrLen, uint32_t id, const T& data)
+	{
+		uint32_t hash = 0U;
+		if (!getHash(addr, id, hash))
+			return nullptr;
+
+		PEER* peer = find(addr, id);
+		if (peer != nullptr) {
+			peer->m_data = data;
+			return peer;
+		}
+
+		if (m_count == m_capacity) {
+			LogError("%s peer table is full, %u peers", m_name, m_capacity);
+			return nullptr;
+		}
+
+		uint32_t index = m_free[m_count++];
+
+		peer = m_peers + index;
+		peer->m_addr    = addr;
+		peer->m_addrLen = addrLen;
+		peer->m_id      = id;
+		peer->m_packets = 0ULL;
+		peer->m_bytes   = 0ULL;
+		peer->m_data    = data;
+
+		uint32_t i = hash & m_mask;
+		while (m_slots[i].m_index != EMPTY)
+			i = (i + 1U) & m_mask;
+
+		m_slots[i].m_hash  = hash;
+		m_slots[i].m_index = index;
+
+		return peer;
+	}
+
+	bool erase(const sockaddr_storage& addr, uint32_t id = 0U)
+	{
+		uint32_t hash = 0U;
+		if (!getHash(addr, id, hash))
+			return false;
+
+		uint32_t i = hash & m_mask;
+		for (;;) {
+			if (m_slots[i].m_index == EMPTY)
+				return false;
+
+			if (m_slots[i].m_hash == hash) {
+				const PEER& peer = m_peers[m_slots[i].m_index];
+				if ((peer.m_id == id) && CUDPSocket::match(addr, peer.m_addr, IPMATCHTYPE::ADDRESS_AND_PORT))
+					break;
+			}
+
+			i = (i + 1U) & m_mask;
+		}
+
+		m_free[--m_count] = m_slots[i].m_index;
+
+		// Pull back any later slot that would otherwise no longer be reached from its home slot
+		uint32_t j = i;
+		for (;;) {
+			j = (j + 1U) & m_mask;
+			if (m_slots[j].m_index == EMPTY)
+				break;
+
+			uint32_t home = m_slots[j].m_hash & m_mask;
+			if (((j - home) & m_mask) >= ((j - i) & m_mask)) {
+				m_slots[i] = m_slots[j];
+				i = j;
+			}
+		}
+
+		m_slots[i].m_index = EMPTY;
+
+		return true;
+	}
+
+	void clear()
+	{
+		for (uint32_t i = 0U; i <= m_mask; i++)
+			m_slots[i].m_index = EMPTY;
+
+		for (uint32_t i = 0U; i < m_capacity; i++)
+			m_free[i] = i;
+
+		m_count = 0U;
+	}
+
+	unsigned int size() const
+	{
+		return m_count;
+	}
+
+	bool isEmpty() const
+	{
+		return m_count == 0U;
+	}
+
+private:
+	static const uint32_t EMPTY = 0xFFFFFFFFU;
+
+	struct SLOT {
+		uint32_t m_hash;
+		uint32_t m_index;
+	};
+
+	unsigned int m_capacity;
+	const char*  m_name;
+	uint32_t     m_mask;
+	SLOT*        m_slots;
+	PEER*        m_peers;
+	uint32_t*    m_free;
+	unsigned int m_count;
+
+	// FNV-1a over the family, address, port and id, finished so that the low bits are well mixed
+	static bool getHash(const sockaddr_storage& addr, uint32_t id, uint32_t& hash)
+	{
+		const uint8_t* data = nullptr;
+		unsigned int length = 0U;
+		uint16_t port = 0U;
+
+		switch (addr.ss_family) {
+			case AF_INET: {
+					const sockaddr_in* in = (const sockaddr_in*)&addr;
+					data   = (const uint8_t*)&in->sin_addr;
+					length = sizeof(in->sin_addr);
+					port   = in->sin_port;
+				}
+				break;
+			case AF_INET6: {
+					const sockaddr_in6* in6 = (const sockaddr_in6*)&addr;
+					data   = (const uint8_t*)&in6->sin6_addr;
+					length = sizeof(in6->sin6_addr);
+					port   = in6->sin6_port;
+				}
+				break;
+			default:
+				return false;
+		}
+
+		hash = 0x811C9DC5U;
+		hash = (hash ^ uint8_t(addr.ss_family)) * 0x01000193U;
+		for (unsigned int i = 0U; i < length; i++)
+			hash = (hash ^ data[i]) * 0x01000193U;
+		hash = (hash ^ (port & 0xFFU)) * 0x01000193U;
+		hash = (hash ^ (port >> 8)) * 0x01000193U;
+		for (unsigned int i = 0U; i < 4U; i++)
+			hash = (hash ^ ((id >> (i * 8U)) & 0xFFU)) * 0x01000193U;
+
+		hash ^= hash >> 16;
+		hash *= 0x85EBCA6BU;
+		hash ^= hash >> 13;
+		hash *= 0xC2B2AE35U;
+		hash ^= hash >> 16;
+
+		return true;
+	}
+};
+
+#endif
@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2020,2021,2023,2024,2025 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2020,2021,2023,2024,2025,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -17,6 +17,7 @@
  */
 
 #include "RAWNetwork.h"
+#include "AudioConvert.h"
 #include "Utils.h"
 #include "Log.h"
 
@@ -33,7 +34,15 @@
 
 const unsigned int MMDVM_SAMPLERATE = 8000U;
 
-const unsigned int BUFFER_LENGTH = 1500U;
+// Room for 20 ms of audio at 48 kHz
+const unsigned int BUFFER_LENGTH = 2000U;
+const unsigned int BATCH_COUNT   = 16U;
+
+// Large enough to hold a whole batch of received audio
+const unsigned int RING_BUFFER_LENGTH = 20000U;
+
+// The most audio resampled in one call
+const unsigned int RESAMPLE_LENGTH = 1000U;
 
 CRAWNetwork::CRAWNetwork(const std::string& localAddress, uint16_t localPort, const std::string& gatewayAddress, uint16_t gatewayPort, unsigned int sampleRate, const std::string& squelchFile, bool debug) :
 m_socket(localAddress, localPort),
@@ -42,11 +51,9 @@ m_addrLen(0U),
 m_sampleRate(sampleRate),
 m_squelchFile(squelchFile),
 m_debug(debug),
-m_buffer(2000U, "FM Network"),
-#if defined(HAS_SRC)
-m_resampler(nullptr),
-m_error(0),
-#endif
+m_buffer(RING_BUFFER_LENGTH, "FM Network"),
+m_writeResampler(MMDVM_SAMPLERATE, sampleRate),
+m_readResampler(sampleRate, MMDVM_SAMPLERATE),
 m_fp(nullptr)
 {
 	assert(gatewayPort > 0U);
@@ -55,17 +62,10 @@ m_fp(nullptr)
 
 	if (CUDPSocket::lookup(gatewayAddress, gatewayPort, m_addr, m_addrLen) != 0)
 		m_addrLen = 0U;
-
-#if defined(HAS_SRC)
-	m_resampler = ::src_new(SRC_SINC_FASTEST, 1, &m_error);
-#endif
 }
 
 CRAWNetwork::~CRAWNetwork()
 {
-#if defined(HAS_SRC)
-	::src_delete(m_resampler);
-#endif
 }
 
 bool CRAWNetwork::open()
@@ -89,7 +89,20 @@ bool CRAWNetwork::open()
 		}
 	}
 
-	return m_socket.open(m_addr);
+	bool ret = m_socket.open(m_addr);
+	if (!ret)
+		return false;
+
+	// Writes are sent together when the event loop next waits
+	m_socket.setQueueing(true);
+
+	if (m_sampleRate != MMDVM_SAMPLERATE)
+		LogMessage("Resampling the RAW audio between %u Hz and %u Hz", MMDVM_SAMPLERATE, m_sampleRate);
+
+	m_writeResampler.reset();
+	m_readResampler.reset();
+
+	return true;
 }
 
 bool CRAWNetwork::writeStart(const std::string& callsign)
@@ -102,51 +115,26 @@ bool CRAWNetwork::writeStart(const std::string& callsign)
 	return true;
 }
 
-bool CRAWNetwork::writeData(const float* in, unsigned int nIn)
+bool CRAWNetwork::writeData(const int16_t* in, unsigned int nIn)
 {
 	assert(in != nullptr);
 	assert(nIn > 0U);
 
-	uint8_t buffer[2000U];
+	uint8_t buffer[RESAMPLE_LENGTH * sizeof(int16_t)];
 
 	unsigned int length = 0U;
 
 	if (m_sampleRate != MMDVM_SAMPLERATE) {
-#if defined(HAS_SRC)
-		unsigned int nOut = (nIn * m_sampleRate) / MMDVM_SAMPLERATE;
-
-		float out[1000U];
-
-		SRC_DATA data;
-		data.data_in       = in;
-		data.data_out      = out;
-		data.input_frames  = nIn;
-		data.output_frames = nOut;
-		data.end_of_input  = 0;
-		data.src_ratio     = float(m_sampleRate) / float(MMDVM_SAMPLERATE);
-
-		int ret = ::src_process(m_resampler, &data);
-		if (ret != 0) {
-			LogError("Error from the write resampler - %d - %s", ret, ::src_strerror(ret));
-			return false;
-		}
-
-		for (unsigned int i = 0U; i < nOut; i++) {
-			short val = short(out[i] * 32767.0F + 0.5F);	// Changing audio format from float to S16LE
+		int16_t out[RESAMPLE_LENGTH];
+		unsigned int nOut = m_writeResampler.process(in, nIn, out, RESAMPLE_LENGTH);
+		if (nOut == 0U)
+			return true;
 
-			buffer[length++] = (val >> 0) & 0xFFU;
-			buffer[length++] = (val >> 8) & 0xFFU;
-		}
-#else
-		assert(false);
-#endif
+		CAudioConvert::s16ToS16LE(out, buffer + length, nOut);
+		length += nOut * sizeof(int16_t);
 	} else {
-		for (unsigned int i = 0U; i < nIn; i++) {
-			short val = short(in[i] * 32767.0F + 0.5F);	// Changing audio format from float to S16LE
-
-			buffer[length++] = (val >> 0) & 0xFFU;
-			buffer[length++] = (val >> 8) & 0xFFU;
-		}
+		CAudioConvert::s16ToS16LE(in, buffer + length, nIn);
+		length += nIn * sizeof(int16_t);
 	}
 
 	if (m_debug)
@@ -155,6 +143,18 @@ bool CRAWNetwork::writeData(const float* in, unsigned int nIn)
 	return m_socket.write(buffer, length, m_addr, m_addrLen);
 }
 
+bool CRAWNetwork::writeData(const int16_t* data1, unsigned int length1, const int16_t* data2, unsigned int length2)
+{
+	assert(data1 != nullptr);
+	assert(length1 > 0U);
+
+	// Only unresampled audio can go straight from the caller into the datagram
+	if ((m_sampleRate != MMDVM_SAMPLERATE) || m_debug || !CAudioConvert::isNativeS16LE())
+		return INetwork::writeData(data1, length1, data2, length2);
+
+	return m_socket.write((const uint8_t*)data1, length1 * sizeof(int16_t), (const uint8_t*)data2, length2 * sizeof(int16_t), nullptr, 0U, m_addr, m_addrLen);
+}
+
 bool CRAWNetwork::writeEnd()
 {
 	if (m_fp != nullptr) {
@@ -165,14 +165,32 @@ bool CRAWNetwork::writeEnd()
 	return true;
 }
 
-void CRAWNetwork::clock(unsigned int ms)
+void CRAWNetwork::clock(unsigned int us)
 {
-	uint8_t buffer[BUFFER_LENGTH];
+	uint8_t buffers[BATCH_COUNT * BUFFER_LENGTH];
+	unsigned int lengths[BATCH_COUNT];
+	sockaddr_storage addrs[BATCH_COUNT];
+	unsigned int addrLens[BATCH_COUNT];
+
+	// Drain everything that is waiting on the socket
+	for (;;) {
+		int n = m_socket.readBatch(buffers, BUFFER_LENGTH, BATCH_COUNT, lengths, addrs, addrLens);
+		if (n <= 0)
+			return;
+
+		for (int i = 0; i < n; i++)
+			processPacket(buffers + i * BUFFER_LENGTH, lengths[i], addrs[i]);
+
+		if (n < int(BATCH_COUNT))
+			return;
+	}
+}
+
+void CRAWNetwork::processPacket(const uint8_t* buffer, unsigned int length, const sockaddr_storage& addr)
+{
+	assert(buffer != nullptr);
 
-	sockaddr_storage addr;
-	unsigned int addrlen;
-	int length = m_socket.read(buffer, BUFFER_LENGTH, addr, addrlen);
-	if (length <= 0)
+	if (length == 0U)
 		return;
 
 	if (!CUDPSocket::match(addr, m_addr, IPMATCHTYPE::ADDRESS_ONLY)) {
@@ -186,69 +204,76 @@ void CRAWNetwork::clock(unsigned int ms)
 	m_buffer.addData(buffer, length);
 }
 
-unsigned int CRAWNetwork::readData(float* out, unsigned int nOut)
+void CRAWNetwork::registerSockets(CEventLoop& loop)
+{
+	loop.addSocket(m_socket);
+}
+
+unsigned int CRAWNetwork::getNextTimeout() const
+{
+	return NO_TIMEOUT;
+}
+
+unsigned int CRAWNetwork::readData(int16_t* out, unsigned int nOut)
 {
 	assert(out != nullptr);
 	assert(nOut > 0U);
 
 	unsigned int bytes = m_buffer.dataSize() / sizeof(uint16_t);
-	if (bytes == 0U)
-		return 0U;
 
 	if (m_sampleRate != MMDVM_SAMPLERATE) {
-#if defined(HAS_SRC)
-		unsigned int nIn = (nOut * m_sampleRate) / MMDVM_SAMPLERATE;
-
-		if (bytes < nIn) {
+		// Only take the input that is needed, the resampler keeps any remainder
+		unsigned int nIn = m_readResampler.getInputNeeded(nOut);
+		if (nIn > bytes)
 			nIn = bytes;
-			nOut = (nIn * MMDVM_SAMPLERATE) / m_sampleRate;
-		}
+		if (nIn > RESAMPLE_LENGTH)
+			nIn = RESAMPLE_LENGTH;
 
-		uint8_t buffer[2000U];
-		m_buffer.getData(buffer, nIn * sizeof(uint16_t));
+		int16_t in[RESAMPLE_LENGTH];
 
-		float in[1000U];
+		if (nIn > 0U) {
+			const uint8_t* data1 = nullptr;
+			const uint8_t* data2 = nullptr;
+			unsigned int length1 = 0U, length2 = 0U;
+			m_buffer.acquireRead(nIn * sizeof(uint16_t), data1, length1, data2, length2);
 
-		for (unsigned int i = 0U; i < nIn; i++) {
-			short val = ((buffer[i * 2U + 0U] & 0xFFU) << 0) + ((buffer[i * 2U + 1U] & 0xFFU) << 8);
-			in[i] = float(val) / 65536.0F;
-		}
+			CAudioConvert::s16LEToS16(data1, length1, data2, length2, in);
 
-		SRC_DATA data;
-		data.data_in       = in;
-		data.data_out      = out;
-		data.input_frames  = nIn;
-		data.output_frames = nOut;
-		data.end_of_input  = 0;
-		data.src_ratio     = float(MMDVM_SAMPLERATE) / float(m_sampleRate);
-
-		int ret = ::src_process(m_resampler, &data);
-		if (ret != 0) {
-			LogError("Error from the read resampler - %d - %s", ret, ::src_strerror(ret));
-			return false;
+			m_buffer.commitRead(nIn * sizeof(uint16_t));
 		}
-#else
-		assert(false);
-#endif
+
+		nOut = m_readResampler.process(in, nIn, out, nOut);
 	} else {
+		if (bytes == 0U)
+			return 0U;
+
 		if (bytes < nOut)
 			nOut = bytes;
 
-		uint8_t buffer[1500U];
-		m_buffer.getData(buffer, nOut * sizeof(uint16_t));
+		// Decode straight from the ring buffer storage
+		const uint8_t* data1 = nullptr;
+		const uint8_t* data2 = nullptr;
+		unsigned int length1 = 0U, length2 = 0U;
+		m_buffer.acquireRead(nOut * sizeof(uint16_t), data1, length1, data2, length2);
 
-		for (unsigned int i = 0U; i < nOut; i++) {
-			short val = ((buffer[i * 2U + 0U] & 0xFFU) << 0) + ((buffer[i * 2U + 1U] & 0xFFU) << 8);
-			out[i] = float(val) / 65536.0F;
-		}
+		CAudioConvert::s16LEToS16(data1, length1, data2, length2, out);
+
+		m_buffer.commitRead(nOut * sizeof(uint16_t));
 	}
 
 	return nOut;
 }
 
+AUDIO_FORMAT CRAWNetwork::getFormat() const
+{
+	return AUDIO_FORMAT { AUDIO_ENCODING::PCM_S16LE, m_sampleRate };
+}
+
 void CRAWNetwork::reset()
 {
 	m_buffer.clear();
+
+	m_readResampler.reset();
 }
 
 void CRAWNetwork::close()
@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2020,2021,2023,2024 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2020,2021,2023,2024,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -19,14 +19,11 @@
 #ifndef	RAWNetwork_H
 #define	RAWNetwork_H
 
-#include "RingBuffer.h"
+#include "SPSCRingBuffer.h"
 #include "UDPSocket.h"
+#include "Resampler.h"
 #include "Network.h"
 
-#if defined(HAS_SRC)
-#include <samplerate.h>
-#endif
-
 #include <cstdint>
 #include <string>
 
@@ -39,17 +36,24 @@ public:
 
 	virtual bool writeStart(const std::string& callsign);
 
-	virtual bool writeData(const float* in, unsigned int nIn);
+	virtual bool writeData(const int16_t* in, unsigned int nIn);
+	virtual bool writeData(const int16_t* data1, unsigned int length1, const int16_t* data2, unsigned int length2);
 
 	virtual bool writeEnd();
 
-	virtual unsigned int readData(float* out, unsigned int nOut);
+	virtual unsigned int readData(int16_t* out, unsigned int nOut);
 
 	virtual void reset();
 
 	virtual void close();
 
-	virtual void clock(unsigned int ms);
+	virtual void clock(unsigned int us);
+
+	virtual void registerSockets(CEventLoop& loop);
+
+	virtual unsigned int getNextTimeout() const;
+
+	virtual AUDIO_FORMAT getFormat() const;
 
 private:
 	CUDPSocket          m_socket;
@@ -58,12 +62,12 @@ private:
 	unsigned int        m_sampleRate;
 	std::string         m_squelchFile;
 	bool                m_debug;
-	CRingBuffer<uint8_t> m_buffer;
-#if defined(HAS_SRC)
-	SRC_STATE*          m_resampler;
-	int                 m_error;
-#endif
+	CSPSCRingBuffer<uint8_t> m_buffer;
+	CResampler          m_writeResampler;
+	CResampler          m_readResampler;
 	FILE*               m_fp;
+
+	void processPacket(const uint8_t* buffer, unsigned int length, const sockaddr_storage& addr);
 };
 
 #endif
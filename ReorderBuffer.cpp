@@ -0,0 +1,294 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "ReorderBuffer.h"
+#include "AudioConvert.h"
+#include "EventLoop.h"
+#include "Log.h"
+
+#include <cassert>
+#include <cstring>
+
+// The history of played frames, used to tell duplicates from late frames, is one bit per frame
+const unsigned int MAX_WINDOW = 64U;
+
+// A jump in the sequence numbers larger than this is the sender starting again
+const int32_t RESYNC_FRAMES = 50;
+
+// How many missing frames in a row are covered before falling back to silence
+const unsigned int MAX_CONCEAL = 3U;
+
+const unsigned int FRAME_MS = 20U;
+
+// With nothing received for this long the stream has ended, even without a PTT off
+const unsigned int IDLE_TIMEOUT_MS = 500U;
+
+CReorderBuffer::CReorderBuffer(const char* name, unsigned int window, unsigned int maxLength, CSPSCRingBuffer<uint8_t>& output) :
+m_name(name),
+m_window(window),
+m_mask(0U),
+m_maxLength(maxLength),
+m_output(output),
+m_data(nullptr),
+m_slots(nullptr),
+m_count(0U),
+m_last(nullptr),
+m_lastLength(0U),
+m_conceal(nullptr),
+m_concealed(0U),
+m_gapTimer(1000000U, 0U, window * FRAME_MS),
+m_idleTimer(1000000U, 0U, IDLE_TIMEOUT_MS),
+m_running(false),
+m_started(false),
+m_next(0U),
+m_highest(0U),
+m_history(0U),
+m_received(0U),
+m_lost(0U),
+m_reordered(0U),
+m_duplicates(0U),
+m_late(0U)
+{
+	assert(name != nullptr);
+	assert(window > 0U && window <= MAX_WINDOW);
+	assert(maxLength > 0U);
+
+	// A power of two number of slots keeps the slot of each frame the same across the wrap of the sequence numbers
+	unsigned int slots = 1U;
+	while (slots < window)
+		slots <<= 1;
+
+	m_mask = slots - 1U;
+
+	m_data    = new uint8_t[slots * maxLength];
+	m_slots   = new RB_SLOT[slots];
+	m_last    = new int16_t[maxLength / sizeof(int16_t)];
+	m_conceal = new uint8_t[maxLength];
+
+	for (unsigned int i = 0U; i < slots; i++) {
+		m_slots[i].m_used   = false;
+		m_slots[i].m_seqNo  = 0U;
+		m_slots[i].m_length = 0U;
+		m_slots[i].m_data   = m_data + i * maxLength;
+	}
+}
+
+CReorderBuffer::~CReorderBuffer()
+{
+	delete[] m_conceal;
+	delete[] m_last;
+	delete[] m_slots;
+	delete[] m_data;
+}
+
+bool CReorderBuffer::addFrame(uint32_t seqNo, const uint8_t* data, unsigned int length)
+{
+	assert(data != nullptr);
+
+	if ((length == 0U) || (length > m_maxLength)) {
+		LogWarning("%s: invalid frame length of %u bytes", m_name, length);
+		return false;
+	}
+
+	if (!m_running)
+		start(seqNo);
+
+	m_idleTimer.start();
+
+	int32_t diff = int32_t(seqNo - m_next);
+
+	if ((diff <= -RESYNC_FRAMES) || (diff >= RESYNC_FRAMES)) {
+		end();
+		start(seqNo);
+		diff = 0;
+	}
+
+	m_received++;
+
+	if (diff < 0) {
+		if (!m_started && (int32_t(m_highest - seqNo) < int32_t(m_window))) {
+			// A reordered first frame can still be played
+			m_next = seqNo;
+		} else {
+			if ((-diff <= int32_t(MAX_WINDOW)) && ((m_history >> (-diff - 1)) & 1U) == 1U)
+				m_duplicates++;
+			else
+				m_late++;
+
+			return false;
+		}
+	}
+
+	RB_SLOT& slot = m_slots[seqNo & m_mask];
+	if (slot.m_used && (slot.m_seqNo == seqNo)) {
+		m_duplicates++;
+		return false;
+	}
+
+	if (int32_t(seqNo - m_highest) < 0)
+		m_reordered++;
+	else
+		m_highest = seqNo;
+
+	// Give up on the oldest missing frames until the new one fits in the window
+	while (int32_t(seqNo - m_next) >= int32_t(m_window))
+		releaseNext();
+
+	slot.m_used   = true;
+	slot.m_seqNo  = seqNo;
+	slot.m_length = length;
+	::memcpy(slot.m_data, data, length);
+	m_count++;
+
+	releaseReady();
+
+	return true;
+}
+
+void CReorderBuffer::end()
+{
+	if (!m_running)
+		return;
+
+	while (m_count > 0U)
+		releaseNext();
+
+	LogDebug("%s: %u frames received, %u lost, %u reordered, %u duplicates, %u late", m_name, m_received, m_lost, m_reordered, m_duplicates, m_late);
+
+	stop();
+}
+
+void CReorderBuffer::clock(unsigned int us)
+{
+	m_gapTimer.clock(us);
+	if (m_gapTimer.isRunning() && m_gapTimer.hasExpired()) {
+		// Waited long enough for the missing frames, play what comes after them
+		while ((m_count > 0U) && !m_slots[m_next & m_mask].m_used)
+			releaseNext();
+
+		m_gapTimer.stop();
+		releaseReady();
+	}
+
+	m_idleTimer.clock(us);
+	if (m_idleTimer.isRunning() && m_idleTimer.hasExpired())
+		end();
+}
+
+unsigned int CReorderBuffer::getNextTimeout() const
+{
+	unsigned int timeout = NO_TIMEOUT;
+
+	if (m_gapTimer.isRunning())
+		timeout = m_gapTimer.getRemainingMS();
+
+	if (m_idleTimer.isRunning()) {
+		unsigned int remaining = m_idleTimer.getRemainingMS();
+		if (remaining < timeout)
+			timeout = remaining;
+	}
+
+	return timeout;
+}
+
+void CReorderBuffer::reset()
+{
+	stop();
+}
+
+void CReorderBuffer::start(uint32_t seqNo)
+{
+	m_running    = true;
+	m_started    = false;
+	m_next       = seqNo;
+	m_highest    = seqNo;
+	m_history    = 0U;
+	m_lastLength = 0U;
+	m_concealed  = 0U;
+	m_received   = 0U;
+	m_lost       = 0U;
+	m_reordered  = 0U;
+	m_duplicates = 0U;
+	m_late       = 0U;
+}
+
+void CReorderBuffer::releaseNext()
+{
+	RB_SLOT& slot = m_slots[m_next & m_mask];
+
+	if (slot.m_used && (slot.m_seqNo == m_next)) {
+		m_output.addData(slot.m_data, slot.m_length);
+
+		CAudioConvert::s16LEToS16(slot.m_data, m_last, slot.m_length / sizeof(int16_t));
+		m_lastLength = slot.m_length / sizeof(int16_t);
+
+		slot.m_used = false;
+		m_count--;
+
+		m_history   = (m_history << 1) | 1U;
+		m_concealed = 0U;
+	} else {
+		if (m_lastLength > 0U) {
+			if (m_concealed < MAX_CONCEAL) {
+				// Repeat the last frame, halving its level each time
+				for (unsigned int i = 0U; i < m_lastLength; i++)
+					m_last[i] >>= 1;
+
+				CAudioConvert::s16ToS16LE(m_last, m_conceal, m_lastLength);
+			} else {
+				::memset(m_conceal, 0x00U, m_lastLength * sizeof(int16_t));
+			}
+
+			m_output.addData(m_conceal, m_lastLength * sizeof(int16_t));
+		}
+
+		m_history <<= 1;
+		m_concealed++;
+		m_lost++;
+	}
+
+	m_started = true;
+	m_next++;
+}
+
+void CReorderBuffer::releaseReady()
+{
+	while (m_slots[m_next & m_mask].m_used && (m_slots[m_next & m_mask].m_seqNo == m_next))
+		releaseNext();
+
+	// Frames are held behind a gap
+	if (m_count > 0U) {
+		if (!m_gapTimer.isRunning())
+			m_gapTimer.start();
+	} else {
+		m_gapTimer.stop();
+	}
+}
+
+void CReorderBuffer::stop()
+{
+	for (unsigned int i = 0U; i <= m_mask; i++)
+		m_slots[i].m_used = false;
+
+	m_count   = 0U;
+	m_running = false;
+	m_started = false;
+
+	m_gapTimer.stop();
+	m_idleTimer.stop();
+}
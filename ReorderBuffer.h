@@ -0,0 +1,89 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(ReorderBuffer_H)
+#define	ReorderBuffer_H
+
+#include "SPSCRingBuffer.h"
+#include "Timer.h"
+
+#include <cstdint>
+
+// Puts received S16LE audio frames back into sequence number order before they are added to
+// the output. A small window of frames is held behind a gap so that reordered frames can be
+// slotted in and duplicates dropped. A missing frame is given up on when the window moves past
+// it or it has been waited for too long, and a quieter copy of the frame before it, or silence,
+// takes its place.
+class CReorderBuffer {
+public:
+	CReorderBuffer(const char* name, unsigned int window, unsigned int maxLength, CSPSCRingBuffer<uint8_t>& output);
+	~CReorderBuffer();
+
+	// Returns false if the frame is a duplicate or too late to be used
+	bool addFrame(uint32_t seqNo, const uint8_t* data, unsigned int length);
+
+	// The sender has stopped, so the held frames are added to the output and the next frame starts a new stream
+	void end();
+
+	void clock(unsigned int us);
+
+	// The time in milliseconds until a missing frame is given up on
+	unsigned int getNextTimeout() const;
+
+	void reset();
+
+private:
+	struct RB_SLOT {
+		bool         m_used;
+		uint32_t     m_seqNo;
+		unsigned int m_length;
+		uint8_t*     m_data;
+	};
+
+	const char*        m_name;
+	unsigned int       m_window;
+	unsigned int       m_mask;
+	unsigned int       m_maxLength;
+	CSPSCRingBuffer<uint8_t>& m_output;
+	uint8_t*           m_data;
+	RB_SLOT*           m_slots;
+	unsigned int       m_count;
+	int16_t*           m_last;
+	unsigned int       m_lastLength;
+	uint8_t*           m_conceal;
+	unsigned int       m_concealed;
+	CTimer             m_gapTimer;
+	CTimer             m_idleTimer;
+	bool               m_running;
+	bool               m_started;
+	uint32_t           m_next;
+	uint32_t           m_highest;
+	uint64_t           m_history;
+	uint32_t           m_received;
+	uint32_t           m_lost;
+	uint32_t           m_reordered;
+	uint32_t           m_duplicates;
+	uint32_t           m_late;
+
+	void start(uint32_t seqNo);
+	void releaseNext();
+	void releaseReady();
+	void stop();
+};
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Resampler.h"
+#include "AudioConvert.h"
+
+#include <cassert>
+#include <cstring>
+#include <cmath>
+
+// Per phase when interpolating, scaled up by the ratio when decimating, and rounded up to
+// a multiple of eight to suit the vector kernels
+const unsigned int BASE_TAPS = 32U;
+
+// About 80 dB of stop band rejection
+const double KAISER_BETA = 8.0;
+
+// The pass band as a fraction of the lower of the two Nyquist frequencies
+const double CUTOFF = 0.875;
+
+const double PI = 3.14159265358979323846;
+
+static unsigned int gcd(unsigned int a, unsigned int b)
+{
+	while (b != 0U) {
+		unsigned int t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+// The zeroth order modified Bessel function, for the Kaiser window
+static double bessel0(double x)
+{
+	double sum  = 1.0;
+	double term = 1.0;
+
+	for (unsigned int k = 1U; k < 50U; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum  += term;
+
+		if (term < (sum * 1E-12))
+			break;
+	}
+
+	return sum;
+}
+
+CResampler::CResampler(unsigned int inRate, unsigned int outRate) :
+m_interpolate(1U),
+m_decimate(1U),
+m_taps(0U),
+m_coeffs(),
+m_history(),
+m_output(),
+m_count(0U),
+m_position(0U)
+{
+	assert(inRate > 0U);
+	assert(outRate > 0U);
+
+	unsigned int div = gcd(inRate, outRate);
+	m_interpolate = outRate / div;
+	m_decimate    = inRate / div;
+
+	m_taps = BASE_TAPS;
+	if (inRate > outRate)
+		m_taps = (BASE_TAPS * inRate + outRate - 1U) / outRate;
+	m_taps = (m_taps + 7U) & ~7U;
+
+	// The prototype low pass runs at the interpolated rate, the gain makes up for the zeros
+	// that interpolation inserts
+	unsigned int length = m_interpolate * m_taps;
+
+	double nyquist = double(inRate < outRate ? inRate : outRate) / 2.0;
+	double fc      = (CUTOFF * nyquist) / double(inRate * m_interpolate);
+	double centre  = double(length - 1U) / 2.0;
+	double norm    = bessel0(KAISER_BETA);
+
+	std::vector<double> prototype(length);
+	for (unsigned int n = 0U; n < length; n++) {
+		double t    = double(n) - centre;
+		double sinc = (t == 0.0) ? 2.0 * fc : std::sin(2.0 * PI * fc * t) / (PI * t);
+
+		double r      = t / centre;
+		double window = bessel0(KAISER_BETA * std::sqrt(1.0 - r * r)) / norm;
+
+		prototype[n] = double(m_interpolate) * sinc * window;
+	}
+
+	// Each phase is stored oldest tap first, so that it lines up with the history
+	m_coeffs.resize(length);
+	for (unsigned int p = 0U; p < m_interpolate; p++) {
+		for (unsigned int k = 0U; k < m_taps; k++)
+			m_coeffs[p * m_taps + (m_taps - 1U - k)] = float(prototype[p + k * m_interpolate]);
+	}
+
+	reset();
+}
+
+CResampler::~CResampler()
+{
+}
+
+unsigned int CResampler::process(const float* in, unsigned int nIn, float* out, unsigned int nOut)
+{
+	assert(in != nullptr || nIn == 0U);
+	assert(out != nullptr);
+
+	if ((m_count + nIn) > m_history.size())
+		m_history.resize(m_count + nIn);
+
+	if (nIn > 0U) {
+		::memcpy(m_history.data() + m_count, in, nIn * sizeof(float));
+		m_count += nIn;
+	}
+
+	unsigned int n = 0U;
+
+	while (n < nOut) {
+		unsigned int index = m_position / m_interpolate;
+		unsigned int phase = m_position % m_interpolate;
+
+		if ((index + m_taps) > m_count)
+			break;
+
+		out[n++] = CAudioConvert::dotProduct(m_history.data() + index, m_coeffs.data() + phase * m_taps, m_taps);
+
+		m_position += m_decimate;
+	}
+
+	// Drop the input that no later output needs. When decimating the position may be beyond
+	// the input received so far, and the remainder is carried over.
+	unsigned int drop = m_position / m_interpolate;
+	if (drop > m_count)
+		drop = m_count;
+
+	m_count    -= drop;
+	m_position -= drop * m_interpolate;
+
+	::memmove(m_history.data(), m_history.data() + drop, m_count * sizeof(float));
+
+	return n;
+}
+
+unsigned int CResampler::process(const int16_t* in, unsigned int nIn, int16_t* out, unsigned int nOut)
+{
+	assert(in != nullptr || nIn == 0U);
+	assert(out != nullptr);
+
+	if ((m_count + nIn) > m_history.size())
+		m_history.resize(m_count + nIn);
+
+	// The input is appended to the history directly, so none is passed on
+	for (unsigned int i = 0U; i < nIn; i++)
+		m_history[m_count + i] = float(in[i]);
+	m_count += nIn;
+
+	if (nOut > m_output.size())
+		m_output.resize(nOut);
+
+	unsigned int n = process(nullptr, 0U, m_output.data(), nOut);
+
+	for (unsigned int i = 0U; i < n; i++) {
+		float val = m_output[i];
+		val += (val < 0.0F) ? -0.5F : 0.5F;
+
+		if (val > 32767.0F)
+			val = 32767.0F;
+		else if (val < -32768.0F)
+			val = -32768.0F;
+
+		out[i] = int16_t(val);
+	}
+
+	return n;
+}
+
+unsigned int CResampler::getInputNeeded(unsigned int nOut) const
+{
+	if (nOut == 0U)
+		return 0U;
+
+	unsigned int last   = (m_position + (nOut - 1U) * m_decimate) / m_interpolate;
+	unsigned int needed = last + m_taps;
+
+	return (needed > m_count) ? needed - m_count : 0U;
+}
+
+void CResampler::reset()
+{
+	// Start with a history of silence so that the first input is used straight away
+	m_history.assign(m_taps + 4096U, 0.0F);
+	m_count    = m_taps - 1U;
+	m_position = 0U;
+}
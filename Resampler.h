@@ -0,0 +1,56 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef	Resampler_H
+#define	Resampler_H
+
+#include <cstdint>
+#include <vector>
+
+// A streaming polyphase FIR resampler for a fixed rational ratio. The filter position, in steps
+// of the interpolated rate, and the unused input are carried between calls, so no fractional
+// samples are lost.
+class CResampler {
+public:
+	CResampler(unsigned int inRate, unsigned int outRate);
+	~CResampler();
+
+	// Returns the number of samples written to out, no more than nOut. Input that cannot yet be
+	// used is held for the next call.
+	unsigned int process(const float* in, unsigned int nIn, float* out, unsigned int nOut);
+
+	// The same for 16-bit audio, at unity gain with the output rounded and saturated
+	unsigned int process(const int16_t* in, unsigned int nIn, int16_t* out, unsigned int nOut);
+
+	// The input still needed before nOut more samples can be produced
+	unsigned int getInputNeeded(unsigned int nOut) const;
+
+	void reset();
+
+private:
+	unsigned int       m_interpolate;
+	unsigned int       m_decimate;
+	unsigned int       m_taps;
+	std::vector<float> m_coeffs;
+	std::vector<float> m_history;
+	std::vector<float> m_output;
+	unsigned int       m_count;
+	unsigned int       m_position;
+};
+
+#endif
@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2006-2009,2012,2013,2015,2016,2025 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2006-2009,2012,2013,2015,2016,2025,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -100,6 +100,57 @@ public:
 		return true;
 	}
 
+	// Return up to nSamples of the stored data in place, in two parts if it wraps
+	unsigned int acquireRead(unsigned int nSamples, const T*& data1, unsigned int& length1, const T*& data2, unsigned int& length2) const
+	{
+		unsigned int size = dataSize();
+		if (nSamples > size)
+			nSamples = size;
+
+		length1 = m_length - m_oPtr;
+		if (length1 > nSamples)
+			length1 = nSamples;
+
+		data1   = m_buffer + m_oPtr;
+		data2   = m_buffer;
+		length2 = nSamples - length1;
+
+		return nSamples;
+	}
+
+	void commitRead(unsigned int nSamples)
+	{
+		assert(nSamples <= dataSize());
+
+		m_oPtr = (m_oPtr + nSamples) % m_length;
+	}
+
+	// Return up to nSamples of the free space in place, in two parts if it wraps
+	unsigned int acquireWrite(unsigned int nSamples, T*& data1, unsigned int& length1, T*& data2, unsigned int& length2)
+	{
+		// One element is always left unused so that a full buffer doesn't look empty
+		unsigned int space = freeSpace() - 1U;
+		if (nSamples > space)
+			nSamples = space;
+
+		length1 = m_length - m_iPtr;
+		if (length1 > nSamples)
+			length1 = nSamples;
+
+		data1   = m_buffer + m_iPtr;
+		data2   = m_buffer;
+		length2 = nSamples - length1;
+
+		return nSamples;
+	}
+
+	void commitWrite(unsigned int nSamples)
+	{
+		assert(nSamples < freeSpace());
+
+		m_iPtr = (m_iPtr + nSamples) % m_length;
+	}
+
 	void clear()
 	{
 		m_iPtr = 0U;
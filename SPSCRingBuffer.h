@@ -0,0 +1,225 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef SPSCRingBuffer_H
+#define SPSCRingBuffer_H
+
+#include "Log.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+
+// A ring buffer that one thread may write to while another reads from it without locking.
+// Only addData(), acquireWrite() and commitWrite() may be called by the writer, everything else
+// belongs to the reader.
+// The indices run freely and are masked on use, so the length is rounded up to a power of two.
+template<class T> class CSPSCRingBuffer {
+public:
+	CSPSCRingBuffer(unsigned int length, const char* name) :
+	m_length(1U),
+	m_mask(0U),
+	m_name(name),
+	m_buffer(nullptr),
+	m_pad1(),
+	m_iPtr(0U),
+	m_pad2(),
+	m_oPtr(0U),
+	m_pad3()
+	{
+		assert(length > 0U);
+		assert(name != nullptr);
+
+		while (m_length < length)
+			m_length <<= 1;
+
+		m_mask = m_length - 1U;
+
+		m_buffer = new T[m_length];
+
+		::memset(m_buffer, 0x00, m_length * sizeof(T));
+	}
+
+	~CSPSCRingBuffer()
+	{
+		delete[] m_buffer;
+	}
+
+	bool addData(const T* buffer, unsigned int nSamples)
+	{
+		unsigned int iPtr = m_iPtr.load(std::memory_order_relaxed);
+		unsigned int oPtr = m_oPtr.load(std::memory_order_acquire);
+
+		unsigned int space = m_length - (iPtr - oPtr);
+		if (nSamples > space) {
+			LogError("%s buffer overflow, dropping the data. (%u > %u)", m_name, nSamples, space);
+			return false;
+		}
+
+		unsigned int pos   = iPtr & m_mask;
+		unsigned int first = m_length - pos;
+		if (first > nSamples)
+			first = nSamples;
+
+		::memcpy(m_buffer + pos, buffer, first * sizeof(T));
+		::memcpy(m_buffer, buffer + first, (nSamples - first) * sizeof(T));
+
+		m_iPtr.store(iPtr + nSamples, std::memory_order_release);
+
+		return true;
+	}
+
+	bool getData(T* buffer, unsigned int nSamples)
+	{
+		if (!peek(buffer, nSamples))
+			return false;
+
+		m_oPtr.store(m_oPtr.load(std::memory_order_relaxed) + nSamples, std::memory_order_release);
+
+		return true;
+	}
+
+	bool peek(T* buffer, unsigned int nSamples) const
+	{
+		unsigned int oPtr = m_oPtr.load(std::memory_order_relaxed);
+		unsigned int iPtr = m_iPtr.load(std::memory_order_acquire);
+
+		unsigned int data = iPtr - oPtr;
+		if (data < nSamples) {
+			LogError("**** Underflow in %s ring buffer, %u < %u", m_name, data, nSamples);
+			return false;
+		}
+
+		unsigned int pos   = oPtr & m_mask;
+		unsigned int first = m_length - pos;
+		if (first > nSamples)
+			first = nSamples;
+
+		::memcpy(buffer, m_buffer + pos, first * sizeof(T));
+		::memcpy(buffer + first, m_buffer, (nSamples - first) * sizeof(T));
+
+		return true;
+	}
+
+	// Return up to nSamples of the stored data in place, in two parts if it wraps
+	unsigned int acquireRead(unsigned int nSamples, const T*& data1, unsigned int& length1, const T*& data2, unsigned int& length2) const
+	{
+		unsigned int oPtr = m_oPtr.load(std::memory_order_relaxed);
+		unsigned int iPtr = m_iPtr.load(std::memory_order_acquire);
+
+		if (nSamples > (iPtr - oPtr))
+			nSamples = iPtr - oPtr;
+
+		unsigned int pos = oPtr & m_mask;
+
+		length1 = m_length - pos;
+		if (length1 > nSamples)
+			length1 = nSamples;
+
+		data1   = m_buffer + pos;
+		data2   = m_buffer;
+		length2 = nSamples - length1;
+
+		return nSamples;
+	}
+
+	void commitRead(unsigned int nSamples)
+	{
+		assert(nSamples <= dataSize());
+
+		m_oPtr.store(m_oPtr.load(std::memory_order_relaxed) + nSamples, std::memory_order_release);
+	}
+
+	// Return up to nSamples of the free space in place, in two parts if it wraps, for the writer only
+	unsigned int acquireWrite(unsigned int nSamples, T*& data1, unsigned int& length1, T*& data2, unsigned int& length2)
+	{
+		unsigned int iPtr = m_iPtr.load(std::memory_order_relaxed);
+		unsigned int oPtr = m_oPtr.load(std::memory_order_acquire);
+
+		unsigned int space = m_length - (iPtr - oPtr);
+		if (nSamples > space)
+			nSamples = space;
+
+		unsigned int pos = iPtr & m_mask;
+
+		length1 = m_length - pos;
+		if (length1 > nSamples)
+			length1 = nSamples;
+
+		data1   = m_buffer + pos;
+		data2   = m_buffer;
+		length2 = nSamples - length1;
+
+		return nSamples;
+	}
+
+	void commitWrite(unsigned int nSamples)
+	{
+		assert(nSamples <= freeSpace());
+
+		m_iPtr.store(m_iPtr.load(std::memory_order_relaxed) + nSamples, std::memory_order_release);
+	}
+
+	void clear()
+	{
+		m_oPtr.store(m_iPtr.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+	unsigned int freeSpace() const
+	{
+		return m_length - dataSize();
+	}
+
+	unsigned int dataSize() const
+	{
+		unsigned int oPtr = m_oPtr.load(std::memory_order_acquire);
+		unsigned int iPtr = m_iPtr.load(std::memory_order_acquire);
+
+		return iPtr - oPtr;
+	}
+
+	bool hasSpace(unsigned int length) const
+	{
+		return freeSpace() >= length;
+	}
+
+	bool hasData() const
+	{
+		return dataSize() > 0U;
+	}
+
+	bool isEmpty() const
+	{
+		return dataSize() == 0U;
+	}
+
+private:
+	unsigned int              m_length;
+	unsigned int              m_mask;
+	const char*               m_name;
+	T*                        m_buffer;
+	// Keep the two indices on separate cache lines so that the threads don't contend
+	char                      m_pad1[64U];
+	std::atomic<unsigned int> m_iPtr;
+	char                      m_pad2[64U - sizeof(std::atomic<unsigned int>)];
+	std::atomic<unsigned int> m_oPtr;
+	char                      m_pad3[64U - sizeof(std::atomic<unsigned int>)];
+};
+
+#endif
@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2015,2016,2018 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2015,2016,2018,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -60,13 +60,31 @@ unsigned int CStopWatch::elapsed()
 	return (unsigned int)(temp.QuadPart / m_frequencyS.QuadPart);
 }
 
+unsigned long long CStopWatch::elapsedUS() const
+{
+	return elapsedNS() / 1000ULL;
+}
+
+unsigned long long CStopWatch::elapsedNS() const
+{
+	LARGE_INTEGER now;
+	::QueryPerformanceCounter(&now);
+
+	// Split into whole seconds and the remainder so that the multiply can't overflow
+	unsigned long long ticks = now.QuadPart - m_start.QuadPart;
+	unsigned long long secs  = ticks / m_frequencyS.QuadPart;
+	unsigned long long rem   = ticks % m_frequencyS.QuadPart;
+
+	return secs * 1000000000ULL + (rem * 1000000000ULL) / m_frequencyS.QuadPart;
+}
+
 #else
 
 #include <cstdio>
 #include <ctime>
 
 CStopWatch::CStopWatch() :
-m_startMS(0ULL)
+m_startNS(0ULL)
 {
 }
 
@@ -87,19 +105,29 @@ unsigned long long CStopWatch::start()
 	struct timespec now;
 	::clock_gettime(CLOCK_MONOTONIC, &now);
 
-	m_startMS = now.tv_sec * 1000ULL + now.tv_nsec / 1000000ULL;
+	m_startNS = now.tv_sec * 1000000000ULL + now.tv_nsec;
 
-	return m_startMS;
+	return m_startNS / 1000000ULL;
 }
 
 unsigned int CStopWatch::elapsed()
+{
+	return (unsigned int)(elapsedNS() / 1000000ULL);
+}
+
+unsigned long long CStopWatch::elapsedUS() const
+{
+	return elapsedNS() / 1000ULL;
+}
+
+unsigned long long CStopWatch::elapsedNS() const
 {
 	struct timespec now;
 	::clock_gettime(CLOCK_MONOTONIC, &now);
 
-	unsigned long long nowMS = now.tv_sec * 1000ULL + now.tv_nsec / 1000000ULL;
+	unsigned long long nowNS = now.tv_sec * 1000000000ULL + now.tv_nsec;
 
-	return nowMS - m_startMS;
+	return nowNS - m_startNS;
 }
 
 #endif
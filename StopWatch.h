@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2015,2016,2018 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2015,2016,2018,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -36,13 +36,17 @@ public:
 	unsigned long long start();
 	unsigned int       elapsed();
 
+	// The time since start() at full resolution
+	unsigned long long elapsedUS() const;
+	unsigned long long elapsedNS() const;
+
 private:
 #if defined(_WIN32) || defined(_WIN64)
 	LARGE_INTEGER  m_frequencyS;
 	LARGE_INTEGER  m_frequencyMS;
 	LARGE_INTEGER  m_start;
 #else
-	unsigned long long m_startMS;
+	unsigned long long m_startNS;
 #endif
 };
 
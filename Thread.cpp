@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2015,2016,2020 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2015,2016,2020,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -59,9 +59,18 @@ void CThread::sleep(unsigned int ms)
 	::Sleep(ms);
 }
 
+bool CThread::setAffinity(unsigned int cpu)
+{
+	if (cpu >= (sizeof(DWORD_PTR) * 8U))
+		return false;
+
+	return ::SetThreadAffinityMask(::GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+}
+
 #else
 
 #include <unistd.h>
+#include <sched.h>
 
 CThread::CThread() :
 m_thread()
@@ -103,5 +112,21 @@ void CThread::sleep(unsigned int ms)
 	::nanosleep(&ts, nullptr);
 }
 
+bool CThread::setAffinity(unsigned int cpu)
+{
+#if defined(__linux__)
+	if (cpu >= CPU_SETSIZE)
+		return false;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+
+	return ::pthread_setaffinity_np(::pthread_self(), sizeof(cpu_set_t), &set) == 0;
+#else
+	return false;
+#endif
+}
+
 #endif
 
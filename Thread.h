@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2015,2016 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2015,2016,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -39,6 +39,9 @@ public:
 
   static void sleep(unsigned int ms);
 
+  // Keeps the calling thread on one CPU, which isn't possible on every platform
+  static bool setAffinity(unsigned int cpu);
+
 private:
 #if defined(_WIN32) || defined(_WIN64)
   HANDLE    m_handle;
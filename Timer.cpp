@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2009,2010,2015 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2009,2010,2015,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -23,15 +23,15 @@
 
 CTimer::CTimer(unsigned int ticksPerSec, unsigned int secs, unsigned int msecs) :
 m_ticksPerSec(ticksPerSec),
-m_timeout(0U),
-m_timer(0U)
+m_timeout(0ULL),
+m_timer(0ULL)
 {
 	assert(ticksPerSec > 0U);
 
 	if (secs > 0U || msecs > 0U) {
 		// m_timeout = ((secs * 1000U + msecs) * m_ticksPerSec) / 1000U + 1U;
 		unsigned long long temp = (secs * 1000ULL + msecs) * m_ticksPerSec;
-		m_timeout = (unsigned int)(temp / 1000ULL + 1ULL);
+		m_timeout = temp / 1000ULL + 1ULL;
 	}
 }
 
@@ -44,25 +44,25 @@ void CTimer::setTimeout(unsigned int secs, unsigned int msecs)
 	if (secs > 0U || msecs > 0U) {
 		// m_timeout = ((secs * 1000U + msecs) * m_ticksPerSec) / 1000U + 1U;
 		unsigned long long temp = (secs * 1000ULL + msecs) * m_ticksPerSec;
-		m_timeout = (unsigned int)(temp / 1000ULL + 1ULL);
+		m_timeout = temp / 1000ULL + 1ULL;
 	} else {
-		m_timeout = 0U;
-		m_timer = 0U;
+		m_timeout = 0ULL;
+		m_timer = 0ULL;
 	}
 }
 
 unsigned int CTimer::getTimeout() const
 {
-	if (m_timeout == 0U)
+	if (m_timeout == 0ULL)
 		return 0U;
 
-	return (m_timeout - 1U) / m_ticksPerSec;
+	return (unsigned int)((m_timeout - 1ULL) / m_ticksPerSec);
 }
 
 unsigned int CTimer::getTimer() const
 {
-	if (m_timer == 0U)
+	if (m_timer == 0ULL)
 		return 0U;
 
-	return (m_timer - 1U) / m_ticksPerSec;
+	return (unsigned int)((m_timer - 1ULL) / m_ticksPerSec);
 }
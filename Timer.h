@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2009,2010,2011,2014 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2009,2010,2011,2014,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -31,18 +31,35 @@ public:
 
 	unsigned int getRemaining()
 	{
-		if (m_timeout == 0U || m_timer == 0U)
+		if (m_timeout == 0ULL || m_timer == 0ULL)
 			return 0U;
 
 		if (m_timer >= m_timeout)
 			return 0U;
 
-		return (m_timeout - m_timer) / m_ticksPerSec;
+		return (unsigned int)((m_timeout - m_timer) / m_ticksPerSec);
 	}
 
-	bool isRunning()
+	unsigned long long getRemainingTicks() const
 	{
-		return m_timer > 0U;
+		if (m_timeout == 0ULL || m_timer == 0ULL)
+			return 0ULL;
+
+		if (m_timer >= m_timeout)
+			return 0ULL;
+
+		return m_timeout - m_timer;
+	}
+
+	// Rounded up so that waiting this long always reaches the expiry
+	unsigned int getRemainingMS() const
+	{
+		return (unsigned int)((getRemainingTicks() * 1000ULL + m_ticksPerSec - 1U) / m_ticksPerSec);
+	}
+
+	bool isRunning() const
+	{
+		return m_timer > 0ULL;
 	}
 
 	void start(unsigned int secs, unsigned int msecs = 0U)
@@ -54,18 +71,18 @@ public:
 
 	void start()
 	{
-		if (m_timeout > 0U)
-			m_timer = 1U;
+		if (m_timeout > 0ULL)
+			m_timer = 1ULL;
 	}
 
 	void stop()
 	{
-		m_timer = 0U;
+		m_timer = 0ULL;
 	}
 
 	bool hasExpired()
 	{
-		if (m_timeout == 0U || m_timer == 0U)
+		if (m_timeout == 0ULL || m_timer == 0ULL)
 			return false;
 
 		if (m_timer >= m_timeout)
@@ -76,14 +93,14 @@ public:
 
 	void clock(unsigned int ticks = 1U)
 	{
-		if (m_timer > 0U && m_timeout > 0U)
+		if (m_timer > 0ULL && m_timeout > 0ULL)
 			m_timer += ticks;
 	}
 
 private:
-	unsigned int m_ticksPerSec;
-	unsigned int m_timeout;
-	unsigned int m_timer;
+	unsigned int       m_ticksPerSec;
+	unsigned long long m_timeout;
+	unsigned long long m_timer;
 };
 
 #endif
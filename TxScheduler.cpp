@@ -0,0 +1,184 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "TxScheduler.h"
+#include "Log.h"
+
+#include <cassert>
+
+// Enough for a second of audio at 8 kHz
+const unsigned int BUFFER_LENGTH = 8000U;
+
+// The number of empty frames that the grid is kept for before the audio is taken to have ended
+const unsigned int MAX_GAP = 5U;
+
+CTxScheduler::CTxScheduler(unsigned int frameSamples, unsigned int frameMS, unsigned int delayMS, const char* name) :
+m_frameSamples(frameSamples),
+m_frameNS(frameMS * 1000000ULL),
+m_delayNS(delayMS * 1000000ULL),
+m_name(name),
+m_buffer(BUFFER_LENGTH, name),
+m_running(false),
+m_deadline(0ULL),
+m_frames(0U),
+m_misses(0U),
+m_short(0U),
+m_gap(0U),
+m_underruns(0U),
+m_maxLate(0ULL)
+{
+	assert(frameSamples > 0U);
+	assert(frameMS > 0U);
+	assert(name != nullptr);
+}
+
+CTxScheduler::~CTxScheduler()
+{
+}
+
+bool CTxScheduler::addData(const int16_t* data, unsigned int nSamples)
+{
+	assert(data != nullptr);
+
+	if (nSamples == 0U)
+		return true;
+
+	return m_buffer.addData(data, nSamples);
+}
+
+bool CTxScheduler::hasSpace(unsigned int nSamples) const
+{
+	return m_buffer.hasSpace(nSamples);
+}
+
+bool CTxScheduler::isEmpty() const
+{
+	return m_buffer.isEmpty();
+}
+
+unsigned int CTxScheduler::dataSize() const
+{
+	return m_buffer.dataSize();
+}
+
+unsigned int CTxScheduler::getFrame(unsigned long long now, int16_t* data)
+{
+	assert(data != nullptr);
+
+	unsigned int n = nextFrame(now);
+	if (n > 0U)
+		m_buffer.getData(data, n);
+
+	return n;
+}
+
+unsigned int CTxScheduler::acquireFrame(unsigned long long now, const int16_t*& data1, unsigned int& length1, const int16_t*& data2, unsigned int& length2)
+{
+	unsigned int n = nextFrame(now);
+	if (n > 0U)
+		m_buffer.acquireRead(n, data1, length1, data2, length2);
+
+	return n;
+}
+
+void CTxScheduler::releaseFrame(unsigned int nSamples)
+{
+	m_buffer.commitRead(nSamples);
+}
+
+unsigned int CTxScheduler::nextFrame(unsigned long long now)
+{
+	unsigned int size = m_buffer.dataSize();
+
+	if (!m_running) {
+		if (size == 0U)
+			return 0U;
+
+		// The first audio waits for the playout delay, which then absorbs any lateness of what follows
+		m_running  = true;
+		m_deadline = now + m_delayNS;
+	}
+
+	if (now < m_deadline)
+		return 0U;
+
+	unsigned long long late = now - m_deadline;
+	if (late > m_maxLate)
+		m_maxLate = late;
+
+	// Too late to keep to the grid, so start a new one from now
+	if (late >= m_frameNS) {
+		m_misses++;
+		m_deadline = now;
+	}
+
+	m_deadline += m_frameNS;
+
+	// An empty frame keeps its place on the grid, audio that is late goes in the next one
+	if (size == 0U) {
+		m_underruns++;
+
+		if (++m_gap >= MAX_GAP)
+			stop();
+
+		return 0U;
+	}
+
+	m_gap = 0U;
+
+	unsigned int n = m_frameSamples;
+	if (size < n) {
+		n = size;
+		m_short++;
+	}
+
+	m_frames++;
+
+	return n;
+}
+
+unsigned long long CTxScheduler::getDeadline() const
+{
+	return m_running ? m_deadline : 0ULL;
+}
+
+void CTxScheduler::reset()
+{
+	m_buffer.clear();
+
+	if (m_running)
+		stop();
+}
+
+void CTxScheduler::stop()
+{
+	// The empty frames that ended the audio are not underruns
+	if (m_gap > 0U)
+		m_underruns -= m_gap;
+
+	LogDebug("%s: %u frames sent, %u deadlines missed, %u short frames, %u underruns, max lateness %.3f ms", m_name, m_frames, m_misses, m_short, m_underruns, float(m_maxLate) / 1000000.0F);
+
+	m_running   = false;
+	m_deadline  = 0ULL;
+	m_frames    = 0U;
+	m_misses    = 0U;
+	m_short     = 0U;
+	m_gap       = 0U;
+	m_underruns = 0U;
+	m_maxLate   = 0ULL;
+}
@@ -0,0 +1,76 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(TxScheduler_H)
+#define	TxScheduler_H
+
+#include "RingBuffer.h"
+
+#include <cstdint>
+
+// Sends audio in whole frames on a fixed grid of absolute deadlines so that
+// bursts of received audio leave the gateway at an even rate. The grid starts a
+// playout delay after the first audio arrives, and carries on through short gaps
+// so that audio arriving a little late is sent in its place rather than at once.
+class CTxScheduler {
+public:
+	CTxScheduler(unsigned int frameSamples, unsigned int frameMS, unsigned int delayMS, const char* name);
+	~CTxScheduler();
+
+	bool addData(const int16_t* data, unsigned int nSamples);
+
+	bool hasSpace(unsigned int nSamples) const;
+
+	bool isEmpty() const;
+
+	unsigned int dataSize() const;
+
+	// Returns the audio due at the given time, in nanoseconds, or zero if nothing is due
+	unsigned int getFrame(unsigned long long now, int16_t* data);
+
+	// The same, but the audio is left in place as two parts until releaseFrame() is called
+	unsigned int acquireFrame(unsigned long long now, const int16_t*& data1, unsigned int& length1, const int16_t*& data2, unsigned int& length2);
+
+	void releaseFrame(unsigned int nSamples);
+
+	// The time of the next frame, in nanoseconds, or zero if nothing is scheduled
+	unsigned long long getDeadline() const;
+
+	void reset();
+
+private:
+	unsigned int       m_frameSamples;
+	unsigned long long m_frameNS;
+	unsigned long long m_delayNS;
+	const char*        m_name;
+	CRingBuffer<int16_t> m_buffer;
+	bool               m_running;
+	unsigned long long m_deadline;
+	unsigned int       m_frames;
+	unsigned int       m_misses;
+	unsigned int       m_short;
+	unsigned int       m_gap;
+	unsigned int       m_underruns;
+	unsigned long long m_maxLate;
+
+	unsigned int nextFrame(unsigned long long now);
+
+	void stop();
+};
+
+#endif
@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2006-2016,2020,2024,2025 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2006-2016,2020,2024,2025,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -20,12 +20,22 @@
 #include "Log.h"
 
 #include <cassert>
+#include <vector>
 
 #if !defined(_WIN32) && !defined(_WIN64)
 #include <cerrno>
 #include <cstring>
 #endif
 
+#if defined(__linux__)
+#include <netinet/udp.h>
+
+const unsigned int MAX_BATCH_COUNT = 32U;
+#endif
+
+const unsigned int MAX_QUEUE_COUNT  = 16U;
+const unsigned int MAX_QUEUE_LENGTH = 2048U;
+
 CUDPSocket::CUDPSocket(const std::string& address, unsigned short port) :
 m_localAddress(address),
 m_localPort(port),
@@ -34,7 +44,15 @@ m_fd(INVALID_SOCKET),
 #else
 m_fd(-1),
 #endif
-m_af(AF_UNSPEC)
+m_af(AF_UNSPEC),
+m_queueing(false),
+m_queue(nullptr),
+m_queueLengths(nullptr),
+m_queueAddrs(nullptr),
+m_queueAddrLengths(nullptr),
+m_queueCount(0U),
+m_gso(true),
+m_reusePort(false)
 {
 }
 
@@ -46,12 +64,24 @@ m_fd(INVALID_SOCKET),
 #else
 m_fd(-1),
 #endif
-m_af(AF_UNSPEC)
+m_af(AF_UNSPEC),
+m_queueing(false),
+m_queue(nullptr),
+m_queueLengths(nullptr),
+m_queueAddrs(nullptr),
+m_queueAddrLengths(nullptr),
+m_queueCount(0U),
+m_gso(true),
+m_reusePort(false)
 {
 }
 
 CUDPSocket::~CUDPSocket()
 {
+	delete[] m_queue;
+	delete[] m_queueLengths;
+	delete[] m_queueAddrs;
+	delete[] m_queueAddrLengths;
 }
 
 void CUDPSocket::startup()
@@ -208,6 +238,21 @@ bool CUDPSocket::open()
 			return false;
 		}
 
+		// The kernel shares the senders between the sockets on the port by a hash of their addresses
+		if (m_reusePort) {
+#if defined(SO_REUSEPORT)
+			if (::setsockopt(m_fd, SOL_SOCKET, SO_REUSEPORT, (char *)&reuse, sizeof(reuse)) == -1) {
+				LogError("Cannot set the UDP socket option, err: %d", errno);
+				close();
+				return false;
+			}
+#else
+			LogError("Sharing a UDP port between sockets is not supported on this platform");
+			close();
+			return false;
+#endif
+		}
+
 		if (::bind(m_fd, (sockaddr*)&addr, addrlen) == -1) {
 #if defined(_WIN32) || defined(_WIN64)
 			LogError("Cannot bind the UDP address, err: %lu", ::GetLastError());
@@ -292,7 +337,278 @@ int CUDPSocket::read(unsigned char* buffer, unsigned int length, sockaddr_storag
 	return len;
 }
 
+// Read up to count datagrams without blocking, each into its own length byte slot of buffers
+int CUDPSocket::readBatch(unsigned char* buffers, unsigned int length, unsigned int count, unsigned int* lengths, sockaddr_storage* addresses, unsigned int* addressLengths)
+{
+	assert(buffers != nullptr);
+	assert(length > 0U);
+	assert(count > 0U);
+	assert(lengths != nullptr);
+	assert(addresses != nullptr);
+	assert(addressLengths != nullptr);
+
+#if defined(__linux__)
+	if (m_fd == -1)
+		return 0;
+
+	if (count > MAX_BATCH_COUNT)
+		count = MAX_BATCH_COUNT;
+
+	struct mmsghdr msgs[MAX_BATCH_COUNT];
+	struct iovec   iovs[MAX_BATCH_COUNT];
+
+	for (unsigned int i = 0U; i < count; i++) {
+		iovs[i].iov_base = buffers + i * length;
+		iovs[i].iov_len  = length;
+
+		::memset(&msgs[i], 0x00U, sizeof(struct mmsghdr));
+		msgs[i].msg_hdr.msg_name    = &addresses[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+		msgs[i].msg_hdr.msg_iov     = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen  = 1U;
+	}
+
+	int ret = ::recvmmsg(m_fd, msgs, count, MSG_DONTWAIT, nullptr);
+	if (ret < 0) {
+		int err = errno;
+		if (err == EAGAIN || err == EWOULDBLOCK)
+			return 0;
+
+		LogError("Error returned from recvmmsg, err: %d", err);
+
+		if (err == ENOTSOCK) {
+			LogMessage("Re-opening UDP port on %hu", m_localPort);
+			close();
+			open();
+		}
+
+		return -1;
+	}
+
+	for (int i = 0; i < ret; i++) {
+		lengths[i]        = msgs[i].msg_len;
+		addressLengths[i] = msgs[i].msg_hdr.msg_namelen;
+	}
+
+	return ret;
+#else
+	unsigned int n = 0U;
+
+	while (n < count) {
+		int len = read(buffers + n * length, length, addresses[n], addressLengths[n]);
+		if (len < 0)
+			return (n > 0U) ? int(n) : -1;
+		if (len == 0)
+			break;
+
+		lengths[n++] = (unsigned int)len;
+	}
+
+	return int(n);
+#endif
+}
+
 bool CUDPSocket::write(const unsigned char* buffer, unsigned int length, const sockaddr_storage& address, unsigned int addressLength)
+{
+	assert(buffer != nullptr);
+	assert(length > 0U);
+
+	if (!m_queueing)
+		return send(buffer, length, address, addressLength);
+
+	// Too big to queue, so keep the order and send it now
+	if (length > MAX_QUEUE_LENGTH) {
+		flush();
+		return send(buffer, length, address, addressLength);
+	}
+
+	if (m_queueCount == MAX_QUEUE_COUNT)
+		flush();
+
+	::memcpy(m_queue + m_queueCount * MAX_QUEUE_LENGTH, buffer, length);
+	m_queueLengths[m_queueCount]     = length;
+	m_queueAddrs[m_queueCount]       = address;
+	m_queueAddrLengths[m_queueCount] = addressLength;
+	m_queueCount++;
+
+	return true;
+}
+
+bool CUDPSocket::write(const unsigned char* header, unsigned int headerLength, const unsigned char* data1, unsigned int length1, const unsigned char* data2, unsigned int length2, const sockaddr_storage& address, unsigned int addressLength)
+{
+	assert(header != nullptr);
+	assert(data1 != nullptr || length1 == 0U);
+	assert(data2 != nullptr || length2 == 0U);
+
+	unsigned int length = headerLength + length1 + length2;
+	assert(length > 0U);
+
+	// Without a queue slot to join the parts in, join them here and send them in the normal way
+	if (!m_queueing || length > MAX_QUEUE_LENGTH) {
+		std::vector<unsigned char> buffer(length);
+		::memcpy(buffer.data(), header, headerLength);
+		if (length1 > 0U)
+			::memcpy(buffer.data() + headerLength, data1, length1);
+		if (length2 > 0U)
+			::memcpy(buffer.data() + headerLength + length1, data2, length2);
+
+		return write(buffer.data(), length, address, addressLength);
+	}
+
+	if (m_queueCount == MAX_QUEUE_COUNT)
+		flush();
+
+	// The parts are joined in the queue slot itself
+	unsigned char* slot = m_queue + m_queueCount * MAX_QUEUE_LENGTH;
+	::memcpy(slot, header, headerLength);
+	if (length1 > 0U)
+		::memcpy(slot + headerLength, data1, length1);
+	if (length2 > 0U)
+		::memcpy(slot + headerLength + length1, data2, length2);
+
+	m_queueLengths[m_queueCount]     = length;
+	m_queueAddrs[m_queueCount]       = address;
+	m_queueAddrLengths[m_queueCount] = addressLength;
+	m_queueCount++;
+
+	return true;
+}
+
+void CUDPSocket::setQueueing(bool enabled)
+{
+	if (!enabled)
+		flush();
+
+	if (enabled && m_queue == nullptr) {
+		m_queue            = new unsigned char[MAX_QUEUE_COUNT * MAX_QUEUE_LENGTH];
+		m_queueLengths     = new unsigned int[MAX_QUEUE_COUNT];
+		m_queueAddrs       = new sockaddr_storage[MAX_QUEUE_COUNT];
+		m_queueAddrLengths = new unsigned int[MAX_QUEUE_COUNT];
+	}
+
+	m_queueing = enabled;
+}
+
+void CUDPSocket::setReusePort(bool enabled)
+{
+	m_reusePort = enabled;
+}
+
+bool CUDPSocket::flush()
+{
+	if (m_queueCount == 0U)
+		return true;
+
+#if defined(_WIN32) || defined(_WIN64)
+	if (m_fd == INVALID_SOCKET) {
+#else
+	if (m_fd < 0) {
+#endif
+		m_queueCount = 0U;
+		return false;
+	}
+
+	bool result = true;
+
+#if defined(__linux__)
+	// Equal sized datagrams to one destination can go as a single UDP GSO send
+	if (m_gso && m_queueCount > 1U) {
+		bool same = true;
+		for (unsigned int i = 1U; i < m_queueCount && same; i++)
+			same = (m_queueLengths[i] == m_queueLengths[0U]) && match(m_queueAddrs[i], m_queueAddrs[0U]);
+
+		if (same && sendSegments()) {
+			m_queueCount = 0U;
+			return true;
+		}
+	}
+
+	struct mmsghdr msgs[MAX_QUEUE_COUNT];
+	struct iovec   iovs[MAX_QUEUE_COUNT];
+
+	for (unsigned int i = 0U; i < m_queueCount; i++) {
+		iovs[i].iov_base = m_queue + i * MAX_QUEUE_LENGTH;
+		iovs[i].iov_len  = m_queueLengths[i];
+
+		::memset(&msgs[i], 0x00U, sizeof(struct mmsghdr));
+		msgs[i].msg_hdr.msg_name    = &m_queueAddrs[i];
+		msgs[i].msg_hdr.msg_namelen = m_queueAddrLengths[i];
+		msgs[i].msg_hdr.msg_iov     = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen  = 1U;
+	}
+
+	unsigned int sent = 0U;
+	while (sent < m_queueCount) {
+		int ret = ::sendmmsg(m_fd, msgs + sent, m_queueCount - sent, 0);
+		if (ret < 0) {
+			LogError("Error returned from sendmmsg, err: %d", errno);
+			result = false;
+			break;
+		}
+
+		sent += (unsigned int)ret;
+	}
+#else
+	for (unsigned int i = 0U; i < m_queueCount; i++) {
+		if (!send(m_queue + i * MAX_QUEUE_LENGTH, m_queueLengths[i], m_queueAddrs[i], m_queueAddrLengths[i]))
+			result = false;
+	}
+#endif
+
+	m_queueCount = 0U;
+
+	return result;
+}
+
+bool CUDPSocket::sendSegments()
+{
+#if defined(__linux__) && defined(UDP_SEGMENT)
+	struct iovec iovs[MAX_QUEUE_COUNT];
+	for (unsigned int i = 0U; i < m_queueCount; i++) {
+		iovs[i].iov_base = m_queue + i * MAX_QUEUE_LENGTH;
+		iovs[i].iov_len  = m_queueLengths[i];
+	}
+
+	char control[CMSG_SPACE(sizeof(uint16_t))];
+	::memset(control, 0x00U, sizeof(control));
+
+	struct msghdr msg;
+	::memset(&msg, 0x00U, sizeof(struct msghdr));
+	msg.msg_name       = &m_queueAddrs[0U];
+	msg.msg_namelen    = m_queueAddrLengths[0U];
+	msg.msg_iov        = iovs;
+	msg.msg_iovlen     = m_queueCount;
+	msg.msg_control    = control;
+	msg.msg_controllen = sizeof(control);
+
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_UDP;
+	cmsg->cmsg_type  = UDP_SEGMENT;
+	cmsg->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+
+	uint16_t size = uint16_t(m_queueLengths[0U]);
+	::memcpy(CMSG_DATA(cmsg), &size, sizeof(uint16_t));
+
+	ssize_t ret = ::sendmsg(m_fd, &msg, 0);
+	if (ret < 0) {
+		// Older kernels and some interfaces cannot do this, so don't try again
+		int err = errno;
+		if (err == EIO || err == EINVAL || err == ENOPROTOOPT || err == EOPNOTSUPP) {
+			LogMessage("UDP segmentation offload is not available, err: %d", err);
+			m_gso = false;
+		}
+
+		return false;
+	}
+
+	return true;
+#else
+	m_gso = false;
+	return false;
+#endif
+}
+
+bool CUDPSocket::send(const unsigned char* buffer, unsigned int length, const sockaddr_storage& address, unsigned int addressLength)
 {
 	assert(buffer != nullptr);
 	assert(length > 0U);
@@ -331,6 +647,8 @@ bool CUDPSocket::write(const unsigned char* buffer, unsigned int length, const s
 
 void CUDPSocket::close()
 {
+	flush();
+
 #if defined(_WIN32) || defined(_WIN64)
 	if (m_fd != INVALID_SOCKET) {
 		::closesocket(m_fd);
@@ -343,3 +661,12 @@ void CUDPSocket::close()
 	}
 #endif
 }
+
+#if defined(_WIN32) || defined(_WIN64)
+SOCKET CUDPSocket::getFd() const
+#else
+int CUDPSocket::getFd() const
+#endif
+{
+	return m_fd;
+}
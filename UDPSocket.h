@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2009-2011,2013,2015,2016,2020,2024,2025 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2009-2011,2013,2015,2016,2020,2024,2025,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -51,10 +51,27 @@ public:
 	bool open(const sockaddr_storage& address);
 
 	int  read(unsigned char* buffer, unsigned int length, sockaddr_storage& address, unsigned int &addressLength);
+	int  readBatch(unsigned char* buffers, unsigned int length, unsigned int count, unsigned int* lengths, sockaddr_storage* addresses, unsigned int* addressLengths);
 	bool write(const unsigned char* buffer, unsigned int length, const sockaddr_storage& address, unsigned int addressLength);
 
+	// Sends a header followed by a payload held in two parts, joined in the send queue slot
+	bool write(const unsigned char* header, unsigned int headerLength, const unsigned char* data1, unsigned int length1, const unsigned char* data2, unsigned int length2, const sockaddr_storage& address, unsigned int addressLength);
+
+	// When queueing, write() holds the datagrams until flush() sends them together
+	void setQueueing(bool enabled);
+	bool flush();
+
+	// Lets several sockets bind the same port, set before open()
+	void setReusePort(bool enabled);
+
 	void close();
 
+#if defined(_WIN32) || defined(_WIN64)
+	SOCKET getFd() const;
+#else
+	int    getFd() const;
+#endif
+
 	static void startup();
 	static void shutdown();
 
@@ -75,6 +92,17 @@ private:
 	int            m_fd;
 	sa_family_t    m_af;
 #endif
+	bool              m_queueing;
+	unsigned char*    m_queue;
+	unsigned int*     m_queueLengths;
+	sockaddr_storage* m_queueAddrs;
+	unsigned int*     m_queueAddrLengths;
+	unsigned int      m_queueCount;
+	bool              m_gso;
+	bool              m_reusePort;
+
+	bool send(const unsigned char* buffer, unsigned int length, const sockaddr_storage& address, unsigned int addressLength);
+	bool sendSegments();
 };
 
 #endif
@@ -0,0 +1,135 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "ULawCodec.h"
+
+#include <cassert>
+
+const int MULAW_MAX  = 0x1FFF;
+const int MULAW_BIAS = 33;
+
+class CULawTables {
+public:
+	constexpr CULawTables() :
+	m_encode(),
+	m_pcm(),
+	m_float()
+	{
+		// Every biased and clipped magnitude, the segment is the position of its top bit above bit 5
+		for (unsigned int number = 0U; number <= unsigned(MULAW_MAX); number++) {
+			unsigned int segment = 0U;
+			for (unsigned int v = number >> 5; v > 1U; v >>= 1)
+				segment++;
+
+			unsigned int lsb = (number >> (segment + 1U)) & 0x0FU;
+
+			m_encode[number] = uint8_t(~((segment << 4) | lsb));
+		}
+
+		for (unsigned int i = 0U; i < 256U; i++) {
+			uint8_t number = ~uint8_t(i);
+
+			bool sign = true;
+			if ((number & 0x80U) == 0x80U) {
+				number &= 0x7FU;
+				sign = false;
+			}
+
+			unsigned int position = ((number & 0xF0U) >> 4) + 5U;
+			int decoded = ((1 << position) | ((number & 0x0FU) << (position - 4U)) | (1 << (position - 5U))) - MULAW_BIAS;
+
+			m_pcm[i]   = int16_t(sign ? decoded : -decoded);
+			m_float[i] = float(m_pcm[i]) / 65536.0F;
+		}
+	}
+
+	uint8_t m_encode[MULAW_MAX + 1];
+	int16_t m_pcm[256U];
+	float   m_float[256U];
+};
+
+static constexpr CULawTables TABLES;
+
+const uint32_t AST_FORMAT_ULAW = 0x00000004U;
+
+CULawCodec::CULawCodec()
+{
+}
+
+CULawCodec::~CULawCodec()
+{
+}
+
+uint32_t CULawCodec::getFormat() const
+{
+	return AST_FORMAT_ULAW;
+}
+
+const char* CULawCodec::getName() const
+{
+	return "u-law";
+}
+
+unsigned int CULawCodec::encode(const int16_t* audio, unsigned int nSamples, uint8_t* buffer)
+{
+	assert(audio != nullptr);
+	assert(buffer != nullptr);
+
+	for (unsigned int i = 0U; i < nSamples; i++) {
+		int sample = audio[i];
+
+		// All ones for a negative sample, otherwise zero
+		int negative = sample >> 31;
+
+		int number = ((sample ^ negative) - negative) + MULAW_BIAS;
+		number = (number > MULAW_MAX) ? MULAW_MAX : number;
+
+		// The sign bit is cleared for a negative sample
+		buffer[i] = TABLES.m_encode[number] & uint8_t(~(negative & 0x80));
+	}
+
+	return nSamples;
+}
+
+unsigned int CULawCodec::decode(const uint8_t* buffer, unsigned int length, int16_t* audio, unsigned int nAudio)
+{
+	assert(buffer != nullptr);
+	assert(audio != nullptr);
+
+	// One byte per sample
+	if (length > nAudio)
+		length = nAudio;
+
+	for (unsigned int i = 0U; i < length; i++)
+		audio[i] = TABLES.m_pcm[buffer[i]];
+
+	return length;
+}
+
+void CULawCodec::decode(const uint8_t* buffer, float* audio, unsigned int length) const
+{
+	assert(buffer != nullptr);
+	assert(audio != nullptr);
+
+	for (unsigned int i = 0U; i < length; i++)
+		audio[i] = TABLES.m_float[buffer[i]];
+}
+
+void CULawCodec::reset()
+{
+}
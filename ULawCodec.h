@@ -0,0 +1,47 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(ULawCodec_H)
+#define	ULawCodec_H
+
+#include "Codec.h"
+
+#include <cstdint>
+
+// G.711 u-law using tables that are built at compile time. The output is bit for bit the same
+// as the original IAX code, which works on 14-bit magnitudes.
+class CULawCodec : public ICodec {
+public:
+	CULawCodec();
+	virtual ~CULawCodec();
+
+	virtual uint32_t getFormat() const;
+
+	virtual const char* getName() const;
+
+	virtual unsigned int encode(const int16_t* audio, unsigned int nSamples, uint8_t* buffer);
+
+	virtual unsigned int decode(const uint8_t* buffer, unsigned int length, int16_t* audio, unsigned int nAudio);
+
+	// Decode to the float audio used in the gateway, scaled in the same way as CAudioConvert
+	void decode(const uint8_t* buffer, float* audio, unsigned int length) const;
+
+	virtual void reset();
+};
+
+#endif
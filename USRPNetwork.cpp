@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2020,2021,2023,2024,2025 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2020,2021,2023,2024,2025,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -17,6 +17,7 @@
  */
 
 #include "USRPNetwork.h"
+#include "AudioConvert.h"
 #include "Utils.h"
 #include "Log.h"
 
@@ -32,13 +33,23 @@
 #endif
 
 const unsigned int BUFFER_LENGTH = 1500U;
+const unsigned int BATCH_COUNT   = 16U;
+
+// Large enough to hold a whole batch of received audio
+const unsigned int RING_BUFFER_LENGTH = 20000U;
+
+// The most frames held while waiting for a missing one, 100 ms at 20 ms per frame
+const unsigned int REORDER_WINDOW = 5U;
+
+const unsigned int USRP_HEADER_LENGTH = 32U;
 
 CUSRPNetwork::CUSRPNetwork(const std::string& localAddress, uint16_t localPort, const std::string& gatewayAddress, uint16_t gatewayPort, bool debug) :
 m_socket(localAddress, localPort),
 m_addr(),
 m_addrLen(0U),
 m_debug(debug),
-m_buffer(2000U, "FM Network"),
+m_buffer(RING_BUFFER_LENGTH, "FM Network"),
+m_reorder("FM USRP Network", REORDER_WINDOW, BUFFER_LENGTH - USRP_HEADER_LENGTH, m_buffer),
 m_seqNo(0U)
 {
 	assert(gatewayPort > 0U);
@@ -61,7 +72,14 @@ bool CUSRPNetwork::open()
 
 	LogMessage("Opening FM USRP network connection");
 
-	return m_socket.open(m_addr);
+	bool ret = m_socket.open(m_addr);
+	if (!ret)
+		return false;
+
+	// Writes are sent together when the event loop next waits
+	m_socket.setQueueing(true);
+
+	return true;
 }
 
 bool CUSRPNetwork::writeStart(const std::string& callsign)
@@ -161,11 +179,19 @@ bool CUSRPNetwork::writeStart(const std::string& callsign)
 	}
 }
 
-bool CUSRPNetwork::writeData(const float* data, unsigned int nSamples)
+bool CUSRPNetwork::writeData(const int16_t* data, unsigned int nSamples)
 {
 	assert(data != nullptr);
 	assert(nSamples > 0U);
 
+	return writeData(data, nSamples, nullptr, 0U);
+}
+
+bool CUSRPNetwork::writeData(const int16_t* data1, unsigned int length1, const int16_t* data2, unsigned int length2)
+{
+	assert(data1 != nullptr);
+	assert(length1 > 0U);
+
 	uint8_t buffer[500U];
 	::memset(buffer, 0x00U, 500U);
 
@@ -214,18 +240,23 @@ bool CUSRPNetwork::writeData(const float* data, unsigned int nSamples)
 	buffer[length++] = 0x00U;
 	buffer[length++] = 0x00U;
 
-	for (unsigned int i = 0U; i < nSamples; i++) {
-		short val = short(data[i] * 32767.0F + 0.5F);			// Changing audio format from float to S16LE
+	m_seqNo++;
+
+	// The audio goes straight from the caller into the datagram after the header
+	if (!m_debug && CAudioConvert::isNativeS16LE())
+		return m_socket.write(buffer, length, (const uint8_t*)data1, length1 * sizeof(int16_t), (const uint8_t*)data2, length2 * sizeof(int16_t), m_addr, m_addrLen);
+
+	CAudioConvert::s16ToS16LE(data1, buffer + length, length1);
+	length += length1 * sizeof(int16_t);
 
-		buffer[length++] = (val >> 0) & 0xFFU;
-		buffer[length++] = (val >> 8) & 0xFFU;
+	if (length2 > 0U) {
+		CAudioConvert::s16ToS16LE(data2, buffer + length, length2);
+		length += length2 * sizeof(int16_t);
 	}
 
 	if (m_debug)
 		CUtils::dump(1U, "FM USRP Network Data Sent", buffer, length);
 
-	m_seqNo++;
-
 	return m_socket.write(buffer, length, m_addr, m_addrLen);
 }
 
@@ -293,15 +324,32 @@ bool CUSRPNetwork::writeEnd()
 	}
 }
 
-void CUSRPNetwork::clock(unsigned int ms)
+void CUSRPNetwork::clock(unsigned int us)
 {
-	uint8_t buffer[BUFFER_LENGTH];
+	m_reorder.clock(us);
 
-	sockaddr_storage addr;
-	unsigned int addrlen;
-	int length = m_socket.read(buffer, BUFFER_LENGTH, addr, addrlen);
-	if (length <= 0)
-		return;
+	uint8_t buffers[BATCH_COUNT * BUFFER_LENGTH];
+	unsigned int lengths[BATCH_COUNT];
+	sockaddr_storage addrs[BATCH_COUNT];
+	unsigned int addrLens[BATCH_COUNT];
+
+	// Drain everything that is waiting on the socket
+	for (;;) {
+		int n = m_socket.readBatch(buffers, BUFFER_LENGTH, BATCH_COUNT, lengths, addrs, addrLens);
+		if (n <= 0)
+			return;
+
+		for (int i = 0; i < n; i++)
+			processPacket(buffers + i * BUFFER_LENGTH, lengths[i], addrs[i]);
+
+		if (n < int(BATCH_COUNT))
+			return;
+	}
+}
+
+void CUSRPNetwork::processPacket(const uint8_t* buffer, unsigned int length, const sockaddr_storage& addr)
+{
+	assert(buffer != nullptr);
 
 	// Check if the data is for us
 	if (!CUDPSocket::match(addr, m_addr, IPMATCHTYPE::ADDRESS_AND_PORT)) {
@@ -312,11 +360,11 @@ void CUSRPNetwork::clock(unsigned int ms)
 	if (m_debug)
 		CUtils::dump(1U, "FM USRP Network Data Received", buffer, length);
 
-	// Invalid packet type?
-	if (::memcmp(buffer, "USRP", 4U) != 0)
+	if (length < USRP_HEADER_LENGTH)
 		return;
 
-	if (length < 32)
+	// Invalid packet type?
+	if (::memcmp(buffer, "USRP", 4U) != 0)
 		return;
 
 	// The type is a big-endian 4-byte integer
@@ -325,11 +373,39 @@ void CUSRPNetwork::clock(unsigned int ms)
 			    (buffer[22U] << 8)  +
 			    (buffer[23U] << 0);
 
-	if (type == 0U)
-		m_buffer.addData(buffer + 32U, length - 32U);
+	if (type != 0U)
+		return;
+
+	uint32_t seqNo = (buffer[4U] << 24) +
+			 (buffer[5U] << 16) +
+			 (buffer[6U] << 8)  +
+			 (buffer[7U] << 0);
+
+	uint32_t ptt = (buffer[12U] << 24) +
+		       (buffer[13U] << 16) +
+		       (buffer[14U] << 8)  +
+		       (buffer[15U] << 0);
+
+	if (length > USRP_HEADER_LENGTH)
+		m_reorder.addFrame(seqNo, buffer + USRP_HEADER_LENGTH, length - USRP_HEADER_LENGTH);
+
+	// PTT off ends the stream, so nothing held is waited for any longer
+	if (ptt == 0U)
+		m_reorder.end();
 }
 
-unsigned int CUSRPNetwork::readData(float* out, unsigned int nOut)
+void CUSRPNetwork::registerSockets(CEventLoop& loop)
+{
+	loop.addSocket(m_socket);
+}
+
+unsigned int CUSRPNetwork::getNextTimeout() const
+{
+	// When a missing frame is given up on
+	return m_reorder.getNextTimeout();
+}
+
+unsigned int CUSRPNetwork::readData(int16_t* out, unsigned int nOut)
 {
 	assert(out != nullptr);
 	assert(nOut > 0U);
@@ -341,19 +417,27 @@ unsigned int CUSRPNetwork::readData(float* out, unsigned int nOut)
 	if (bytes < nOut)
 		nOut = bytes;
 
-	uint8_t buffer[1500U];
-	m_buffer.getData(buffer, nOut * sizeof(uint16_t));
+	// Decode straight from the ring buffer storage
+	const uint8_t* data1 = nullptr;
+	const uint8_t* data2 = nullptr;
+	unsigned int length1 = 0U, length2 = 0U;
+	m_buffer.acquireRead(nOut * sizeof(uint16_t), data1, length1, data2, length2);
 
-	for (unsigned int i = 0U; i < nOut; i++) {
-		short val = ((buffer[i * 2U + 0U] & 0xFFU) << 0) + ((buffer[i * 2U + 1U] & 0xFFU) << 8);
-		out[i] = float(val) / 65536.0F;
-	}
+	CAudioConvert::s16LEToS16(data1, length1, data2, length2, out);
+
+	m_buffer.commitRead(nOut * sizeof(uint16_t));
 
 	return nOut;
 }
 
+AUDIO_FORMAT CUSRPNetwork::getFormat() const
+{
+	return AUDIO_FORMAT { AUDIO_ENCODING::PCM_S16LE, 8000U };
+}
+
 void CUSRPNetwork::reset()
 {
+	m_reorder.reset();
 	m_buffer.clear();
 }
 
@@ -1,5 +1,5 @@
 /*
- *   Copyright (C) 2020,2021,2023,2024 by Jonathan Naylor G4KLX
+ *   Copyright (C) 2020,2021,2023,2024,2026 by Jonathan Naylor G4KLX
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -19,7 +19,8 @@
 #ifndef	USRPNetwork_H
 #define	USRPNetwork_H
 
-#include "RingBuffer.h"
+#include "SPSCRingBuffer.h"
+#include "ReorderBuffer.h"
 #include "UDPSocket.h"
 #include "Network.h"
 
@@ -35,25 +36,35 @@ public:
 
 	virtual bool writeStart(const std::string& callsign);
 
-	virtual bool writeData(const float* data, unsigned int nSamples);
+	virtual bool writeData(const int16_t* data, unsigned int nSamples);
+	virtual bool writeData(const int16_t* data1, unsigned int length1, const int16_t* data2, unsigned int length2);
 
 	virtual bool writeEnd();
 
-	virtual unsigned int readData(float* out, unsigned int nOut);
+	virtual unsigned int readData(int16_t* out, unsigned int nOut);
 
 	virtual void reset();
 
 	virtual void close();
 
-	virtual void clock(unsigned int ms);
+	virtual void clock(unsigned int us);
+
+	virtual void registerSockets(CEventLoop& loop);
+
+	virtual unsigned int getNextTimeout() const;
+
+	virtual AUDIO_FORMAT getFormat() const;
 
 private:
 	CUDPSocket          m_socket;
 	sockaddr_storage    m_addr;
 	unsigned int        m_addrLen;
 	bool                m_debug;
-	CRingBuffer<uint8_t> m_buffer;
+	CSPSCRingBuffer<uint8_t> m_buffer;
+	CReorderBuffer      m_reorder;
 	uint32_t            m_seqNo;
+
+	void processPacket(const uint8_t* buffer, unsigned int length, const sockaddr_storage& addr);
 };
 
 #endif
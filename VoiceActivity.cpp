@@ -0,0 +1,108 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "VoiceActivity.h"
+#include "Log.h"
+
+#include <cassert>
+#include <cmath>
+
+// The mean square of a full scale sine wave, the 0 dBov reference
+const double FULL_SCALE = (32767.0 * 32767.0) / 2.0;
+
+// The quietest level that comfort noise can describe
+const unsigned int MAX_NOISE_LEVEL = 127U;
+
+CVoiceActivity::CVoiceActivity(int thresholdDB, unsigned int hangoverMS, unsigned int frameMS) :
+m_threshold(0.0),
+m_hangover(0U),
+m_count(0U),
+m_level(MAX_NOISE_LEVEL),
+m_frames(0U),
+m_suppressed(0U)
+{
+	assert(frameMS > 0U);
+
+	// Compare mean squares so that no logarithm is needed for voice frames
+	m_threshold = FULL_SCALE * std::pow(10.0, double(thresholdDB) / 10.0);
+
+	m_hangover = (hangoverMS + frameMS - 1U) / frameMS;
+
+	reset();
+}
+
+CVoiceActivity::~CVoiceActivity()
+{
+}
+
+bool CVoiceActivity::process(const int16_t* data1, unsigned int length1, const int16_t* data2, unsigned int length2)
+{
+	assert(data1 != nullptr || length1 == 0U);
+	assert(data2 != nullptr || length2 == 0U);
+
+	unsigned int n = length1 + length2;
+	if (n == 0U)
+		return true;
+
+	int64_t sum = 0;
+	for (unsigned int i = 0U; i < length1; i++)
+		sum += int32_t(data1[i]) * int32_t(data1[i]);
+	for (unsigned int i = 0U; i < length2; i++)
+		sum += int32_t(data2[i]) * int32_t(data2[i]);
+
+	double power = double(sum) / double(n);
+
+	m_frames++;
+
+	if (power >= m_threshold) {
+		m_count = m_hangover;
+		return true;
+	}
+
+	if (m_count > 0U) {
+		m_count--;
+		return true;
+	}
+
+	if (power > 0.0) {
+		double level = -10.0 * std::log10(power / FULL_SCALE);
+		m_level = (level >= double(MAX_NOISE_LEVEL)) ? MAX_NOISE_LEVEL : (level <= 0.0 ? 0U : (unsigned int)(level + 0.5));
+	} else {
+		m_level = MAX_NOISE_LEVEL;
+	}
+
+	m_suppressed++;
+
+	return false;
+}
+
+unsigned int CVoiceActivity::getNoiseLevel() const
+{
+	return m_level;
+}
+
+void CVoiceActivity::reset()
+{
+	if (m_frames > 0U)
+		LogDebug("DTX: %u of %u frames suppressed", m_suppressed, m_frames);
+
+	m_count      = m_hangover;
+	m_level      = MAX_NOISE_LEVEL;
+	m_frames     = 0U;
+	m_suppressed = 0U;
+}
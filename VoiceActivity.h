@@ -0,0 +1,50 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(VoiceActivity_H)
+#define	VoiceActivity_H
+
+#include <cstdint>
+
+// An energy based voice activity detector for discontinuous transmission. A frame counts as
+// voice when its level is above the threshold, and the voice state is held for the hangover
+// time so that word endings and short pauses are still sent.
+class CVoiceActivity {
+public:
+	CVoiceActivity(int thresholdDB, unsigned int hangoverMS, unsigned int frameMS);
+	~CVoiceActivity();
+
+	// Returns true if the frame, held in two parts, should be sent
+	bool process(const int16_t* data1, unsigned int length1, const int16_t* data2, unsigned int length2);
+
+	// The level of the last frame in -dBov, as used by comfort noise
+	unsigned int getNoiseLevel() const;
+
+	// Called at the start of each transmission, which always begins as voice
+	void reset();
+
+private:
+	double       m_threshold;
+	unsigned int m_hangover;
+	unsigned int m_count;
+	unsigned int m_level;
+	unsigned int m_frames;
+	unsigned int m_suppressed;
+};
+
+#endif
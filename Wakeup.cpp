@@ -0,0 +1,95 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Wakeup.h"
+#include "Log.h"
+
+#include <cassert>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/eventfd.h>
+#include <cerrno>
+#include <cstdint>
+#include <unistd.h>
+#endif
+
+CWakeup::CWakeup() :
+m_fd(-1)
+{
+}
+
+CWakeup::~CWakeup()
+{
+}
+
+bool CWakeup::open()
+{
+	assert(m_fd == -1);
+
+#if defined(_WIN32) || defined(_WIN64)
+	LogError("Waking another thread's event loop is not supported on Windows");
+	return false;
+#else
+	m_fd = ::eventfd(0U, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_fd < 0) {
+		LogError("Cannot create the wake up event, err: %d", errno);
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+void CWakeup::signal()
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (m_fd < 0)
+		return;
+
+	uint64_t count = 1U;
+	ssize_t len = ::write(m_fd, &count, sizeof(uint64_t));
+	(void)len;
+#endif
+}
+
+void CWakeup::clear()
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (m_fd < 0)
+		return;
+
+	uint64_t count;
+	ssize_t len = ::read(m_fd, &count, sizeof(uint64_t));
+	(void)len;
+#endif
+}
+
+int CWakeup::getFd() const
+{
+	return m_fd;
+}
+
+void CWakeup::close()
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (m_fd >= 0) {
+		::close(m_fd);
+		m_fd = -1;
+	}
+#endif
+}
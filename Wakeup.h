@@ -0,0 +1,43 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(Wakeup_H)
+#define	Wakeup_H
+
+// Lets one thread wake another that is waiting in an event loop. Any thread may signal it, the
+// event loop that it has been added to clears it when it wakes. Only available on Linux.
+class CWakeup {
+public:
+	CWakeup();
+	~CWakeup();
+
+	bool open();
+
+	void signal();
+
+	void clear();
+
+	int getFd() const;
+
+	void close();
+
+private:
+	int m_fd;
+};
+
+#endif
@@ -0,0 +1,307 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "WorkerPool.h"
+#include "EventLoop.h"
+#include "Log.h"
+
+#include <cassert>
+#include <cmath>
+
+// How often, in nanoseconds, the statistics of the shards are published
+const unsigned long long STATS_INTERVAL = 60000000000ULL;
+
+// The deadline of a shard whose links have no timers running
+const unsigned long long NO_DEADLINE = 0xFFFFFFFFFFFFFFFFULL;
+
+// Every shard is still clocked at least this often, in microseconds, even with nothing to do
+const unsigned int MAX_IDLE = 1000000U;
+
+CWorker::CWorker(CWorkerPool& pool, unsigned int shard) :
+CThread(),
+m_pool(pool),
+m_shard(shard)
+{
+}
+
+CWorker::~CWorker()
+{
+}
+
+void CWorker::entry()
+{
+	m_pool.pin(m_shard);
+
+	m_pool.work(m_shard);
+}
+
+CWorkerPool::SHARD::SHARD() :
+m_cpu(-1),
+m_links(0U),
+m_passes(0U),
+m_busy(0ULL),
+m_longest(0ULL),
+m_deadline(0ULL),
+m_us(0U),
+m_due(false),
+m_run(false),
+m_wake()
+{
+}
+
+CWorkerPool::CWorkerPool(unsigned int threads, const std::vector<unsigned int>& cpus) :
+m_workers(),
+m_shards(threads + 1U),
+m_mutex(),
+m_done(),
+m_links(nullptr),
+m_pending(0U),
+m_stopped(false),
+m_statsTime(0ULL)
+{
+	// The calling thread is the first shard
+	for (unsigned int i = 0U; (i < cpus.size()) && (i < m_shards.size()); i++)
+		m_shards[i].m_cpu = int(cpus[i]);
+
+	for (unsigned int i = 1U; i < m_shards.size(); i++)
+		m_workers.push_back(new CWorker(*this, i));
+}
+
+CWorkerPool::~CWorkerPool()
+{
+	for (std::vector<CWorker*>::const_iterator it = m_workers.cbegin(); it != m_workers.cend(); ++it)
+		delete *it;
+}
+
+bool CWorkerPool::start()
+{
+	pin(0U);
+
+	for (std::vector<CWorker*>::const_iterator it = m_workers.cbegin(); it != m_workers.cend(); ++it) {
+		bool ret = (*it)->run();
+		if (!ret) {
+			LogError("Unable to start a worker thread");
+			return false;
+		}
+	}
+
+	if (!m_workers.empty())
+		LogMessage("Started %u worker threads", (unsigned int)m_workers.size());
+
+	m_statsTime = CEventLoop::now();
+
+	return true;
+}
+
+unsigned long long CWorkerPool::getDeadline(unsigned long long deadline) const
+{
+	for (std::vector<SHARD>::const_iterator it = m_shards.cbegin(); it != m_shards.cend(); ++it) {
+		if (it->m_deadline < deadline)
+			deadline = it->m_deadline;
+	}
+
+	return deadline;
+}
+
+void CWorkerPool::clock(const std::vector<CGatewayLink*>& links, const CEventLoop& loop, unsigned int us)
+{
+	unsigned long long now = CEventLoop::now();
+
+	// A shard that is not due keeps the time for when it is next clocked
+	for (std::vector<SHARD>::iterator it = m_shards.begin(); it != m_shards.end(); ++it) {
+		it->m_us += us;
+		it->m_due = (it->m_deadline <= now) || (it->m_us >= MAX_IDLE);
+	}
+
+	for (unsigned int i = 0U; i < links.size(); i++) {
+		if (loop.isReady(i))
+			m_shards[i % m_shards.size()].m_due = true;
+	}
+
+	unsigned int woken = 0U;
+	for (unsigned int i = 1U; i < m_shards.size(); i++) {
+		if (m_shards[i].m_due)
+			woken++;
+	}
+
+	if (woken > 0U) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			m_links   = &links;
+			m_pending = woken;
+
+			for (unsigned int i = 1U; i < m_shards.size(); i++)
+				m_shards[i].m_run = m_shards[i].m_due;
+		}
+
+		for (unsigned int i = 1U; i < m_shards.size(); i++) {
+			if (m_shards[i].m_due)
+				m_shards[i].m_wake.notify_one();
+		}
+	}
+
+	if (m_shards[0U].m_due)
+		runShard(0U, links);
+
+	if (woken > 0U) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this] { return m_pending == 0U; });
+
+		m_links = nullptr;
+	}
+
+	now = CEventLoop::now();
+	if (now >= (m_statsTime + STATS_INTERVAL))
+		publish(now);
+}
+
+void CWorkerPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopped = true;
+	}
+
+	for (unsigned int i = 1U; i < m_shards.size(); i++)
+		m_shards[i].m_wake.notify_one();
+
+	for (std::vector<CWorker*>::const_iterator it = m_workers.cbegin(); it != m_workers.cend(); ++it)
+		(*it)->wait();
+}
+
+void CWorkerPool::work(unsigned int shard)
+{
+	assert(shard < m_shards.size());
+
+	SHARD& state = m_shards[shard];
+
+	for (;;) {
+		const std::vector<CGatewayLink*>* links;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			state.m_wake.wait(lock, [this, &state] { return m_stopped || state.m_run; });
+
+			if (m_stopped)
+				return;
+
+			state.m_run = false;
+			links       = m_links;
+		}
+
+		runShard(shard, *links);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_pending == 0U)
+			m_done.notify_one();
+	}
+}
+
+void CWorkerPool::runShard(unsigned int shard, const std::vector<CGatewayLink*>& links)
+{
+	assert(shard < m_shards.size());
+
+	SHARD& stats = m_shards[shard];
+
+	unsigned int us = stats.m_us;
+	stats.m_us = 0U;
+
+	unsigned long long start = CEventLoop::now();
+
+	// The links are dealt out to the shards in turn, each shard only ever clocks its own
+	unsigned int count = 0U;
+	for (unsigned int i = shard; i < links.size(); i += (unsigned int)m_shards.size()) {
+		links[i]->clock(us);
+		count++;
+	}
+
+	unsigned long long end = CEventLoop::now();
+
+	// Only this thread writes to its shard while it runs, the rest is read once every shard is done
+	unsigned long long deadline = NO_DEADLINE;
+	for (unsigned int i = shard; i < links.size(); i += (unsigned int)m_shards.size())
+		deadline = links[i]->getDeadline(end, deadline);
+	stats.m_deadline = deadline;
+
+	unsigned long long elapsed = end - start;
+
+	stats.m_links = count;
+	stats.m_passes++;
+	stats.m_busy += elapsed;
+	if (elapsed > stats.m_longest)
+		stats.m_longest = elapsed;
+}
+
+bool CWorkerPool::pin(unsigned int shard)
+{
+	assert(shard < m_shards.size());
+
+	int cpu = m_shards[shard].m_cpu;
+	if (cpu < 0)
+		return true;
+
+	bool ret = CThread::setAffinity((unsigned int)cpu);
+	if (!ret) {
+		LogWarning("Unable to pin shard %u to CPU %d", shard, cpu);
+		return false;
+	}
+
+	LogMessage("Shard %u is pinned to CPU %d", shard, cpu);
+
+	return true;
+}
+
+void CWorkerPool::publish(unsigned long long now)
+{
+	double interval = double(now - m_statsTime);
+
+	nlohmann::json shards = nlohmann::json::array();
+
+	for (unsigned int i = 0U; i < m_shards.size(); i++) {
+		SHARD& stats = m_shards[i];
+
+		double load    = (interval > 0.0) ? (100.0 * double(stats.m_busy) / interval) : 0.0;
+		double longest = double(stats.m_longest) / 1000000.0;
+
+		LogDebug("Shard %u: %u links, %u passes, %.1f%% busy, longest pass %.2f ms", i, stats.m_links, stats.m_passes, load, longest);
+
+		nlohmann::json json;
+
+		json["shard"]   = i;
+		json["cpu"]     = stats.m_cpu;
+		json["links"]   = stats.m_links;
+		json["passes"]  = stats.m_passes;
+		json["load"]    = std::round(load * 10.0) / 10.0;
+		json["longest"] = std::round(longest * 100.0) / 100.0;
+
+		shards.push_back(json);
+
+		stats.m_passes  = 0U;
+		stats.m_busy    = 0ULL;
+		stats.m_longest = 0ULL;
+	}
+
+	nlohmann::json json;
+
+	json["interval"] = std::round(interval / 1000000000.0);
+	json["shards"]   = shards;
+
+	WriteJSON("workers", json);
+
+	m_statsTime = now;
+}
@@ -0,0 +1,102 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(WorkerPool_H)
+#define	WorkerPool_H
+
+#include "GatewayLink.h"
+#include "EventLoop.h"
+#include "Thread.h"
+
+#include <condition_variable>
+#include <vector>
+#include <mutex>
+
+class CWorkerPool;
+
+class CWorker : public CThread {
+public:
+	CWorker(CWorkerPool& pool, unsigned int shard);
+	virtual ~CWorker();
+
+	virtual void entry();
+
+private:
+	CWorkerPool& m_pool;
+	unsigned int m_shard;
+};
+
+// Shares the clocking of the links between a number of threads and the thread that calls
+// clock(), which returns once every link that was due has been clocked. Each thread is a shard
+// that always clocks the same links, so a link's state stays with one thread and, when a thread
+// is pinned to a CPU, in that CPU's caches. A shard is only woken when one of its links has a
+// readable socket or a deadline that has passed, so idle shards cost nothing. The event loop
+// stays on the calling thread, so the sockets are only written to while the workers are busy.
+//
+// The unit of sharding is the link. All of the peers on a link's sockets are handled by that
+// link's shard, because they all share the link's mixer and FM network. The nodes connected to an
+// inbound IAX port can be spread further with its Shards setting, see CNetworkShards.
+class CWorkerPool {
+public:
+	CWorkerPool(unsigned int threads, const std::vector<unsigned int>& cpus);
+	~CWorkerPool();
+
+	bool start();
+
+	// Brings the deadline, in nanoseconds, forward to when the next shard needs to be clocked
+	unsigned long long getDeadline(unsigned long long deadline) const;
+
+	// The sockets of link N are in group N of the event loop
+	void clock(const std::vector<CGatewayLink*>& links, const CEventLoop& loop, unsigned int us);
+
+	void stop();
+
+private:
+	friend class CWorker;
+
+	struct SHARD {
+		SHARD();
+
+		int                     m_cpu;
+		unsigned int            m_links;
+		unsigned int            m_passes;
+		unsigned long long      m_busy;
+		unsigned long long      m_longest;
+		unsigned long long      m_deadline;
+		unsigned int            m_us;
+		bool                    m_due;
+		bool                    m_run;
+		std::condition_variable m_wake;
+	};
+
+	std::vector<CWorker*>                     m_workers;
+	std::vector<SHARD>                        m_shards;
+	std::mutex                                m_mutex;
+	std::condition_variable                   m_done;
+	const std::vector<CGatewayLink*>*         m_links;
+	unsigned int                              m_pending;
+	bool                                      m_stopped;
+	unsigned long long                        m_statsTime;
+
+	void work(unsigned int shard);
+	void runShard(unsigned int shard, const std::vector<CGatewayLink*>& links);
+	bool pin(unsigned int shard);
+	void publish(unsigned long long now);
+};
+
+#endif
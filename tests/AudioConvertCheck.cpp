@@ -0,0 +1,295 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Compares each set of vector kernels that the CPU supports with the scalar ones, and times a
+// frame of conversion with each. Built and run by "make check", not part of the gateway.
+
+#include "AudioConvert.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <random>
+#include <vector>
+
+const char* KERNELS[] = { "SSE2", "AVX2", "NEON" };
+
+// Long enough to cover every tail length of the widest kernels at several alignments
+const unsigned int MAX_LENGTH = 67U;
+
+const unsigned int FRAME_SAMPLES = 160U;
+const unsigned int BENCH_FRAMES  = 200000U;
+
+static std::mt19937 m_random(1U);
+
+static std::vector<float> makeEncodeInput()
+{
+	std::vector<float> in;
+
+	// Either side of each point where the rounding changes, and of full scale
+	for (int i = -32769; i <= 32768; i++) {
+		float edge = (float(i) - 0.5F) / 32767.0F;
+		in.push_back(::nextafterf(edge, -2.0F));
+		in.push_back(edge);
+		in.push_back(::nextafterf(edge, 2.0F));
+	}
+
+	std::uniform_real_distribution<float> dist(-1.5F, 1.5F);
+	for (unsigned int i = 0U; i < 200000U; i++)
+		in.push_back(dist(m_random));
+
+	in.push_back(0.0F);
+	in.push_back(-0.0F);
+	in.push_back(100.0F);
+	in.push_back(-100.0F);
+
+	return in;
+}
+
+static bool checkEncode(const char* name, const std::vector<float>& in)
+{
+	std::vector<int16_t> ref(in.size()), out(in.size());
+
+	CAudioConvert::setKernels("scalar");
+	CAudioConvert::floatToS16(in.data(), ref.data(), (unsigned int)in.size());
+
+	CAudioConvert::setKernels(name);
+	CAudioConvert::floatToS16(in.data(), out.data(), (unsigned int)in.size());
+
+	for (unsigned int i = 0U; i < in.size(); i++) {
+		if (out[i] != ref[i]) {
+			::fprintf(stderr, "%s encode differs for %.9g: %d, scalar %d\n", name, in[i], out[i], ref[i]);
+			return false;
+		}
+	}
+
+	// Every length and offset, so that the tails are covered as well
+	for (unsigned int offset = 0U; offset < 8U; offset++) {
+		for (unsigned int n = 1U; n <= MAX_LENGTH; n++) {
+			int16_t a[MAX_LENGTH], b[MAX_LENGTH];
+
+			CAudioConvert::setKernels("scalar");
+			CAudioConvert::floatToS16(in.data() + offset * 997U, a, n);
+
+			CAudioConvert::setKernels(name);
+			CAudioConvert::floatToS16(in.data() + offset * 997U, b, n);
+
+			if (::memcmp(a, b, n * sizeof(int16_t)) != 0) {
+				::fprintf(stderr, "%s encode differs for a block of %u at offset %u\n", name, n, offset);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool checkDecode(const char* name)
+{
+	std::vector<int16_t> in;
+	for (int i = -32768; i <= 32767; i++)
+		in.push_back(int16_t(i));
+
+	std::vector<float> ref(in.size()), out(in.size());
+
+	CAudioConvert::setKernels("scalar");
+	CAudioConvert::s16ToFloat(in.data(), ref.data(), (unsigned int)in.size());
+
+	CAudioConvert::setKernels(name);
+	CAudioConvert::s16ToFloat(in.data(), out.data(), (unsigned int)in.size());
+
+	if (::memcmp(ref.data(), out.data(), ref.size() * sizeof(float)) != 0) {
+		::fprintf(stderr, "%s decode differs\n", name);
+		return false;
+	}
+
+	// A trip through float and back must give the same sample at the level change of the gateway
+	std::vector<int16_t> scaled(in.size()), trip(in.size());
+	CAudioConvert::scaleS16(in.data(), scaled.data(), (unsigned int)in.size());
+	CAudioConvert::floatToS16(out.data(), trip.data(), (unsigned int)out.size());
+
+	for (unsigned int i = 0U; i < in.size(); i++) {
+		if (scaled[i] != trip[i]) {
+			::fprintf(stderr, "%s round trip differs for %d: %d, scaleS16 %d\n", name, in[i], trip[i], scaled[i]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool checkMix(const char* name)
+{
+	std::uniform_int_distribution<int> sample(-32768, 32767);
+
+	std::vector<int16_t> in(4096U);
+	for (std::vector<int16_t>::iterator it = in.begin(); it != in.end(); ++it)
+		*it = int16_t(sample(m_random));
+
+	const int16_t gains[] = { 0, 1, 2048, 4096, 8191, 32767, -1, -4096, -32768 };
+
+	for (unsigned int g = 0U; g < (sizeof(gains) / sizeof(int16_t)); g++) {
+		for (unsigned int n = 1U; n <= MAX_LENGTH; n++) {
+			int32_t a[MAX_LENGTH], b[MAX_LENGTH];
+			for (unsigned int i = 0U; i < n; i++)
+				a[i] = b[i] = int32_t(i * 1000U);
+
+			CAudioConvert::setKernels("scalar");
+			CAudioConvert::mixS16(in.data() + n, gains[g], a, n);
+
+			CAudioConvert::setKernels(name);
+			CAudioConvert::mixS16(in.data() + n, gains[g], b, n);
+
+			if (::memcmp(a, b, n * sizeof(int32_t)) != 0) {
+				::fprintf(stderr, "%s mix differs for a block of %u with a gain of %d\n", name, n, gains[g]);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool checkMeasure(const char* name)
+{
+	std::uniform_int_distribution<int> sample(-32768, 32767);
+
+	std::vector<int16_t> in(4096U);
+	for (std::vector<int16_t>::iterator it = in.begin(); it != in.end(); ++it)
+		*it = int16_t(sample(m_random));
+
+	// Both ends of the range, which are clips
+	in[5U]  = 32767;
+	in[17U] = -32768;
+	in[40U] = -32767;
+
+	for (unsigned int n = 1U; n <= in.size(); n += (n < MAX_LENGTH) ? 1U : 511U) {
+		uint64_t sum1 = 0U, sum2 = 0U;
+		unsigned int peak1 = 0U, peak2 = 0U, clips1 = 0U, clips2 = 0U;
+
+		CAudioConvert::setKernels("scalar");
+		CAudioConvert::measureS16(in.data(), n, sum1, peak1, clips1);
+
+		CAudioConvert::setKernels(name);
+		CAudioConvert::measureS16(in.data(), n, sum2, peak2, clips2);
+
+		if ((sum1 != sum2) || (peak1 != peak2) || (clips1 != clips2)) {
+			::fprintf(stderr, "%s measure differs for a block of %u\n", name, n);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool checkDot(const char* name)
+{
+	std::uniform_real_distribution<float> dist(-1.0F, 1.0F);
+
+	std::vector<float> a(1024U), b(1024U);
+	for (unsigned int i = 0U; i < a.size(); i++) {
+		a[i] = dist(m_random);
+		b[i] = dist(m_random);
+	}
+
+	// The sums are added in a different order, so only a rounding difference is allowed
+	for (unsigned int n = 1U; n <= a.size(); n += (n < MAX_LENGTH) ? 1U : 97U) {
+		CAudioConvert::setKernels("scalar");
+		float ref = CAudioConvert::dotProduct(a.data(), b.data(), n);
+
+		CAudioConvert::setKernels(name);
+		float out = CAudioConvert::dotProduct(a.data(), b.data(), n);
+
+		double scale = 0.0;
+		for (unsigned int i = 0U; i < n; i++)
+			scale += std::fabs(double(a[i]) * double(b[i]));
+
+		if (std::fabs(double(out) - double(ref)) > (scale * 1.0E-6)) {
+			::fprintf(stderr, "%s dot product differs for a block of %u: %.9g, scalar %.9g\n", name, n, out, ref);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void bench(const char* name)
+{
+	std::uniform_real_distribution<float> dist(-1.0F, 1.0F);
+
+	float in[FRAME_SAMPLES];
+	for (unsigned int i = 0U; i < FRAME_SAMPLES; i++)
+		in[i] = dist(m_random);
+
+	int16_t pcm[FRAME_SAMPLES];
+	float out[FRAME_SAMPLES];
+
+	CAudioConvert::setKernels(name);
+
+	unsigned int sum = 0U;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0U; i < BENCH_FRAMES; i++) {
+		CAudioConvert::floatToS16(in, pcm, FRAME_SAMPLES);
+		sum += pcm[i % FRAME_SAMPLES];
+	}
+	std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+	for (unsigned int i = 0U; i < BENCH_FRAMES; i++) {
+		CAudioConvert::s16ToFloat(pcm, out, FRAME_SAMPLES);
+		sum += (unsigned int)out[i % FRAME_SAMPLES];
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	double encode = std::chrono::duration<double, std::nano>(middle - start).count() / BENCH_FRAMES;
+	double decode = std::chrono::duration<double, std::nano>(end - middle).count() / BENCH_FRAMES;
+
+	::printf("%-6s encode %6.1f ns, decode %6.1f ns per %u sample frame (%u)\n", name, encode, decode, FRAME_SAMPLES, sum & 1U);
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<float> in = makeEncodeInput();
+
+	bench("scalar");
+
+	bool ok = true;
+	unsigned int count = 0U;
+
+	for (unsigned int i = 0U; i < (sizeof(KERNELS) / sizeof(const char*)); i++) {
+		const char* name = KERNELS[i];
+		if (!CAudioConvert::setKernels(name))
+			continue;
+
+		count++;
+
+		bool ret = checkEncode(name, in) && checkDecode(name) && checkMix(name) && checkMeasure(name) && checkDot(name);
+		if (ret)
+			::printf("%-6s matches the scalar kernels\n", name);
+
+		ok = ok && ret;
+
+		bench(name);
+	}
+
+	if (count == 0U)
+		::printf("No vector kernels are available, only the scalar ones were run\n");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Runs the event loop as the gateway's main loop does, first with nothing to do, counting how
+// often it wakes, and then forwarding datagrams from one socket to another, timing each from
+// when it was sent until it has been forwarded and read back through the loop. Built and run
+// by "make check", not part of the gateway.
+
+#include "EventLoop.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Ports on the loopback interface for the datagrams to be forwarded between
+const unsigned short INPUT_PORT  = 47011U;
+const unsigned short OUTPUT_PORT = 47012U;
+
+// As in the gateway, the longest wait with no timers running
+const unsigned int MAX_WAIT = 1000U;
+
+const unsigned int IDLE_SECONDS = 2U;
+
+const unsigned int PACKETS    = 200U;
+const unsigned int SPACING_MS = 5U;
+
+// The old main loop slept for 10 ms on every pass
+const unsigned int OLD_SLEEP_MS = 10U;
+
+// The sockets and the loop only log their errors, which are shown
+void Log(unsigned int level, const char* fmt, ...)
+{
+	if (level < 4U)
+		return;
+
+	va_list vl;
+	va_start(vl, fmt);
+	::vfprintf(stderr, fmt, vl);
+	va_end(vl);
+
+	::fputc('\n', stderr);
+}
+
+static bool checkIdle(CEventLoop& loop)
+{
+	unsigned long long end = CEventLoop::now() + IDLE_SECONDS * 1000000000ULL;
+
+	unsigned int wakeups = 0U;
+	for (;;) {
+		unsigned long long now = CEventLoop::now();
+		if (now >= end)
+			break;
+
+		if (!loop.waitUntil(now + MAX_WAIT * 1000000ULL))
+			return false;
+
+		wakeups++;
+	}
+
+	double perSecond = double(wakeups) / double(IDLE_SECONDS);
+
+	::printf("Event loop idle: %.1f wakeups per second, the old loop %u\n", perSecond, 1000U / OLD_SLEEP_MS);
+
+	if (wakeups > (IDLE_SECONDS + 1U)) {
+		::fprintf(stderr, "The idle event loop woke %u times in %u seconds\n", wakeups, IDLE_SECONDS);
+		return false;
+	}
+
+	return true;
+}
+
+static bool checkForwarding(CEventLoop& loop, CUDPSocket& input, CUDPSocket& output)
+{
+	sockaddr_storage inputAddr, outputAddr;
+	unsigned int inputAddrLen, outputAddrLen;
+	if ((CUDPSocket::lookup("127.0.0.1", INPUT_PORT, inputAddr, inputAddrLen) != 0) ||
+	    (CUDPSocket::lookup("127.0.0.1", OUTPUT_PORT, outputAddr, outputAddrLen) != 0)) {
+		::fprintf(stderr, "Cannot look up the loopback address\n");
+		return false;
+	}
+
+	CUDPSocket sender("127.0.0.1");
+	if (!sender.open()) {
+		::fprintf(stderr, "Cannot open the sending socket\n");
+		return false;
+	}
+
+	// Each datagram carries the time it was sent
+	std::thread thread([&sender, &inputAddr, inputAddrLen]() {
+		for (unsigned int i = 0U; i < PACKETS; i++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(SPACING_MS));
+
+			unsigned long long sent = CEventLoop::now();
+			sender.write((const unsigned char*)&sent, sizeof(sent), inputAddr, inputAddrLen);
+		}
+	});
+
+	std::vector<double> latencies;
+
+	unsigned char buffer[100U];
+	sockaddr_storage addr;
+	unsigned int addrLen;
+
+	unsigned long long end = CEventLoop::now() + (PACKETS * SPACING_MS + 1000U) * 1000000ULL;
+	while ((latencies.size() < PACKETS) && (CEventLoop::now() < end)) {
+		if (!loop.waitUntil(CEventLoop::now() + MAX_WAIT * 1000000ULL))
+			break;
+
+		// The input is forwarded to the output, which is then read as a network would be
+		if (loop.isReady(0U)) {
+			int len;
+			while ((len = input.read(buffer, sizeof(buffer), addr, addrLen)) > 0)
+				input.write(buffer, (unsigned int)len, outputAddr, outputAddrLen);
+		}
+
+		if (loop.isReady(1U)) {
+			int len;
+			while ((len = output.read(buffer, sizeof(buffer), addr, addrLen)) > 0) {
+				unsigned long long sent;
+				::memcpy(&sent, buffer, sizeof(sent));
+
+				latencies.push_back(double(CEventLoop::now() - sent) / 1000.0);
+			}
+		}
+	}
+
+	thread.join();
+	sender.close();
+
+	if (latencies.size() != PACKETS) {
+		::fprintf(stderr, "Only %u of %u datagrams were forwarded\n", (unsigned int)latencies.size(), PACKETS);
+		return false;
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+
+	double median = latencies[PACKETS / 2U];
+	double worst  = latencies[PACKETS - 1U];
+
+	::printf("Event loop forwarding: median %.1f us, worst %.1f us, the old loop up to %u ms\n", median, worst, OLD_SLEEP_MS);
+
+	if (median >= (OLD_SLEEP_MS * 1000.0)) {
+		::fprintf(stderr, "The median forwarding latency is no better than the old loop\n");
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	CUDPSocket input("127.0.0.1", INPUT_PORT);
+	CUDPSocket output("127.0.0.1", OUTPUT_PORT);
+
+	if (!input.open() || !output.open()) {
+		::fprintf(stderr, "Cannot open the sockets\n");
+		return 1;
+	}
+
+	CEventLoop loop;
+
+	loop.setGroup(0U);
+	loop.addSocket(input);
+	loop.setGroup(1U);
+	loop.addSocket(output);
+
+	if (!loop.open())
+		return 1;
+
+	bool ok = checkIdle(loop) && checkForwarding(loop, input, output);
+
+	loop.close();
+	input.close();
+	output.close();
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Plays frames of different lengths out of the jitter buffer into a mixer, as the inbound IAX
+// calls do, and checks that every frame comes out whole and in order and that a due frame is
+// never left behind. Built and run by "make check", not part of the gateway.
+
+#include "JitterBuffer.h"
+#include "EventLoop.h"
+#include "Mixer.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// The frame lengths that IAX peers send, 20, 30 and 60 ms at 8 kHz
+const unsigned int FRAME_LENGTHS[] = { 240U, 160U, 480U, 240U, 240U, 160U };
+const unsigned int FRAME_COUNT     = 12U;
+
+const unsigned int MIX_SAMPLES = 160U;
+const unsigned int SOURCE      = 1U;
+
+// The jitter buffer only logs its warnings, which are shown
+void Log(unsigned int level, const char* fmt, ...)
+{
+	if (level < 4U)
+		return;
+
+	va_list vl;
+	va_start(vl, fmt);
+	::vfprintf(stderr, fmt, vl);
+	va_end(vl);
+
+	::fputc('\n', stderr);
+}
+
+int main(int argc, char** argv)
+{
+	CJitterBuffer buffer("Check");
+	CMixer mixer(SOURCE + 1U, MIX_SAMPLES);
+
+	std::vector<int16_t> in;
+
+	uint32_t timestamp = 0U;
+	for (unsigned int i = 0U; i < FRAME_COUNT; i++) {
+		unsigned int length = FRAME_LENGTHS[i % (sizeof(FRAME_LENGTHS) / sizeof(unsigned int))];
+
+		std::vector<int16_t> frame(length);
+		for (unsigned int j = 0U; j < length; j++)
+			frame[j] = int16_t(i * 1000U + j);
+
+		if (!buffer.addFrame(timestamp, frame.data(), length)) {
+			::fprintf(stderr, "Frame %u of %u samples was not accepted\n", i, length);
+			return 1;
+		}
+
+		in.insert(in.end(), frame.begin(), frame.end());
+		timestamp += length / 8U;
+	}
+
+	buffer.end();
+
+	std::vector<int16_t> out;
+	int16_t mixed[MIX_SAMPLES];
+
+	for (;;) {
+		buffer.read(mixer, SOURCE);
+
+		unsigned int n;
+		while ((n = mixer.mix(mixed, false)) > 0U)
+			out.insert(out.end(), mixed, mixed + n);
+
+		// A frame that is due but still in the buffer would have the caller spin
+		unsigned int timeout = buffer.getNextTimeout();
+		if (timeout == 0U) {
+			::fprintf(stderr, "A due frame was left in the jitter buffer after %u samples\n", (unsigned int)out.size());
+			return 1;
+		}
+
+		if (timeout == NO_TIMEOUT)
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+	}
+
+	unsigned int n;
+	while ((n = mixer.mix(mixed, true)) > 0U)
+		out.insert(out.end(), mixed, mixed + n);
+
+	if (out != in) {
+		::fprintf(stderr, "%u samples came out of the mixer, %u went into the jitter buffer\n", (unsigned int)out.size(), (unsigned int)in.size());
+
+		for (unsigned int i = 0U; (i < out.size()) && (i < in.size()); i++) {
+			if (out[i] != in[i]) {
+				::fprintf(stderr, "The first difference is at sample %u: %d, sent %d\n", i, out[i], in[i]);
+				break;
+			}
+		}
+
+		return 1;
+	}
+
+	::printf("Jitter buffer played %u frames of 160 to 480 samples into the mixer whole and in order\n", FRAME_COUNT);
+
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Drives the mixer's limiter with sums that would clip and checks that no sample goes past the
+// limit, that the gain recovers frame by frame, ramping across each frame, and that a short
+// source only adds what it has. Built and run by "make check", not part of the gateway.
+
+#include "Mixer.h"
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const unsigned int FRAME_SAMPLES = 160U;
+
+// As in Mixer.cpp
+const int    LIMIT        = 29491;
+const double RELEASE_STEP = 1.0116;
+
+const int16_t LOUD  = 30000;
+const int16_t QUIET = 1000;
+
+// The mixer's ring buffers only log their overflows, which are shown
+void Log(unsigned int level, const char* fmt, ...)
+{
+	if (level < 4U)
+		return;
+
+	va_list vl;
+	va_start(vl, fmt);
+	::vfprintf(stderr, fmt, vl);
+	va_end(vl);
+
+	::fputc('\n', stderr);
+}
+
+static void addFrame(CMixer& mixer, unsigned int source, int16_t value, unsigned int length)
+{
+	std::vector<int16_t> data(length);
+	for (unsigned int i = 0U; i < length; i++)
+		data[i] = ((i % 2U) == 0U) ? value : -value;
+
+	mixer.addData(source, data.data(), length);
+}
+
+// Two full scale sources, the sum is twice what a sample can hold
+static bool mixLoud(CMixer& mixer, const char* name)
+{
+	addFrame(mixer, 0U, LOUD, FRAME_SAMPLES);
+	addFrame(mixer, 1U, LOUD, FRAME_SAMPLES);
+
+	int16_t out[FRAME_SAMPLES];
+	if (mixer.mix(out, false) != FRAME_SAMPLES) {
+		::fprintf(stderr, "%s: a whole frame wasn't mixed\n", name);
+		return false;
+	}
+
+	// The cut is immediate, the first sample is already within the limit
+	for (unsigned int i = 0U; i < FRAME_SAMPLES; i++) {
+		if (::abs(out[i]) > LIMIT) {
+			::fprintf(stderr, "%s: sample %u is %d, above the limit of %d\n", name, i, out[i], LIMIT);
+			return false;
+		}
+	}
+
+	if (::abs(out[0U]) < LIMIT - 1) {
+		::fprintf(stderr, "%s: the first sample is %d, the limiter has cut too far\n", name, out[0U]);
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	CMixer mixer(2U, FRAME_SAMPLES);
+	int16_t out[FRAME_SAMPLES];
+
+	if (!mixLoud(mixer, "Instant cut"))
+		return 1;
+
+	// From here the gain climbs by the release step each frame, ramping from one frame's gain to the next
+	double gain = double(LIMIT) / (2.0 * double(LOUD));
+
+	unsigned int frames = 0U;
+	for (;;) {
+		addFrame(mixer, 0U, QUIET, FRAME_SAMPLES);
+		if (mixer.mix(out, false) != FRAME_SAMPLES) {
+			::fprintf(stderr, "Recovery: a whole frame wasn't mixed\n");
+			return 1;
+		}
+
+		frames++;
+
+		double start  = gain;
+		double target = gain * RELEASE_STEP;
+		if (target > 1.0)
+			target = 1.0;
+
+		for (unsigned int i = 0U; i < FRAME_SAMPLES; i++) {
+			double wanted = double(QUIET) * (start + (target - start) * double(i) / double(FRAME_SAMPLES));
+			int sample    = ((i % 2U) == 0U) ? out[i] : -out[i];
+
+			if (::fabs(double(sample) - wanted) > 1.0) {
+				::fprintf(stderr, "Recovery frame %u: sample %u is %d, expected %.1f\n", frames, i, sample, wanted);
+				return 1;
+			}
+		}
+
+		gain = target;
+		if (gain >= 1.0)
+			break;
+
+		if (frames > 1000U) {
+			::fprintf(stderr, "Recovery: the gain has not returned to unity\n");
+			return 1;
+		}
+	}
+
+	unsigned int expected = (unsigned int)::ceil(::log(2.0 * double(LOUD) / double(LIMIT)) / ::log(RELEASE_STEP));
+	if (frames != expected) {
+		::fprintf(stderr, "Recovery: unity gain after %u frames, expected %u\n", frames, expected);
+		return 1;
+	}
+
+	// At unity the audio passes through untouched
+	addFrame(mixer, 0U, QUIET, FRAME_SAMPLES);
+	mixer.mix(out, false);
+	for (unsigned int i = 0U; i < FRAME_SAMPLES; i++) {
+		int16_t wanted = ((i % 2U) == 0U) ? QUIET : -QUIET;
+		if (out[i] != wanted) {
+			::fprintf(stderr, "Unity: sample %u is %d, expected %d\n", i, out[i], wanted);
+			return 1;
+		}
+	}
+
+	// A clip part way through a recovery cuts at once again
+	if (!mixLoud(mixer, "Cut after recovery"))
+		return 1;
+	addFrame(mixer, 0U, QUIET, FRAME_SAMPLES);
+	mixer.mix(out, false);
+	if (!mixLoud(mixer, "Cut during recovery"))
+		return 1;
+
+	mixer.reset();
+
+	// A source that is short adds to the start of the frame only
+	addFrame(mixer, 0U, QUIET, FRAME_SAMPLES);
+	addFrame(mixer, 1U, 2 * QUIET, 100U);
+	if (mixer.mix(out, false) != FRAME_SAMPLES) {
+		::fprintf(stderr, "Short source: a whole frame wasn't mixed\n");
+		return 1;
+	}
+
+	for (unsigned int i = 0U; i < FRAME_SAMPLES; i++) {
+		int16_t wanted = (i < 100U) ? 3 * QUIET : QUIET;
+		if ((i % 2U) == 1U)
+			wanted = -wanted;
+
+		if (out[i] != wanted) {
+			::fprintf(stderr, "Short source: sample %u is %d, expected %d\n", i, out[i], wanted);
+			return 1;
+		}
+	}
+
+	// Less than a frame waits, unless a partial frame is asked for
+	addFrame(mixer, 1U, QUIET, 50U);
+	if (mixer.mix(out, false) != 0U) {
+		::fprintf(stderr, "Partial frame: mixed without being asked\n");
+		return 1;
+	}
+
+	if (mixer.mix(out, true) != 50U) {
+		::fprintf(stderr, "Partial frame: 50 samples weren't mixed\n");
+		return 1;
+	}
+
+	if (mixer.mix(out, true) != 0U || !mixer.isEmpty()) {
+		::fprintf(stderr, "Partial frame: audio was left in the mixer\n");
+		return 1;
+	}
+
+	::printf("Mixer limited a clipping sum to %d and recovered to unity in %u frames\n", LIMIT, frames);
+
+	return 0;
+}
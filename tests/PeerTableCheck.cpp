@@ -0,0 +1,266 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Adds and removes peers at random in a table of 10000, checking every lookup against a plain
+// array of what should be there, so that the slots shifted back by erase() are always found.
+// Then times lookups and churn in a full table. Built and run by "make check", not part of the
+// gateway.
+
+#include "PeerTable.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+const unsigned int CAPACITY = 10000U;
+
+// Twice as many possible peers as the table holds, so that it fills and empties under churn
+const unsigned int KEYS = 2U * CAPACITY;
+
+const unsigned int CHURN_OPS   = 2000000U;
+const unsigned int VERIFY_OPS  = 100000U;
+const unsigned int BENCH_OPS   = 1000000U;
+
+struct KEY {
+	sockaddr_storage m_addr;
+	unsigned int     m_addrLen;
+	uint32_t         m_id;
+};
+
+// The table only logs when it is full, which is shown
+void Log(unsigned int level, const char* fmt, ...)
+{
+	if (level < 4U)
+		return;
+
+	va_list vl;
+	va_start(vl, fmt);
+	::vfprintf(stderr, fmt, vl);
+	va_end(vl);
+
+	::fputc('\n', stderr);
+}
+
+// IPv4 and IPv6 peers, with several ids on some addresses as IAX has several calls per peer
+static std::vector<KEY> makeKeys()
+{
+	std::vector<KEY> keys(KEYS);
+
+	for (unsigned int i = 0U; i < KEYS; i++) {
+		KEY& key = keys[i];
+		::memset(&key.m_addr, 0x00U, sizeof(sockaddr_storage));
+
+		unsigned int host = i / 4U;
+		key.m_id = i % 4U;
+
+		if ((host % 3U) == 0U) {
+			sockaddr_in6* in6 = (sockaddr_in6*)&key.m_addr;
+			in6->sin6_family = AF_INET6;
+			in6->sin6_port   = htons(4569U);
+			in6->sin6_addr.s6_addr[0U]  = 0x20U;
+			in6->sin6_addr.s6_addr[1U]  = 0x01U;
+			in6->sin6_addr.s6_addr[14U] = uint8_t(host >> 8);
+			in6->sin6_addr.s6_addr[15U] = uint8_t(host);
+			key.m_addrLen = sizeof(sockaddr_in6);
+		} else {
+			sockaddr_in* in = (sockaddr_in*)&key.m_addr;
+			in->sin_family      = AF_INET;
+			in->sin_port        = htons(uint16_t(32001U + (host % 7U)));
+			in->sin_addr.s_addr = htonl(0x0A000000U + host);
+			key.m_addrLen = sizeof(sockaddr_in);
+		}
+	}
+
+	return keys;
+}
+
+static bool verify(const CPeerTable<unsigned int>& table, const std::vector<KEY>& keys, const std::vector<bool>& present, unsigned int count)
+{
+	if (table.size() != count) {
+		::fprintf(stderr, "The table holds %u peers, there should be %u\n", table.size(), count);
+		return false;
+	}
+
+	for (unsigned int i = 0U; i < KEYS; i++) {
+		CPeerTable<unsigned int>::PEER* peer = table.find(keys[i].m_addr, keys[i].m_id);
+
+		if (present[i] && ((peer == nullptr) || (peer->m_data != i))) {
+			::fprintf(stderr, "Peer %u was not found\n", i);
+			return false;
+		}
+
+		if (!present[i] && (peer != nullptr)) {
+			::fprintf(stderr, "Peer %u was found after it was removed\n", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool checkChurn(const std::vector<KEY>& keys)
+{
+	CPeerTable<unsigned int> table(CAPACITY, "Check");
+
+	std::vector<bool> present(KEYS, false);
+	unsigned int count = 0U;
+
+	std::mt19937 random(1U);
+	std::uniform_int_distribution<unsigned int> pick(0U, KEYS - 1U);
+
+	unsigned int erased = 0U;
+
+	for (unsigned int op = 0U; op < CHURN_OPS; op++) {
+		unsigned int i = pick(random);
+		const KEY& key = keys[i];
+
+		if (present[i]) {
+			if (!table.erase(key.m_addr, key.m_id)) {
+				::fprintf(stderr, "Peer %u could not be removed\n", i);
+				return false;
+			}
+
+			// The slots that were shifted back must still be found
+			if (table.find(key.m_addr, key.m_id) != nullptr) {
+				::fprintf(stderr, "Peer %u was found after it was removed\n", i);
+				return false;
+			}
+
+			present[i] = false;
+			count--;
+			erased++;
+		} else if (count < CAPACITY) {
+			if (table.erase(key.m_addr, key.m_id)) {
+				::fprintf(stderr, "Peer %u was removed when it was not there\n", i);
+				return false;
+			}
+
+			if (table.insert(key.m_addr, key.m_addrLen, key.m_id, i) == nullptr) {
+				::fprintf(stderr, "Peer %u could not be added with %u peers\n", i, count);
+				return false;
+			}
+
+			present[i] = true;
+			count++;
+		}
+
+		if ((op % VERIFY_OPS) == (VERIFY_OPS - 1U)) {
+			if (!verify(table, keys, present, count))
+				return false;
+		}
+	}
+
+	// Fill it completely, one more must be refused
+	for (unsigned int i = 0U; (i < KEYS) && (count < CAPACITY); i++) {
+		if (!present[i]) {
+			table.insert(keys[i].m_addr, keys[i].m_addrLen, keys[i].m_id, i);
+			present[i] = true;
+			count++;
+		}
+	}
+
+	if (!verify(table, keys, present, count))
+		return false;
+
+	// Empty it again in a random order
+	for (unsigned int i = 0U; count > 0U; i = (i + 7919U) % KEYS) {
+		if (present[i]) {
+			table.erase(keys[i].m_addr, keys[i].m_id);
+			present[i] = false;
+			count--;
+		}
+	}
+
+	if (!verify(table, keys, present, count))
+		return false;
+
+	::printf("Peer table matched after %u operations with %u removals, up to %u peers\n", CHURN_OPS, erased, CAPACITY);
+
+	return true;
+}
+
+static void bench(const std::vector<KEY>& keys)
+{
+	CPeerTable<unsigned int> table(CAPACITY, "Bench");
+
+	for (unsigned int i = 0U; i < CAPACITY; i++)
+		table.insert(keys[i].m_addr, keys[i].m_addrLen, keys[i].m_id, i);
+
+	std::mt19937 random(2U);
+	std::uniform_int_distribution<unsigned int> present(0U, CAPACITY - 1U);
+	std::uniform_int_distribution<unsigned int> absent(CAPACITY, KEYS - 1U);
+
+	std::vector<unsigned int> hits(BENCH_OPS), misses(BENCH_OPS);
+	for (unsigned int i = 0U; i < BENCH_OPS; i++) {
+		hits[i]   = present(random);
+		misses[i] = absent(random);
+	}
+
+	unsigned int sum = 0U;
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (unsigned int i = 0U; i < BENCH_OPS; i++) {
+		const KEY& key = keys[hits[i]];
+		sum += table.find(key.m_addr, key.m_id)->m_data;
+	}
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	for (unsigned int i = 0U; i < BENCH_OPS; i++) {
+		const KEY& key = keys[misses[i]];
+		sum += (table.find(key.m_addr, key.m_id) == nullptr) ? 1U : 0U;
+	}
+	std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+	// Each removal is followed by an addition, so the table stays full and its clusters move
+	std::vector<unsigned int> in, out;
+	for (unsigned int i = 0U; i < KEYS; i++)
+		(i < CAPACITY ? in : out).push_back(i);
+
+	for (unsigned int i = 0U; i < BENCH_OPS; i++) {
+		unsigned int& remove = in[hits[i]];
+		unsigned int& add    = out[misses[i] - CAPACITY];
+
+		table.erase(keys[remove].m_addr, keys[remove].m_id);
+		table.insert(keys[add].m_addr, keys[add].m_addrLen, keys[add].m_id, add);
+
+		unsigned int temp = remove;
+		remove = add;
+		add    = temp;
+	}
+	std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+
+	double hit   = std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_OPS;
+	double miss  = std::chrono::duration<double, std::nano>(t2 - t1).count() / BENCH_OPS;
+	double churn = std::chrono::duration<double, std::nano>(t3 - t2).count() / BENCH_OPS;
+
+	::printf("Peer table of %u: find %5.1f ns, miss %5.1f ns, remove and add %5.1f ns (%u)\n", table.size(), hit, miss, churn, sum & 1U);
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<KEY> keys = makeKeys();
+
+	// The timings mean nothing if the table is broken
+	if (!checkChurn(keys))
+		return 1;
+
+	bench(keys);
+
+	return 0;
+}
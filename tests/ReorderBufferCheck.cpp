@@ -0,0 +1,293 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Feeds sequence numbered frames to the USRP reorder buffer out of order, twice, late, across
+// gaps and jumps and through the wrap of the sequence numbers, and checks what it plays and
+// the counts it logs at the end of each stream. Built and run by "make check", not part of the
+// gateway.
+
+#include "ReorderBuffer.h"
+#include "SPSCRingBuffer.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// As the USRP network uses
+const unsigned int WINDOW = 5U;
+
+const unsigned int FRAME_SAMPLES = 4U;
+const unsigned int FRAME_LENGTH  = FRAME_SAMPLES * sizeof(int16_t);
+
+struct STATS {
+	unsigned int m_received;
+	unsigned int m_lost;
+	unsigned int m_reordered;
+	unsigned int m_duplicates;
+	unsigned int m_late;
+};
+
+static STATS m_stats;
+static bool  m_logged = false;
+
+// The counts are only logged at the end of a stream, so they are read from there. Warnings are shown.
+void Log(unsigned int level, const char* fmt, ...)
+{
+	char text[200U];
+
+	va_list vl;
+	va_start(vl, fmt);
+	::vsnprintf(text, sizeof(text), fmt, vl);
+	va_end(vl);
+
+	const char* p = ::strstr(text, ": ");
+	if ((level == 1U) && (p != nullptr) && (::sscanf(p + 2U, "%u frames received, %u lost, %u reordered, %u duplicates, %u late",
+		&m_stats.m_received, &m_stats.m_lost, &m_stats.m_reordered, &m_stats.m_duplicates, &m_stats.m_late) == 5))
+		m_logged = true;
+
+	if (level >= 4U)
+		::fprintf(stderr, "%s\n", text);
+}
+
+// Every sample of a frame has the same level, a multiple of eight so that concealment halves it exactly
+static int level(uint32_t seqNo)
+{
+	return int(((seqNo % 1000U) + 1U) * 8U);
+}
+
+class CChecker {
+public:
+	CChecker(const char* name) :
+	m_name(name),
+	m_output(4000U, "Check"),
+	m_buffer("Check", WINDOW, FRAME_LENGTH, m_output),
+	m_ok(true)
+	{
+	}
+
+	void add(uint32_t seqNo, bool accepted)
+	{
+		uint8_t frame[FRAME_LENGTH];
+		for (unsigned int i = 0U; i < FRAME_SAMPLES; i++) {
+			frame[i * 2U + 0U] = uint8_t(level(seqNo) >> 0);
+			frame[i * 2U + 1U] = uint8_t(level(seqNo) >> 8);
+		}
+
+		if (m_buffer.addFrame(seqNo, frame, FRAME_LENGTH) != accepted) {
+			::fprintf(stderr, "%s: frame %u was %s\n", m_name, seqNo, accepted ? "refused" : "accepted");
+			m_ok = false;
+		}
+	}
+
+	// The levels of the frames played since the last call
+	void played(const std::vector<int>& wanted)
+	{
+		std::vector<int> levels;
+
+		uint8_t frame[FRAME_LENGTH];
+		while (m_output.dataSize() >= FRAME_LENGTH) {
+			m_output.getData(frame, FRAME_LENGTH);
+
+			int value = int16_t(frame[0U] | (frame[1U] << 8));
+			for (unsigned int i = 1U; i < FRAME_SAMPLES; i++) {
+				if (int16_t(frame[i * 2U] | (frame[i * 2U + 1U] << 8)) != value) {
+					::fprintf(stderr, "%s: a frame was not played whole\n", m_name);
+					m_ok = false;
+				}
+			}
+
+			levels.push_back(value);
+		}
+
+		if (m_output.dataSize() > 0U) {
+			::fprintf(stderr, "%s: part of a frame was played\n", m_name);
+			m_ok = false;
+		}
+
+		if (levels != wanted) {
+			::fprintf(stderr, "%s: played", m_name);
+			for (std::vector<int>::const_iterator it = levels.cbegin(); it != levels.cend(); ++it)
+				::fprintf(stderr, " %d", *it);
+			::fprintf(stderr, ", expected");
+			for (std::vector<int>::const_iterator it = wanted.cbegin(); it != wanted.cend(); ++it)
+				::fprintf(stderr, " %d", *it);
+			::fprintf(stderr, "\n");
+			m_ok = false;
+		}
+	}
+
+	// The counts logged at the end of the last stream
+	void counted(unsigned int received, unsigned int lost, unsigned int reordered, unsigned int duplicates, unsigned int late)
+	{
+		if (!m_logged) {
+			::fprintf(stderr, "%s: the end of the stream wasn't logged\n", m_name);
+			m_ok = false;
+			return;
+		}
+
+		if ((m_stats.m_received != received) || (m_stats.m_lost != lost) || (m_stats.m_reordered != reordered) ||
+		    (m_stats.m_duplicates != duplicates) || (m_stats.m_late != late)) {
+			::fprintf(stderr, "%s: counted %u received, %u lost, %u reordered, %u duplicates, %u late, expected %u, %u, %u, %u, %u\n", m_name,
+				m_stats.m_received, m_stats.m_lost, m_stats.m_reordered, m_stats.m_duplicates, m_stats.m_late,
+				received, lost, reordered, duplicates, late);
+			m_ok = false;
+		}
+
+		m_logged = false;
+	}
+
+	const char*              m_name;
+	CSPSCRingBuffer<uint8_t> m_output;
+	CReorderBuffer           m_buffer;
+	bool                     m_ok;
+};
+
+static bool checkReorder()
+{
+	CChecker c("Reorder");
+
+	c.add(100U, true);
+	c.add(102U, true);
+	c.add(101U, true);
+	c.add(104U, true);
+	c.add(103U, true);
+	c.played({ level(100U), level(101U), level(102U), level(103U), level(104U) });
+
+	c.m_buffer.end();
+	c.played({});
+	c.counted(5U, 0U, 2U, 0U, 0U);
+
+	return c.m_ok;
+}
+
+static bool checkDuplicatesAndLate()
+{
+	CChecker c("Duplicates and late");
+
+	for (uint32_t seqNo = 200U; seqNo <= 206U; seqNo++)
+		c.add(seqNo, true);
+
+	// 207 is missing, so 208 is held until 213 pushes the window past the gap
+	c.add(208U, true);
+	c.add(213U, true);
+
+	// Already given up on, already played, already held, and played a while ago
+	c.add(207U, false);
+	c.add(208U, false);
+	c.add(213U, false);
+	c.add(203U, false);
+
+	c.m_buffer.end();
+	c.played({ level(200U), level(201U), level(202U), level(203U), level(204U), level(205U), level(206U),
+		   level(206U) / 2, level(208U),
+		   level(208U) / 2, level(208U) / 4, level(208U) / 8, 0, level(213U) });
+	c.counted(13U, 5U, 0U, 3U, 1U);
+
+	return c.m_ok;
+}
+
+static bool checkGapTimeout()
+{
+	CChecker c("Gap timeout");
+
+	c.add(300U, true);
+	c.add(305U, true);
+	c.played({ level(300U) });
+
+	unsigned int timeout = c.m_buffer.getNextTimeout();
+	if ((timeout == 0U) || (timeout > WINDOW * 20U)) {
+		::fprintf(stderr, "Gap timeout: the next timeout is %u ms\n", timeout);
+		return false;
+	}
+
+	c.m_buffer.clock((timeout - 10U) * 1000U);
+	c.played({});
+
+	// Three quieter copies of the last frame, then silence
+	c.m_buffer.clock(20000U);
+	c.played({ level(300U) / 2, level(300U) / 4, level(300U) / 8, 0, level(305U) });
+
+	// Nothing more arrives, so the stream ends by itself
+	c.m_buffer.clock(1000000U);
+	c.played({});
+	c.counted(2U, 4U, 0U, 0U, 0U);
+
+	return c.m_ok;
+}
+
+static bool checkResync()
+{
+	CChecker c("Resync");
+
+	c.add(400U, true);
+	c.add(401U, true);
+
+	// A jump forward or back of 50 frames or more starts a new stream without filling the gap
+	c.add(452U, true);
+	c.counted(2U, 0U, 0U, 0U, 0U);
+	c.add(403U, true);
+	c.counted(1U, 0U, 0U, 0U, 0U);
+	c.played({ level(400U), level(401U), level(452U), level(403U) });
+
+	// One less is a gap in the same stream
+	c.add(453U, true);
+	c.m_buffer.end();
+
+	std::vector<int> wanted = { level(403U) / 2, level(403U) / 4, level(403U) / 8 };
+	wanted.resize(49U, 0);
+	wanted.push_back(level(453U));
+	c.played(wanted);
+	c.counted(2U, 49U, 0U, 0U, 0U);
+
+	return c.m_ok;
+}
+
+static bool checkWrap()
+{
+	CChecker c("Wrap");
+
+	c.add(0xFFFFFFFEU, true);
+	c.add(0U, true);
+	c.add(0xFFFFFFFFU, true);
+	c.add(2U, true);
+	c.add(1U, true);
+	c.add(0xFFFFFFFFU, false);
+
+	c.m_buffer.end();
+	c.played({ level(0xFFFFFFFEU), level(0xFFFFFFFFU), level(0U), level(1U), level(2U) });
+	c.counted(6U, 0U, 2U, 1U, 0U);
+
+	return c.m_ok;
+}
+
+int main(int argc, char** argv)
+{
+	bool ok = checkReorder();
+	ok = checkDuplicatesAndLate() && ok;
+	ok = checkGapTimeout() && ok;
+	ok = checkResync() && ok;
+	ok = checkWrap() && ok;
+
+	if (!ok)
+		return 1;
+
+	::printf("Reorder buffer played reordered, duplicate, late, missing, resynced and wrapped frames correctly\n");
+
+	return 0;
+}
@@ -0,0 +1,290 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Checks that the resampler produces the right number of samples between 8 kHz and the other
+// rates, that cutting the input into pieces doesn't change a single bit of the output, and
+// that getInputNeeded() asks for exactly enough input, then times a 20 ms frame each way.
+// With -DHAS_SRC and -lsamplerate the same frames are timed through libsamplerate's fastest
+// sinc converter too. Built and run by "make check", not part of the gateway.
+
+#include "Resampler.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#if defined(HAS_SRC)
+#include <samplerate.h>
+#endif
+
+const unsigned int MMDVM_SAMPLERATE = 8000U;
+
+const unsigned int RATES[] = { 16000U, 32000U, 44100U, 48000U };
+
+const unsigned int BENCH_FRAMES = 20000U;
+
+static std::mt19937 m_random(1U);
+
+// A second of a tone sweeping up to 3 kHz with some noise on it
+static std::vector<float> makeInput(unsigned int rate)
+{
+	std::uniform_real_distribution<float> noise(-0.05F, 0.05F);
+
+	std::vector<float> in(rate);
+	for (unsigned int i = 0U; i < rate; i++) {
+		double t = double(i) / double(rate);
+		in[i] = float(0.8 * std::sin(2.0 * 3.14159265358979323846 * 1500.0 * t * t)) + noise(m_random);
+	}
+
+	return in;
+}
+
+static std::vector<int16_t> toS16(const std::vector<float>& in)
+{
+	std::vector<int16_t> out(in.size());
+	for (unsigned int i = 0U; i < in.size(); i++)
+		out[i] = int16_t(::lrintf(in[i] * 32767.0F));
+
+	return out;
+}
+
+// The first call has the resampler's history of silence before it, so the n'th input sample
+// completes the output samples before n * outRate / inRate
+static unsigned int expectedOutput(unsigned long long nIn, unsigned int inRate, unsigned int outRate)
+{
+	return (unsigned int)((nIn * outRate + inRate - 1U) / inRate);
+}
+
+static bool checkCounts(unsigned int inRate, unsigned int outRate)
+{
+	std::vector<float> in = makeInput(inRate);
+	std::vector<float> out(outRate + 100U);
+
+	CResampler resampler(inRate, outRate);
+
+	// In 20 ms frames, as the RAW network sends them
+	unsigned int frame = inRate / 50U;
+
+	unsigned int nIn = 0U, nOut = 0U;
+	while (nIn < in.size()) {
+		unsigned int n = (unsigned int)in.size() - nIn;
+		if (n > frame)
+			n = frame;
+
+		nOut += resampler.process(in.data() + nIn, n, out.data() + nOut, (unsigned int)out.size() - nOut);
+		nIn  += n;
+
+		if (nOut != expectedOutput(nIn, inRate, outRate)) {
+			::fprintf(stderr, "%u to %u: %u samples out after %u in, expected %u\n", inRate, outRate, nOut, nIn, expectedOutput(nIn, inRate, outRate));
+			return false;
+		}
+	}
+
+	if (nOut != outRate) {
+		::fprintf(stderr, "%u to %u: a second of audio gave %u samples\n", inRate, outRate, nOut);
+		return false;
+	}
+
+	return true;
+}
+
+static bool checkChunked(unsigned int inRate, unsigned int outRate)
+{
+	std::vector<float> in = makeInput(inRate);
+	std::vector<int16_t> in16 = toS16(in);
+
+	unsigned int length = expectedOutput(in.size(), inRate, outRate);
+
+	CResampler whole(inRate, outRate);
+	std::vector<float> ref(length);
+	std::vector<int16_t> ref16(length);
+	whole.process(in.data(), (unsigned int)in.size(), ref.data(), length);
+	whole.reset();
+	whole.process(in16.data(), (unsigned int)in16.size(), ref16.data(), length);
+
+	// Pieces of any size, and output asked for in pieces that don't line up with them
+	std::uniform_int_distribution<unsigned int> size(0U, 700U);
+
+	CResampler pieces(inRate, outRate);
+	std::vector<float> out(length);
+	std::vector<int16_t> out16(length);
+
+	for (unsigned int pass = 0U; pass < 2U; pass++) {
+		pieces.reset();
+
+		unsigned int nIn = 0U, nOut = 0U;
+		while (nOut < length) {
+			unsigned int n = size(m_random);
+			if (n > (in.size() - nIn))
+				n = (unsigned int)in.size() - nIn;
+
+			unsigned int max = size(m_random) + 1U;
+			if (max > (length - nOut))
+				max = length - nOut;
+
+			if (pass == 0U)
+				nOut += pieces.process(in.data() + nIn, n, out.data() + nOut, max);
+			else
+				nOut += pieces.process(in16.data() + nIn, n, out16.data() + nOut, max);
+
+			nIn += n;
+		}
+	}
+
+	if (::memcmp(out.data(), ref.data(), length * sizeof(float)) != 0) {
+		::fprintf(stderr, "%u to %u: the float output differs when the input is cut into pieces\n", inRate, outRate);
+		return false;
+	}
+
+	if (::memcmp(out16.data(), ref16.data(), length * sizeof(int16_t)) != 0) {
+		::fprintf(stderr, "%u to %u: the 16-bit output differs when the input is cut into pieces\n", inRate, outRate);
+		return false;
+	}
+
+	return true;
+}
+
+// Given what getInputNeeded() asks for the output must be complete, and given one less it must not
+static bool checkInputNeeded(unsigned int inRate, unsigned int outRate)
+{
+	std::vector<float> in = makeInput(inRate);
+
+	std::uniform_int_distribution<unsigned int> size(1U, 1000U);
+
+	CResampler resampler(inRate, outRate);
+	std::vector<float> out(1000U);
+
+	unsigned int nIn = 0U;
+	for (unsigned int i = 0U; i < 200U; i++) {
+		unsigned int nOut = size(m_random);
+
+		unsigned int needed = resampler.getInputNeeded(nOut);
+		if ((nIn + needed) > in.size())
+			break;
+
+		if (needed > 0U) {
+			CResampler fewer(resampler);
+			if (fewer.process(in.data() + nIn, needed - 1U, out.data(), nOut) >= nOut) {
+				::fprintf(stderr, "%u to %u: %u samples were made from one less than the %u asked for\n", inRate, outRate, nOut, needed);
+				return false;
+			}
+		}
+
+		unsigned int n = resampler.process(in.data() + nIn, needed, out.data(), nOut);
+		if (n != nOut) {
+			::fprintf(stderr, "%u to %u: %u of %u samples were made from the %u asked for\n", inRate, outRate, n, nOut, needed);
+			return false;
+		}
+
+		nIn += needed;
+	}
+
+	return true;
+}
+
+// The time in microseconds to resample a 20 ms frame
+static double benchResampler(unsigned int inRate, unsigned int outRate)
+{
+	std::vector<float> in = makeInput(inRate);
+	std::vector<float> out(outRate / 50U);
+
+	CResampler resampler(inRate, outRate);
+
+	unsigned int frame = inRate / 50U;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0U; i < BENCH_FRAMES; i++)
+		resampler.process(in.data() + (i % 50U) * frame, frame, out.data(), (unsigned int)out.size());
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::micro>(end - start).count() / BENCH_FRAMES;
+}
+
+#if defined(HAS_SRC)
+static double benchSRC(unsigned int inRate, unsigned int outRate)
+{
+	std::vector<float> in = makeInput(inRate);
+	std::vector<float> out(outRate / 50U + 10U);
+
+	int error = 0;
+	SRC_STATE* state = ::src_new(SRC_SINC_FASTEST, 1, &error);
+	if (state == nullptr) {
+		::fprintf(stderr, "Unable to create the libsamplerate converter - %s\n", ::src_strerror(error));
+		return 0.0;
+	}
+
+	unsigned int frame = inRate / 50U;
+
+	SRC_DATA data;
+	data.output_frames = long(out.size());
+	data.data_out      = out.data();
+	data.input_frames  = long(frame);
+	data.end_of_input  = 0;
+	data.src_ratio     = double(outRate) / double(inRate);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0U; i < BENCH_FRAMES; i++) {
+		data.data_in = in.data() + (i % 50U) * frame;
+		::src_process(state, &data);
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	::src_delete(state);
+
+	return std::chrono::duration<double, std::micro>(end - start).count() / BENCH_FRAMES;
+}
+#endif
+
+int main(int argc, char** argv)
+{
+	for (unsigned int i = 0U; i < (sizeof(RATES) / sizeof(unsigned int)); i++) {
+		unsigned int rate = RATES[i];
+
+		if (!checkCounts(MMDVM_SAMPLERATE, rate) || !checkCounts(rate, MMDVM_SAMPLERATE))
+			return 1;
+
+		if (!checkChunked(MMDVM_SAMPLERATE, rate) || !checkChunked(rate, MMDVM_SAMPLERATE))
+			return 1;
+
+		if (!checkInputNeeded(MMDVM_SAMPLERATE, rate) || !checkInputNeeded(rate, MMDVM_SAMPLERATE))
+			return 1;
+	}
+
+	::printf("Resampler gave the right lengths, the same output in pieces and the right input needed between 8 kHz and 16 to 48 kHz\n");
+
+	for (unsigned int i = 0U; i < (sizeof(RATES) / sizeof(unsigned int)); i++) {
+		unsigned int rate = RATES[i];
+
+		double up   = benchResampler(MMDVM_SAMPLERATE, rate);
+		double down = benchResampler(rate, MMDVM_SAMPLERATE);
+
+#if defined(HAS_SRC)
+		double srcUp   = benchSRC(MMDVM_SAMPLERATE, rate);
+		double srcDown = benchSRC(rate, MMDVM_SAMPLERATE);
+
+		::printf("Resampler %5u Hz up %6.2f us, down %6.2f us per 20 ms frame, libsamplerate %6.2f us, %6.2f us\n", rate, up, down, srcUp, srcDown);
+#else
+		::printf("Resampler %5u Hz up %6.2f us, down %6.2f us per 20 ms frame\n", rate, up, down);
+#endif
+	}
+
+	return 0;
+}
@@ -0,0 +1,195 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Compares the table driven u-law codec with the original IAX code for every sample and every
+// code, and times a frame of each. Built and run by "make check", not part of the gateway.
+
+#include "ULawCodec.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+const unsigned int FRAME_SAMPLES = 160U;
+const unsigned int BENCH_FRAMES  = 200000U;
+
+// The encoder and decoder as they were in CIAXNetwork, kept here as the reference
+static void uLawEncode(const int16_t* audio, uint8_t* buffer, unsigned int length)
+{
+	const uint16_t MULAW_MAX  = 0x1FFFU;
+	const uint16_t MULAW_BIAS = 33U;
+
+	for (unsigned int i = 0U; i < length; i++) {
+		uint16_t mask = 0x1000U;
+		uint8_t  sign;
+		uint8_t  position = 12U;
+		uint16_t number;
+
+		if (audio[i] < 0) {
+			number = -audio[i];
+			sign   = 0x80U;
+		} else {
+			number = audio[i];
+			sign   = 0x00U;
+		}
+
+		number += MULAW_BIAS;
+		if (number > MULAW_MAX)
+			number = MULAW_MAX;
+
+		for (; ((number & mask) != mask && position >= 5U); mask >>= 1, position--)
+			;
+
+		uint8_t lsb = (number >> (position - 4U)) & 0x0FU;
+		buffer[i] = ~(sign | ((position - 5U) << 4) | lsb);
+	}
+}
+
+static void uLawDecode(const uint8_t* buffer, int16_t* audio, unsigned int length)
+{
+	const uint16_t MULAW_BIAS = 33U;
+
+	for (unsigned int i = 0U; i < length; i++) {
+		bool sign = true;
+
+		uint8_t number = ~buffer[i];
+		if (number & 0x80U) {
+			number &= 0x7FU;
+			sign = false;
+		}
+
+		uint8_t position = ((number & 0xF0U) >> 4) + 5U;
+		int16_t decoded = ((1 << position) | ((number & 0x0FU) << (position - 4U))
+			 | (1 << (position - 5U))) - MULAW_BIAS;
+
+		audio[i] = sign ? decoded : -decoded;
+	}
+}
+
+static bool checkEncode(CULawCodec& codec)
+{
+	static int16_t audio[65536U];
+	static uint8_t ref[65536U], out[65536U];
+
+	for (unsigned int i = 0U; i < 65536U; i++)
+		audio[i] = int16_t(int(i) - 32768);
+
+	uLawEncode(audio, ref, 65536U);
+	codec.encode(audio, 65536U, out);
+
+	for (unsigned int i = 0U; i < 65536U; i++) {
+		if (out[i] != ref[i]) {
+			::fprintf(stderr, "u-law encode differs for %d: 0x%02X, original 0x%02X\n", audio[i], out[i], ref[i]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool checkDecode(CULawCodec& codec)
+{
+	uint8_t codes[256U];
+	for (unsigned int i = 0U; i < 256U; i++)
+		codes[i] = uint8_t(i);
+
+	int16_t ref[256U], out[256U];
+	uLawDecode(codes, ref, 256U);
+
+	unsigned int n = codec.decode(codes, 256U, out, 256U);
+	if (n != 256U) {
+		::fprintf(stderr, "u-law decode returned %u samples for 256 codes\n", n);
+		return false;
+	}
+
+	float fout[256U];
+	codec.decode(codes, fout, 256U);
+
+	for (unsigned int i = 0U; i < 256U; i++) {
+		if (out[i] != ref[i]) {
+			::fprintf(stderr, "u-law decode differs for 0x%02X: %d, original %d\n", i, out[i], ref[i]);
+			return false;
+		}
+
+		if (fout[i] != float(ref[i]) / 65536.0F) {
+			::fprintf(stderr, "u-law float decode differs for 0x%02X: %.9g, original %d\n", i, fout[i], ref[i]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void bench(CULawCodec& codec)
+{
+	std::mt19937 random(1U);
+	std::uniform_int_distribution<int> dist(-32768, 32767);
+
+	int16_t in[FRAME_SAMPLES];
+	for (unsigned int i = 0U; i < FRAME_SAMPLES; i++)
+		in[i] = int16_t(dist(random));
+
+	uint8_t buffer[FRAME_SAMPLES];
+	int16_t out[FRAME_SAMPLES];
+
+	unsigned int sum = 0U;
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (unsigned int i = 0U; i < BENCH_FRAMES; i++) {
+		uLawEncode(in, buffer, FRAME_SAMPLES);
+		sum += buffer[i % FRAME_SAMPLES];
+	}
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	for (unsigned int i = 0U; i < BENCH_FRAMES; i++) {
+		codec.encode(in, FRAME_SAMPLES, buffer);
+		sum += buffer[i % FRAME_SAMPLES];
+	}
+	std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+	for (unsigned int i = 0U; i < BENCH_FRAMES; i++) {
+		uLawDecode(buffer, out, FRAME_SAMPLES);
+		sum += out[i % FRAME_SAMPLES];
+	}
+	std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+	for (unsigned int i = 0U; i < BENCH_FRAMES; i++) {
+		codec.decode(buffer, FRAME_SAMPLES, out, FRAME_SAMPLES);
+		sum += out[i % FRAME_SAMPLES];
+	}
+	std::chrono::steady_clock::time_point t4 = std::chrono::steady_clock::now();
+
+	double origEncode = std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_FRAMES;
+	double encode     = std::chrono::duration<double, std::nano>(t2 - t1).count() / BENCH_FRAMES;
+	double origDecode = std::chrono::duration<double, std::nano>(t3 - t2).count() / BENCH_FRAMES;
+	double decode     = std::chrono::duration<double, std::nano>(t4 - t3).count() / BENCH_FRAMES;
+
+	::printf("u-law  encode %6.1f ns, original %6.1f ns per %u sample frame (%u)\n", encode, origEncode, FRAME_SAMPLES, sum & 1U);
+	::printf("u-law  decode %6.1f ns, original %6.1f ns per %u sample frame\n", decode, origDecode, FRAME_SAMPLES);
+}
+
+int main(int argc, char** argv)
+{
+	CULawCodec codec;
+
+	bool ok = checkEncode(codec) && checkDecode(codec);
+	if (ok)
+		::printf("u-law  matches the original code for all 65536 samples and 256 codes\n");
+
+	bench(codec);
+
+	return ok ? 0 : 1;
+}